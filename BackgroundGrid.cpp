@@ -21,6 +21,16 @@ BackgroundGrid::BackgroundGrid(const Boundary& boundary, float grid_cell_size, f
     compute_fields(boundary);
 }
 
+// [新增] 从检查点恢复：场数据已知，不再重新计算
+BackgroundGrid::BackgroundGrid(const glm::vec2& min_coords, float grid_cell_size, int width, int height,
+    float refinement_level, float h_min, float h_max,
+    std::vector<float> size_field, std::vector<glm::vec2> direction_field)
+    : min_coords_(min_coords), cell_size_(grid_cell_size), width_(width), height_(height),
+    target_size_field_(std::move(size_field)), target_direction_field_(std::move(direction_field)),
+    h_min_(h_min), h_max_(h_max), refinement_level_(refinement_level)
+{
+}
+
 // 核心修改：计算 h_t 和 D_t
 void BackgroundGrid::compute_fields(const Boundary& boundary) {
    /* const auto& boundary_vertices = boundary.get_vertices();
@@ -8,6 +8,10 @@ public:
     // [修改] 构造函数增加一个参数
    // [修改] 构造函数签名
     BackgroundGrid(const Boundary& boundary, float grid_cell_size, float refinement_level, float h_min, float h_max);
+    // [新增] 直接由已计算好的场构造 (从检查点恢复时跳过 SDF 计算)
+    BackgroundGrid(const glm::vec2& min_coords, float grid_cell_size, int width, int height,
+        float refinement_level, float h_min, float h_max,
+        std::vector<float> size_field, std::vector<glm::vec2> direction_field);
 
     float get_target_size(const glm::vec2& pos) const;
     // 新增：获取指定位置的目标方向 D_t
@@ -18,6 +22,7 @@ public:
     float get_cell_size() const { return cell_size_; }
     glm::vec2 get_min_coords() const { return min_coords_; }
     const std::vector<float>& get_target_size_field() const { return target_size_field_; }
+    const std::vector<glm::vec2>& get_target_direction_field() const { return target_direction_field_; }
     // --- 结束 ---
     float get_min_target_size() const { return h_min_; } // <-- 新增
 
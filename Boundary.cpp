@@ -2,12 +2,14 @@
 #include "Utils.h"
 #include <algorithm> // for std::min/max
 #include <cfloat>
+#include <cmath>
 
 // 构造函数: 從 Chart2D 初始化
 Boundary::Boundary(const Chart2D& chart)
     : m_outer_boundary(chart.boundary), m_holes(chart.holes) // <-- [修改]
 {
     calculate_aabb();
+    build_arc_length_tables();
 }
 
 // get_outer_boundary() 的实现
@@ -154,3 +156,71 @@ void Boundary::get_closest_point_and_tangent(const glm::vec2& p, glm::vec2& out_
         process_ring(hole);
     }
 }
+
+// [新增] 预计算每个环的累计弧长表
+void Boundary::build_arc_length_tables()
+{
+    m_ring_arc_lengths.assign(get_ring_count(), {});
+    for (int r = 0; r < get_ring_count(); ++r) {
+        const auto& ring = get_ring(r);
+        auto& table = m_ring_arc_lengths[r];
+        table.resize(ring.size() + 1, 0.0f);
+        for (size_t i = 0; i < ring.size(); ++i) {
+            glm::vec2 a = ring[i];
+            glm::vec2 b = ring[(i + 1) % ring.size()];
+            table[i + 1] = table[i] + glm::distance(a, b);
+        }
+    }
+}
+
+const std::vector<glm::vec2>& Boundary::get_ring(int ring_id) const
+{
+    return (ring_id == 0) ? m_outer_boundary : m_holes[ring_id - 1];
+}
+
+float Boundary::get_ring_length(int ring_id) const
+{
+    return m_ring_arc_lengths[ring_id].back();
+}
+
+float Boundary::get_arc_length_at(int ring_id, int vertex_index) const
+{
+    return m_ring_arc_lengths[ring_id][vertex_index];
+}
+
+float Boundary::wrap_arc_length(int ring_id, float s) const
+{
+    float L = get_ring_length(ring_id);
+    if (L <= 0.0f) return 0.0f;
+    s = std::fmod(s, L);
+    if (s < 0.0f) s += L;
+    // fmod 对负数可能正好得到 L (浮点舍入)，再折一次
+    return (s >= L) ? 0.0f : s;
+}
+
+void Boundary::evaluate_arc_length(int ring_id, float s, glm::vec2& out_pos, glm::vec2& out_tangent) const
+{
+    const auto& ring = get_ring(ring_id);
+    const auto& table = m_ring_arc_lengths[ring_id];
+    int n = (int)ring.size();
+    if (n < 2) {
+        out_pos = ring.empty() ? glm::vec2(0.0f) : ring[0];
+        out_tangent = glm::vec2(1.0f, 0.0f);
+        return;
+    }
+
+    s = wrap_arc_length(ring_id, s);
+
+    // upper_bound 找到第一个 > s 的累计弧长，前一项即所在边的起点
+    // (长度为 0 的退化边区间为空，会被自动跳过)
+    int i = (int)(std::upper_bound(table.begin(), table.end(), s) - table.begin()) - 1;
+    i = std::max(0, std::min(i, n - 1));
+
+    glm::vec2 a = ring[i];
+    glm::vec2 b = ring[(i + 1) % n];
+    float seg_len = table[i + 1] - table[i];
+    float t = (seg_len > 1e-9f) ? (s - table[i]) / seg_len : 0.0f;
+
+    out_pos = a + t * (b - a);
+    out_tangent = (seg_len > 1e-9f) ? (b - a) / seg_len : glm::vec2(1.0f, 0.0f);
+}
@@ -34,12 +34,29 @@ public:
     // [新增] 获取最近点 *以及* 该处的切线单位向量
     void get_closest_point_and_tangent(const glm::vec2& p, glm::vec2& out_closest, glm::vec2& out_tangent) const;
 
+    // --- [新增] 弧长参数化 (供边界粒子沿边界滑移使用) ---
+    // 环编号: 0 = 外环, 1..N = 第 k-1 个内洞
+    int get_ring_count() const { return 1 + (int)m_holes.size(); }
+    const std::vector<glm::vec2>& get_ring(int ring_id) const;
+    // 环的总周长
+    float get_ring_length(int ring_id) const;
+    // 第 vertex_index 个顶点处的累计弧长
+    float get_arc_length_at(int ring_id, int vertex_index) const;
+    // 将弧长参数 s 折回 [0, 周长)
+    float wrap_arc_length(int ring_id, float s) const;
+    // 在累计弧长表上二分查找 (O(log E))，返回弧长 s 处的位置和单位切线
+    void evaluate_arc_length(int ring_id, float s, glm::vec2& out_pos, glm::vec2& out_tangent) const;
+
 private:
     std::vector<glm::vec2> m_outer_boundary; // <-- [修改]
     std::vector<std::vector<glm::vec2>> m_holes; // <-- [新增]
     glm::vec4 aabb_; // x_min, y_min, x_max, y_max
 
+    // [新增] 每个环的累计弧长表 (大小为 顶点数+1，末项为周长)
+    std::vector<std::vector<float>> m_ring_arc_lengths;
+
     void calculate_aabb(); // 私有輔助函數
+    void build_arc_length_tables();
 
     // 新增: 靜態輔助函數，用於 Ray-Casting
     static bool is_inside_polygon(const glm::vec2& point, const std::vector<glm::vec2>& polygon);
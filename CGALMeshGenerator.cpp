@@ -1,99 +1,918 @@
 ﻿#include "CGALMeshGenerator.h"
 #include <iostream>
-#include <map>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <unordered_map>
 #include <vector>
+#include "ParallelFor.h"
+#include "EdgeTable.h"
+#include "MeshReorder.h"
 void mark_domains(CDT& cdt);
 // [修改] generate_mesh 
+// 顶点信息 (info) 记录来源下标，提取阶段一次线性扫描完成重新编号。
 void CGALMeshGenerator::generate_mesh(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary) {
+    build_mesh(particles, boundary);
+    mesh_reordered_ = false;
+}
+
+// [新增] 顶点按 RCM / Hilbert 重排，三角形按新顶点号排序；邻接与边界标记随三角形一起置换
+void CGALMeshGenerator::reorder_mesh() {
+    if (reorder_ == MeshOrdering::None || triangles_.empty() || mesh_reordered_) return;
+    mesh_reordered_ = true;
+    using Clock = std::chrono::high_resolution_clock;
+    auto t0 = Clock::now();
+    static const std::vector<Quad> no_quads;
+    MeshOrderStats before = MeshReorder::measure(vertices_.size(), triangles_, no_quads);
+
+    MeshReorder reorder;
+    reorder.compute_vertex_order(reorder_, vertices_, triangles_, no_quads);
+    reorder.permute_vertices(vertices_);
+    if (vertex_particles_.size() == vertices_.size()) reorder.permute_vertices(vertex_particles_);
+    std::vector<Quad> quads;
+    reorder.remap_elements(triangles_, quads);
+
+    std::vector<unsigned int> order;
+    MeshReorder::element_order(triangles_, order);
+    const size_t count = triangles_.size();
+    std::vector<int> new_triangle(count);
+    for (size_t k = 0; k < count; ++k) new_triangle[order[k]] = (int)k;
+    std::vector<Triangle> triangles(count);
+    for (size_t k = 0; k < count; ++k) triangles[k] = triangles_[order[k]];
+    triangles_.swap(triangles);
+    if (triangle_neighbors_.size() == count * 3) {
+        std::vector<int> neighbors(count * 3);
+        for (size_t k = 0; k < count; ++k) {
+            for (int i = 0; i < 3; ++i) {
+                int nb = triangle_neighbors_[3 * order[k] + i];
+                neighbors[3 * k + i] = nb < 0 ? -1 : new_triangle[nb];
+            }
+        }
+        triangle_neighbors_.swap(neighbors);
+    }
+    if (boundary_edge_flags_.size() == count) {
+        std::vector<uint8_t> flags(count);
+        for (size_t k = 0; k < count; ++k) flags[k] = boundary_edge_flags_[order[k]];
+        boundary_edge_flags_.swap(flags);
+    }
+
+    MeshOrderStats after = MeshReorder::measure(vertices_.size(), triangles_, no_quads);
+    std::cout << "  [reorder] " << MeshReorder::name(reorder_) << ": bandwidth " << before.bandwidth << " -> " << after.bandwidth
+        << ", profile " << before.profile << " -> " << after.profile << " ("
+        << std::chrono::duration<double, std::milli>(Clock::now() - t0).count() << " ms)" << std::endl;
+}
+
+// [修改] 三角剖分保存在 cdt_ 中，条件允许时只做增量更新
+void CGALMeshGenerator::build_mesh(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+
     vertices_.clear();
     triangles_.clear();
+    triangle_neighbors_.clear();
+    boundary_edge_flags_.clear();
     quads_.clear();
+    vertex_particles_.clear();
 
-    const auto& outer_boundary_verts = boundary.get_outer_boundary();
-    const auto& holes_list = boundary.get_holes();
+    if (boundary.get_outer_boundary().empty()) return;
 
-    if (outer_boundary_verts.empty()) return;
+    auto t0 = Clock::now();
+    const unsigned int particle_count = (unsigned int)particles.size();
 
-    CDT cdt;
+    // [新增] 粒子链模式：约束直接连在边界粒子上
+    std::vector<std::vector<unsigned int>> chains;
+    bool use_chains = constraint_mode_ == ConstraintMode::ParticleChain;
+    if (use_chains && !build_particle_chains(particles, boundary, chains)) {
+        std::cout << "Boundary particle chains incomplete, falling back to polygon constraints." << std::endl;
+        use_chains = false;
+    }
 
-    // --- 步驟 1: 插入外邊界約束 (定义几何形状) ---
-    CDT::Vertex_handle v_start;
-    CDT::Vertex_handle v_prev;
-    for (const auto& p : outer_boundary_verts) {
-        CDT::Vertex_handle vh = cdt.insert(Point(p.x, p.y));
-        if (v_prev != nullptr) {
-            cdt.insert_constraint(v_prev, vh);
+    // [新增] 分块并行路径 (不保留 cdt_，下次调用完整重建)
+    if (tile_count_ > 1) {
+        cdt_valid_ = false;
+        cached_chains_ = std::move(chains);
+        if (generate_tiled(particles, boundary, use_chains)) {
+            if (validate_tiles_) {
+                // 同一输入跑一遍串行版本，比较域内三角形集合 (旋转到最小下标在前，保持朝向)
+                auto canonical = [](std::vector<std::array<unsigned int, 3>>& tris) {
+                    for (auto& t : tris) {
+                        int k = (int)(std::min_element(t.begin(), t.end()) - t.begin());
+                        std::rotate(t.begin(), t.begin() + k, t.end());
+                    }
+                    std::sort(tris.begin(), tris.end());
+                };
+                std::vector<std::array<unsigned int, 3>> serial;
+                auto v0 = Clock::now();
+                rebuild_triangulation(particles, boundary, use_chains);
+                mark_domains(cdt_);
+                collect_domain_triangles(serial);
+                auto v1 = Clock::now();
+                for (auto& t : serial) {
+                    for (auto& v : t) v = source_canonical_[v];
+                }
+                canonical(serial);
+                canonical(tiled_source_triangles_);
+                std::vector<std::array<unsigned int, 3>> missing, extra;
+                std::set_difference(serial.begin(), serial.end(), tiled_source_triangles_.begin(), tiled_source_triangles_.end(), std::back_inserter(missing));
+                std::set_difference(tiled_source_triangles_.begin(), tiled_source_triangles_.end(), serial.begin(), serial.end(), std::back_inserter(extra));
+                std::cout << "  [validate] serial " << serial.size() << " triangles in " << ms(v0, v1) << " ms, tiled "
+                    << tiled_source_triangles_.size() << "; missing " << missing.size() << ", extra " << extra.size()
+                    << (missing.empty() && extra.empty() ? " -> identical" : " -> MISMATCH") << std::endl;
+            }
+            std::cout << "  [timing] total " << ms(t0, Clock::now()) << " ms" << std::endl;
+            return;
         }
-        else {
-            v_start = vh;
+        std::cout << "Tiled triangulation could not be stitched, falling back to serial." << std::endl;
+        vertices_.clear();
+        triangles_.clear();
+        triangle_neighbors_.clear();
+        boundary_edge_flags_.clear();
+        vertex_particles_.clear();
+        chains = cached_chains_;
+    }
+
+    // [新增] 轻量后端：平铺数组上的约束 Delaunay，不保留 cdt_
+    if (backend_ == Backend::Native) {
+        cdt_valid_ = false;
+        cached_chains_ = std::move(chains);
+        TriangulationInput input;
+        TriangulationResult result;
+        build_triangulation_input(particles, boundary, use_chains, input);
+        auto n0 = Clock::now();
+        bool ok = native_backend_.triangulate(input, result);
+        auto n1 = Clock::now();
+        if (ok) {
+            source_count_ = (unsigned int)input.points.size();
+            extract_result(input, result, particle_count);
+            auto n2 = Clock::now();
+            std::cout << "Native CDT generated" << (use_chains ? " (particle chains)" : "") << ": " << vertices_.size() << " vertices, "
+                << triangles_.size() << " triangles." << std::endl;
+            std::cout << "  [timing] triangulate " << ms(n0, n1) << " ms, extract " << ms(n1, n2) << " ms, total " << ms(t0, n2) << " ms" << std::endl;
+            return;
         }
-        v_prev = vh;
+        std::cout << "Native triangulation failed (constraint recovery), falling back to CGAL." << std::endl;
+        chains = cached_chains_;
+    }
+
+    // 约束拓扑不变时才能增量更新
+    bool can_update = incremental_ && cdt_valid_ && cached_boundary_ == &boundary
+        && cached_positions_.size() == particle_count && cached_use_chains_ == use_chains
+        && (!use_chains || chains == cached_chains_);
+
+    update_flips_ = update_in_place_ = update_reinserted_ = update_constrained_ = 0;
+    bool updated = can_update && update_triangulation(particles);
+    if (updated) incremental_calls_++;
+    else rebuild_calls_++;
+    if (!updated) {
+        cached_chains_ = std::move(chains);
+        rebuild_triangulation(particles, boundary, use_chains);
+    }
+    auto t1 = Clock::now();
+
+    // --- 步驟 4: 標記域 (哪些三角形在 "內部") ---
+    mark_domains(cdt_);
+    auto t2 = Clock::now();
+
+    // --- 步驟 5: 提取位於域內部的三角形 ---
+    extract_mesh(particle_count);
+    auto t3 = Clock::now();
+
+    std::cout << "CGAL generated (Constrained Domain Method" << (use_chains ? ", particle chains" : "") << "): " << vertices_.size() << " vertices, " << triangles_.size() << " triangles." << std::endl;
+    if (updated) {
+        std::cout << "  [timing] incremental update " << ms(t0, t1) << " ms (" << update_in_place_ << " moved in place, "
+            << update_reinserted_ << " re-inserted, " << update_constrained_ << " constrained, " << update_flips_ << " flips)";
     }
-    cdt.insert_constraint(v_prev, v_start); // 閉合外環
+    else {
+        std::cout << "  [timing] full triangulation " << ms(t0, t1) << " ms";
+    }
+    std::cout << " [incremental " << incremental_calls_ << " / " << (incremental_calls_ + rebuild_calls_) << " calls]";
+    std::cout << ", mark_domains " << ms(t1, t2) << " ms, extract " << ms(t2, t3) << " ms, total " << ms(t0, t3) << " ms" << std::endl;
+}
+
+// [新增] 从头构建 cdt_
+void CGALMeshGenerator::rebuild_triangulation(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary, bool use_chains) {
+    cdt_.clear();
+    cdt_valid_ = false;
 
-    // --- 步驟 2: 插入所有內洞約束 ---
-    for (const auto& hole_verts : holes_list) {
-        if (hole_verts.empty()) continue;
-        CDT::Vertex_handle h_v_start;
-        CDT::Vertex_handle h_v_prev;
-        for (const auto& p : hole_verts) {
-            CDT::Vertex_handle vh = cdt.insert(Point(p.x, p.y));
-            if (h_v_prev != nullptr) {
-                cdt.insert_constraint(h_v_prev, vh);
+    // 约束顶点的来源下标排在所有粒子之后
+    const unsigned int particle_count = (unsigned int)particles.size();
+    unsigned int next_source = particle_count;
+
+    // --- 步驟 1/2: 插入外邊界及所有內洞約束 (定义几何形状) ---
+    auto insert_ring = [&](const std::vector<glm::vec2>& ring) {
+        if (ring.empty()) return;
+        CDT::Vertex_handle v_start;
+        CDT::Vertex_handle v_prev;
+        for (const auto& p : ring) {
+            CDT::Vertex_handle vh = cdt_.insert(Point(p.x, p.y));
+            vh->info() = next_source++;
+            if (v_prev != nullptr) {
+                cdt_.insert_constraint(v_prev, vh);
             }
             else {
-                h_v_start = vh;
+                v_start = vh;
             }
-            h_v_prev = vh;
+            v_prev = vh;
+        }
+        cdt_.insert_constraint(v_prev, v_start); // 閉合
+    };
+    if (!use_chains) {
+        insert_ring(boundary.get_outer_boundary());
+        for (const auto& hole_verts : boundary.get_holes()) {
+            insert_ring(hole_verts);
         }
-        cdt.insert_constraint(h_v_prev, h_v_start); // 閉合內洞
     }
 
-    // --- 步驟 3: 插入所有 SPH 粒子 (核心修复) ---
-    // [修复] 我们必须插入所有粒子，包括边界粒子！
-    // 即使边界粒子的位置可能与约束边重合，CGAL 也会自动处理（分裂约束边）。
-    // 这样才能保证生成的网格边界顶点与 SPH 粒子一一对应。
-    std::vector<Point> all_points;
-    for (const auto& p : particles) {
-        // 移除 if (!p.is_boundary) 的判断
-        all_points.emplace_back(p.position.x, p.position.y);
+    // --- 步驟 3: 插入所有 SPH 粒子 (包括边界粒子) ---
+    // 带 info 的批量插入：CGAL 内部做空间排序，插入的同时写入粒子下标。
+    // 粒子与约束顶点重合时，该顶点的 info 被改写为粒子下标。
+    std::vector<std::pair<Point, unsigned int>> all_points;
+    all_points.reserve(particles.size());
+    cached_positions_.resize(particle_count);
+    for (unsigned int i = 0; i < particle_count; ++i) {
+        all_points.emplace_back(Point(particles[i].position.x, particles[i].position.y), i);
+        cached_positions_[i] = particles[i].position;
     }
-    // 批量插入比逐个插入效率更高
-    cdt.insert(all_points.begin(), all_points.end());
+    cdt_.insert(all_points.begin(), all_points.end());
 
-    // --- 步驟 4: 標記域 (哪些三角形在 "內部") ---
-    mark_domains(cdt);
+    // 按 info 建立 粒子 -> 顶点句柄 表 (重合的粒子共享一个顶点，只有其中一个拿到句柄)
+    particle_handles_.assign(particle_count, CDT::Vertex_handle());
+    for (auto vit = cdt_.finite_vertices_begin(); vit != cdt_.finite_vertices_end(); ++vit) {
+        if (vit->info() < particle_count) particle_handles_[vit->info()] = vit;
+    }
 
-    // --- 步驟 5: 提取位於域內部的三角形 ---
-    // 我们需要一个映射来将 CGAL 的顶点句柄转换为我们自己的索引
-    std::map<CDT::Vertex_handle, unsigned int> vertex_map;
+    if (use_chains) {
+        // 约束边直接连接已有顶点，不再需要点定位，也不会产生分裂约束边的额外顶点
+        // [修改] 与前面粒子重合的边界粒子没有句柄，按坐标插入即得到已有顶点 (与 CGALTriangulationBackend 相同)，
+        // 不能丢掉它的两条链边，否则边界环出现缺口，mark_domains 会漫过整个区域
+        auto chain_handle = [&](unsigned int particle) {
+            CDT::Vertex_handle vh = particle_handles_[particle];
+            if (vh != nullptr) return vh;
+            const glm::vec2& pos = particles[particle].position;
+            return cdt_.insert(Point(pos.x, pos.y));
+        };
+        size_t degenerate = 0;
+        for (const auto& chain : cached_chains_) {
+            for (size_t k = 0; k < chain.size(); ++k) {
+                CDT::Vertex_handle a = chain_handle(chain[k]);
+                CDT::Vertex_handle b = chain_handle(chain[(k + 1) % chain.size()]);
+                if (a == b) {
+                    degenerate++; // 相邻的两个链粒子重合，只有这种边可以跳过
+                    continue;
+                }
+                cdt_.insert_constraint(a, b);
+            }
+        }
+        if (degenerate > 0) {
+            std::cout << "  [chains] skipped " << degenerate << " zero-length chain edges (coincident boundary particles)" << std::endl;
+        }
+    }
 
-    for (auto fit = cdt.finite_faces_begin(); fit != cdt.finite_faces_end(); ++fit) {
-        // `in_domain()` 逻辑：奇数层级在内部 (1, 3...), 偶数层级在外部 (0, 2...)
-        // 0: 外部无限域
-        // 1: 外环内部
-        // 2: 内洞内部 (即多边形外部)
+    source_count_ = next_source;
+    cached_boundary_ = &boundary;
+    cached_use_chains_ = use_chains;
+    // 有重合粒子时无法逐个跟踪顶点，下次仍然完整重建
+    cdt_valid_ = std::find(particle_handles_.begin(), particle_handles_.end(), CDT::Vertex_handle()) == particle_handles_.end();
+}
+
+// [新增] 增量更新：逐个移动位置变化的粒子顶点。返回 false 时 cdt_ 需要完整重建
+bool CGALMeshGenerator::update_triangulation(const std::vector<Simulation2D::Particle>& particles) {
+    for (unsigned int i = 0; i < (unsigned int)particles.size(); ++i) {
+        const glm::vec2& pos = particles[i].position;
+        if (pos == cached_positions_[i]) continue;
+
+        CDT::Vertex_handle vh = particle_handles_[i];
+        Point p(pos.x, pos.y);
+        // [修改] 约束顶点 (粒子链上的粒子、落在多边形边上的粒子) 默认沿边界滑动，几乎每步都在动，
+        // 先解除它的约束，移动后再接回去，而不是整个重建
+        if (cdt_.are_there_incident_constraints(vh)) {
+            if (!move_constrained_vertex(i, p)) return false;
+            update_constrained_++;
+        }
+        else if (move_vertex_in_place(vh, p)) {
+            update_in_place_++;
+        }
+        else if (reinsert_vertex(i, p)) {
+            update_reinserted_++;
+        }
+        else {
+            return false;
+        }
+        cached_positions_[i] = pos;
+    }
+    return true;
+}
+
+// [新增] 新位置仍在顶点星形多边形的核内时，只改坐标不改拓扑，再用 Lawson 翻边恢复 Delaunay 性质。
+// 只有与该顶点相邻的面的外接圆发生了变化，因此从这些面的边开始检查即可
+bool CGALMeshGenerator::move_vertex_in_place(CDT::Vertex_handle vh, const Point& p) {
+    CDT::Face_circulator fc = cdt_.incident_faces(vh), done = fc;
+    std::vector<CDT::Face_handle> star;
+    do {
+        CDT::Face_handle f = fc;
+        if (cdt_.is_infinite(f)) return false; // 凸包顶点，移动可能破坏凸性
+        int k = f->index(vh);
+        if (CGAL::orientation(p, f->vertex(CDT::ccw(k))->point(), f->vertex(CDT::cw(k))->point()) != CGAL::LEFT_TURN) {
+            return false;
+        }
+        star.push_back(f);
+    } while (++fc != done);
+
+    vh->set_point(p);
+
+    std::vector<CDT::Edge> stack;
+    for (const auto& f : star) {
+        for (int j = 0; j < 3; ++j) stack.push_back(CDT::Edge(f, j));
+    }
+    while (!stack.empty()) {
+        CDT::Face_handle f = stack.back().first;
+        int j = stack.back().second;
+        stack.pop_back();
+        // is_flipable 已排除约束边、无限面，并做空圆测试
+        if (!cdt_.is_flipable(f, j)) continue;
+        CDT::Face_handle n = f->neighbor(j);
+        cdt_.flip(f, j);
+        update_flips_++;
+        for (int k = 0; k < 3; ++k) {
+            stack.push_back(CDT::Edge(f, k));
+            stack.push_back(CDT::Edge(n, k));
+        }
+    }
+    return true;
+}
+
+// [新增] 删除后在原邻域附近重新插入 (用邻居顶点的面做定位提示)
+bool CGALMeshGenerator::reinsert_vertex(unsigned int particle, const Point& p) {
+    CDT::Vertex_handle vh = particle_handles_[particle];
+    CDT::Face_handle f = vh->face();
+    int k = f->index(vh);
+    CDT::Vertex_handle neighbor = f->vertex(CDT::ccw(k));
+    if (cdt_.is_infinite(neighbor)) neighbor = f->vertex(CDT::cw(k));
+
+    cdt_.remove(vh);
+    size_t before = cdt_.number_of_vertices();
+    CDT::Vertex_handle nv = cdt_.insert(p, neighbor->face());
+    if (cdt_.number_of_vertices() == before) return false; // 与已有顶点重合
+
+    nv->info() = particle;
+    particle_handles_[particle] = nv;
+    return true;
+}
+
+// [新增] 约束顶点的移动：记下沿约束相连的两个邻居，解除约束后按普通顶点移动，再恢复约束。
+// 粒子链模式接回 邻居-顶点-邻居 两条链边；多边形模式下粒子只是把一条多边形边分成两段，
+// 恢复整条 邻居-邻居 边即可 (新位置恰好在边上时 CGAL 会再次在该顶点处分段，与重建结果一致)。
+// 新约束与其它约束相交 (需要构造交点) 时返回 false，由调用方完整重建
+bool CGALMeshGenerator::move_constrained_vertex(unsigned int particle, const Point& p) {
+    CDT::Vertex_handle vh = particle_handles_[particle];
+    std::vector<CDT::Vertex_handle> linked;
+    CDT::Face_circulator fc = cdt_.incident_faces(vh), done = fc;
+    do {
+        CDT::Face_handle f = fc;
+        int k = f->index(vh);
+        // 每条关联边恰好作为某个面的 (f, cw(k)) 出现一次
+        if (f->is_constrained(CDT::cw(k))) linked.push_back(f->vertex(CDT::ccw(k)));
+    } while (++fc != done);
+    if (linked.size() != 2) return false;
+    // 多边形模式下顶点与多边形角点重合时，移走它会丢掉角点
+    if (!cached_use_chains_ && CGAL::orientation(linked[0]->point(), vh->point(), linked[1]->point()) != CGAL::COLLINEAR) {
+        return false;
+    }
+
+    const size_t vertex_count = cdt_.number_of_vertices();
+    try {
+        cdt_.remove_incident_constraints(vh);
+        if (!move_vertex_in_place(vh, p) && !reinsert_vertex(particle, p)) return false;
+        vh = particle_handles_[particle];
+        if (cached_use_chains_) {
+            cdt_.insert_constraint(linked[0], vh);
+            cdt_.insert_constraint(vh, linked[1]);
+        }
+        else {
+            cdt_.insert_constraint(linked[0], linked[1]);
+        }
+    }
+    catch (...) {
+        return false; // 约束相交，cdt_ 状态不可再用，调用方会 clear 后重建
+    }
+    return cdt_.number_of_vertices() == vertex_count;
+}
+
+// 按首次出现的顺序编号 (与原先 map 版本输出顺序一致)，remap 为平表
+// [修改] 面信息记录输出下标，邻接直接取自 CDT 的面邻居
+void CGALMeshGenerator::extract_mesh(unsigned int particle_count) {
+    const unsigned int kUnassigned = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(source_count_, kUnassigned);
+    std::vector<CDT::Face_handle> faces;
+    faces.reserve(cdt_.number_of_faces());
+    vertices_.reserve(cdt_.number_of_vertices());
+    vertex_particles_.reserve(cdt_.number_of_vertices());
+    triangles_.reserve(cdt_.number_of_faces());
+
+    for (auto fit = cdt_.finite_faces_begin(); fit != cdt_.finite_faces_end(); ++fit) {
+        // 奇数层级在内部 (1, 3...), 偶数层级在外部 (0, 2...)
         if (fit->info().nesting_level % 2 == 1) {
             unsigned int v_indices[3];
             for (int i = 0; i < 3; ++i) {
                 CDT::Vertex_handle vh = fit->vertex(i);
-
-                // 如果是新頂點，添加到我們的頂點列表並記錄其索引
-                if (vertex_map.find(vh) == vertex_map.end()) {
-                    vertex_map[vh] = (unsigned int)vertices_.size();
+                unsigned int src = vh->info();
+                if (remap[src] == kUnassigned) {
+                    remap[src] = (unsigned int)vertices_.size();
                     vertices_.emplace_back(vh->point().x(), vh->point().y());
+                    vertex_particles_.push_back(src < particle_count ? (int)src : -1);
                 }
-                v_indices[i] = vertex_map[vh];
+                v_indices[i] = remap[src];
             }
-            // 添加这个合格的三角形
+            fit->info().index = (int)faces.size();
+            faces.push_back(fit);
             triangles_.push_back({ v_indices[0], v_indices[1], v_indices[2] });
         }
+        else {
+            fit->info().index = -1;
+        }
+    }
+
+    triangle_neighbors_.resize(faces.size() * 3);
+    for (size_t t = 0; t < faces.size(); ++t) {
+        for (int i = 0; i < 3; ++i) {
+            CDT::Face_handle nb = faces[t]->neighbor(i);
+            triangle_neighbors_[t * 3 + i] = cdt_.is_infinite(nb) ? -1 : nb->info().index;
+        }
+    }
+    build_boundary_flags();
+}
+
+void CGALMeshGenerator::build_boundary_flags() {
+    boundary_edge_flags_.assign(triangles_.size(), 0);
+    for (size_t t = 0; t < triangles_.size(); ++t) {
+        for (int i = 0; i < 3; ++i) {
+            if (triangle_neighbors_[t * 3 + i] < 0) boundary_edge_flags_[t] |= (uint8_t)(1u << i);
+        }
+    }
+}
+
+
+
+// [新增] 与 rebuild_triangulation 相同的来源编号：粒子在前，多边形约束顶点 (外环、各内洞) 在后
+void CGALMeshGenerator::build_triangulation_input(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary,
+    bool use_chains, TriangulationInput& input) const {
+    input.points.clear();
+    input.constraints.clear();
+    input.points.reserve(particles.size());
+    for (const auto& p : particles) input.points.push_back(p.position);
+
+    if (use_chains) {
+        for (const auto& chain : cached_chains_) {
+            for (size_t k = 0; k < chain.size(); ++k) input.constraints.emplace_back(chain[k], chain[(k + 1) % chain.size()]);
+        }
+        return;
+    }
+    auto add_ring = [&](const std::vector<glm::vec2>& ring) {
+        if (ring.empty()) return;
+        unsigned int first = (unsigned int)input.points.size();
+        unsigned int count = (unsigned int)ring.size();
+        input.points.insert(input.points.end(), ring.begin(), ring.end());
+        for (unsigned int k = 0; k < count; ++k) input.constraints.emplace_back(first + k, first + (k + 1) % count);
+    };
+    add_ring(boundary.get_outer_boundary());
+    for (const auto& hole : boundary.get_holes()) add_ring(hole);
+}
+
+// [新增] 后端结果 -> vertices_ / triangles_ (按首次出现的顺序编号)
+void CGALMeshGenerator::extract_result(const TriangulationInput& input, const TriangulationResult& result, unsigned int particle_count) {
+    const unsigned int kUnassigned = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(input.points.size(), kUnassigned);
+    vertices_.reserve(result.triangles.size() / 2 + 16);
+    vertex_particles_.reserve(result.triangles.size() / 2 + 16);
+    triangles_.reserve(result.triangles.size());
+    for (const auto& t : result.triangles) {
+        unsigned int v_indices[3];
+        for (int i = 0; i < 3; ++i) {
+            unsigned int src = t[i];
+            if (remap[src] == kUnassigned) {
+                remap[src] = (unsigned int)vertices_.size();
+                vertices_.push_back(input.points[src]);
+                vertex_particles_.push_back(src < particle_count ? (int)src : -1);
+            }
+            v_indices[i] = remap[src];
+        }
+        triangles_.push_back({ v_indices[0], v_indices[1], v_indices[2] });
+    }
+
+    // 后端给出的邻接与三角形同序，直接展开为平表
+    if (result.neighbors.size() == result.triangles.size()) {
+        triangle_neighbors_.resize(result.neighbors.size() * 3);
+        for (size_t t = 0; t < result.neighbors.size(); ++t) {
+            for (int i = 0; i < 3; ++i) triangle_neighbors_[t * 3 + i] = result.neighbors[t][i];
+        }
+        build_boundary_flags();
+    }
+}
+
+// ================= CGAL 后端 (参考实现) =================
+bool CGALTriangulationBackend::triangulate(const TriangulationInput& input, TriangulationResult& result) {
+    result.triangles.clear();
+    result.neighbors.clear();
+    CDT cdt;
+    std::vector<std::pair<Point, unsigned int>> points;
+    points.reserve(input.points.size());
+    for (unsigned int i = 0; i < (unsigned int)input.points.size(); ++i) {
+        points.emplace_back(Point(input.points[i].x, input.points[i].y), i);
+    }
+    cdt.insert(points.begin(), points.end());
+
+    std::vector<CDT::Vertex_handle> handles(input.points.size());
+    for (auto vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); ++vit) handles[vit->info()] = vit;
+    for (const auto& c : input.constraints) {
+        // 重合点只有一个拿到句柄，按坐标重新定位
+        CDT::Vertex_handle a = handles[c.first] != nullptr ? handles[c.first] : cdt.insert(points[c.first].first);
+        CDT::Vertex_handle b = handles[c.second] != nullptr ? handles[c.second] : cdt.insert(points[c.second].first);
+        if (a != b) cdt.insert_constraint(a, b);
+    }
+    mark_domains(cdt);
+
+    std::vector<CDT::Face_handle> faces;
+    for (auto fit = cdt.finite_faces_begin(); fit != cdt.finite_faces_end(); ++fit) {
+        if (fit->info().nesting_level % 2 == 1) {
+            fit->info().index = (int)faces.size();
+            faces.push_back(fit);
+            result.triangles.push_back({ fit->vertex(0)->info(), fit->vertex(1)->info(), fit->vertex(2)->info() });
+        }
+        else {
+            fit->info().index = -1;
+        }
+    }
+    result.neighbors.resize(faces.size());
+    for (size_t k = 0; k < faces.size(); ++k) {
+        for (int i = 0; i < 3; ++i) {
+            CDT::Face_handle nb = faces[k]->neighbor(i);
+            result.neighbors[k][i] = cdt.is_infinite(nb) ? -1 : nb->info().index;
+        }
+    }
+    return true;
+}
+
+// [新增] 当前 cdt_ 中的域内三角形 (顶点 info，即来源下标)
+void CGALMeshGenerator::collect_domain_triangles(std::vector<std::array<unsigned int, 3>>& out) const {
+    out.clear();
+    for (auto fit = cdt_.finite_faces_begin(); fit != cdt_.finite_faces_end(); ++fit) {
+        if (fit->info().nesting_level % 2 == 1) {
+            out.push_back({ fit->vertex(0)->info(), fit->vertex(1)->info(), fit->vertex(2)->info() });
+        }
     }
+}
 
-    std::cout << "CGAL generated (Constrained Domain Method): " << vertices_.size() << " vertices, " << triangles_.size() << " triangles." << std::endl;
+// ================= 分块并行三角化 =================
+//
+// 1. 按 x 分位数把点切成若干条带，每条带向两侧扩展 margin 得到扩展区间，
+//    扩展区间内的点和与之相交的约束段构成一个子问题，各线程独立做 CDT。
+// 2. 子问题中的三角形若外接圆完全落在扩展区间内，则圆内不可能有子问题之外的点/约束，
+//    它必然也是全局 CDT 的三角形；再要求外心落在条带核心区间内，保证每个三角形只被一个条带认领。
+// 3. 未被认领的区域 (接缝 + 凸包附近) 的边界边作为约束，和剩余点一起再做一次 CDT，
+//    取其中位于已认领区域之外的三角形。
+// 4. 在拼合后的网格上按原始约束重新做嵌套层级标记。
+namespace {
+    struct DPoint { double x, y; };
+
+    struct FlatTriangle {
+        unsigned int v[3];          // 逆时针
+        bool constrained[3];        // 边 i (对着顶点 i) 是否为原始约束
+    };
+
+    inline uint64_t edge_key(unsigned int a, unsigned int b) {
+        if (a > b) std::swap(a, b);
+        return ((uint64_t)a << 32) | b;
+    }
+
+    // 顶点按下标排序后计算外接圆，保证不同条带对同一三角形得到完全相同的结果
+    bool circumcircle(const std::vector<DPoint>& pts, unsigned int a, unsigned int b, unsigned int c, DPoint& center, double& radius) {
+        unsigned int s[3] = { a, b, c };
+        std::sort(s, s + 3);
+        const DPoint& p = pts[s[0]];
+        double bx = pts[s[1]].x - p.x, by = pts[s[1]].y - p.y;
+        double cx = pts[s[2]].x - p.x, cy = pts[s[2]].y - p.y;
+        double d = 2.0 * (bx * cy - by * cx);
+        if (d == 0.0) return false;
+        double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+        double ux = (cy * b2 - by * c2) / d;
+        double uy = (bx * c2 - cx * b2) / d;
+        center = { p.x + ux, p.y + uy };
+        radius = std::sqrt(ux * ux + uy * uy);
+        return true;
+    }
+
+    // 在拼合后的三角形上做嵌套层级标记 (与 mark_domains 相同的规则：从外部出发，每穿过一条约束边 +1)
+    void mark_flat_domains(const std::vector<FlatTriangle>& tris, std::vector<int>& level, std::vector<int>& twin) {
+        const size_t n = tris.size();
+        // [修改] 半边配对用平铺边表 (基数排序)，不再逐边插入哈希表
+        std::vector<uint64_t> keys(n * 3);
+        for (size_t t = 0; t < n; ++t) {
+            for (int i = 0; i < 3; ++i) keys[t * 3 + i] = edge_key(tris[t].v[(i + 1) % 3], tris[t].v[(i + 2) % 3]);
+        }
+        EdgeTable table;
+        table.build(keys);
+        twin = table.twins();
+
+        level.assign(n, -1);
+        std::vector<std::pair<int, int>> border; // (三角形, 层级)，先进先出
+        std::vector<int> queue;
+        auto flood = [&](int start, int lvl) {
+            if (level[start] != -1) return;
+            level[start] = lvl;
+            queue.assign(1, start);
+            while (!queue.empty()) {
+                int t = queue.back();
+                queue.pop_back();
+                for (int i = 0; i < 3; ++i) {
+                    int h = twin[t * 3 + i];
+                    if (h < 0) continue;
+                    int nt = h / 3;
+                    if (level[nt] != -1) continue;
+                    if (tris[t].constrained[i]) {
+                        border.emplace_back(nt, lvl + 1);
+                    }
+                    else {
+                        level[nt] = lvl;
+                        queue.push_back(nt);
+                    }
+                }
+            }
+        };
+
+        // 凸包边的另一侧就是外部 (层级 0)
+        std::vector<std::pair<int, int>> hull_border;
+        for (size_t t = 0; t < n; ++t) {
+            for (int i = 0; i < 3; ++i) {
+                if (twin[t * 3 + i] >= 0) continue;
+                if (tris[t].constrained[i]) hull_border.emplace_back((int)t, 1);
+                else flood((int)t, 0);
+            }
+        }
+        border.insert(border.begin(), hull_border.begin(), hull_border.end());
+        for (size_t head = 0; head < border.size(); ++head) {
+            flood(border[head].first, border[head].second);
+        }
+    }
 }
 
+bool CGALMeshGenerator::generate_tiled(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary, bool use_chains) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    auto t0 = Clock::now();
+
+    // --- 1. 全局点表 (粒子在前，多边形顶点在后，与串行版本的来源下标一致) 和约束段 ---
+    const unsigned int particle_count = (unsigned int)particles.size();
+    TriangulationInput input;
+    build_triangulation_input(particles, boundary, use_chains, input);
+    const unsigned int source_count = (unsigned int)input.points.size();
+    source_count_ = source_count;
+    std::vector<DPoint> pts(source_count);
+    for (unsigned int i = 0; i < source_count; ++i) pts[i] = { input.points[i].x, input.points[i].y };
+
+    // 重合点合并到最小下标 (粒子优先于多边形顶点)，各子问题中只出现代表点
+    source_canonical_ = canonical_source_ids(input.points);
+    std::vector<std::pair<unsigned int, unsigned int>> constraints;
+    constraints.reserve(input.constraints.size());
+    for (const auto& c : input.constraints) constraints.emplace_back(source_canonical_[c.first], source_canonical_[c.second]);
+    std::vector<double> xs;
+    xs.reserve(source_count);
+    for (unsigned int i = 0; i < source_count; ++i) {
+        if (source_canonical_[i] == i) xs.push_back(pts[i].x);
+    }
+    std::sort(xs.begin(), xs.end());
+    if (xs.size() < 3) return false;
+
+    // --- 2. 条带划分：核心区间按 x 分位数等分点数，重叠宽度取几倍平均点距 ---
+    const int tiles = std::max(1, std::min(tile_count_, (int)xs.size() / 64));
+    if (tiles < 2) return false;
+    double min_y = DBL_MAX, max_y = -DBL_MAX;
+    for (const auto& p : pts) { min_y = std::min(min_y, p.y); max_y = std::max(max_y, p.y); }
+    double area = std::max((xs.back() - xs.front()) * (max_y - min_y), 1e-12);
+    const double margin = 4.0 * std::sqrt(area / xs.size());
+
+    std::vector<double> cuts(tiles + 1);
+    cuts[0] = -DBL_MAX;
+    cuts[tiles] = DBL_MAX;
+    for (int k = 1; k < tiles; ++k) cuts[k] = xs[xs.size() * k / tiles];
 
+    std::vector<std::vector<FlatTriangle>> tile_tris(tiles);
+    auto t1 = Clock::now();
+
+    parallel_for(0, (size_t)tiles, [&](size_t k) {
+        const double core_lo = cuts[k], core_hi = cuts[k + 1];
+        const double ext_lo = (k == 0) ? -DBL_MAX : core_lo - margin;
+        const double ext_hi = (k + 1 == (size_t)tiles) ? DBL_MAX : core_hi + margin;
+
+        std::vector<std::pair<Point, unsigned int>> input;
+        std::vector<char> included(source_count, 0);
+        auto include = [&](unsigned int id) {
+            if (included[id]) return;
+            included[id] = 1;
+            input.emplace_back(Point(pts[id].x, pts[id].y), id);
+        };
+        for (unsigned int id = 0; id < source_count; ++id) {
+            if (source_canonical_[id] == id && pts[id].x >= ext_lo && pts[id].x <= ext_hi) include(id);
+        }
+        std::vector<std::pair<unsigned int, unsigned int>> local_constraints;
+        for (const auto& c : constraints) {
+            double lo = std::min(pts[c.first].x, pts[c.second].x), hi = std::max(pts[c.first].x, pts[c.second].x);
+            if (c.first == c.second || hi < ext_lo || lo > ext_hi) continue;
+            include(c.first);
+            include(c.second);
+            local_constraints.push_back(c);
+        }
+
+        CDT cdt;
+        cdt.insert(input.begin(), input.end());
+        if (!local_constraints.empty()) {
+            std::vector<CDT::Vertex_handle> handles(source_count);
+            for (auto vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); ++vit) handles[vit->info()] = vit;
+            for (const auto& c : local_constraints) cdt.insert_constraint(handles[c.first], handles[c.second]);
+        }
+
+        auto& out = tile_tris[k];
+        for (auto fit = cdt.finite_faces_begin(); fit != cdt.finite_faces_end(); ++fit) {
+            unsigned int a = fit->vertex(0)->info(), b = fit->vertex(1)->info(), c = fit->vertex(2)->info();
+            DPoint cc;
+            double r;
+            if (!circumcircle(pts, a, b, c, cc, r)) continue;
+            if (cc.x < core_lo || cc.x >= core_hi) continue;
+            double slack = 1e-9 * (std::abs(cc.x) + r + 1.0);
+            if (cc.x - r - slack < ext_lo || cc.x + r + slack > ext_hi) continue;
+            FlatTriangle t{ { a, b, c }, { fit->is_constrained(0), fit->is_constrained(1), fit->is_constrained(2) } };
+            out.push_back(t);
+        }
+    }, (unsigned int)tiles);
+    auto t2 = Clock::now();
+
+    std::vector<FlatTriangle> tris;
+    size_t final_count = 0;
+    for (const auto& tt : tile_tris) final_count += tt.size();
+    tris.reserve(final_count + final_count / 8);
+    for (const auto& tt : tile_tris) tris.insert(tris.end(), tt.begin(), tt.end());
+
+    // --- 3. 接缝：已认领区域的边界边 (只出现一次的边) 作为约束 ---
+    std::vector<char> used(source_count, 0);
+    std::unordered_map<uint64_t, int> boundary_edges; // 边 -> 半边 (三角形 * 3 + i)，认领区域在其左侧
+    boundary_edges.reserve(final_count);
+    for (size_t t = 0; t < tris.size(); ++t) {
+        for (int i = 0; i < 3; ++i) {
+            used[tris[t].v[i]] = 1;
+            uint64_t key = edge_key(tris[t].v[(i + 1) % 3], tris[t].v[(i + 2) % 3]);
+            auto it = boundary_edges.find(key);
+            if (it != boundary_edges.end()) boundary_edges.erase(it);
+            else boundary_edges.emplace(key, (int)(t * 3 + i));
+        }
+    }
+
+    std::vector<std::pair<Point, unsigned int>> seam_input;
+    std::vector<char> in_seam(source_count, 0);
+    auto add_seam = [&](unsigned int id) {
+        if (in_seam[id]) return;
+        in_seam[id] = 1;
+        seam_input.emplace_back(Point(pts[id].x, pts[id].y), id);
+    };
+    for (unsigned int id = 0; id < source_count; ++id) {
+        if (source_canonical_[id] == id && !used[id]) add_seam(id);
+    }
+    for (const auto& be : boundary_edges) {
+        const FlatTriangle& t = tris[be.second / 3];
+        int i = be.second % 3;
+        add_seam(t.v[(i + 1) % 3]);
+        add_seam(t.v[(i + 2) % 3]);
+    }
+    for (const auto& c : constraints) {
+        if (c.first == c.second) continue;
+        add_seam(c.first);
+        add_seam(c.second);
+    }
+
+    CDT seam;
+    seam.insert(seam_input.begin(), seam_input.end());
+    std::vector<CDT::Vertex_handle> handles(source_count);
+    for (auto vit = seam.finite_vertices_begin(); vit != seam.finite_vertices_end(); ++vit) handles[vit->info()] = vit;
+    for (const auto& be : boundary_edges) {
+        const FlatTriangle& t = tris[be.second / 3];
+        int i = be.second % 3;
+        seam.insert_constraint(handles[t.v[(i + 1) % 3]], handles[t.v[(i + 2) % 3]]);
+    }
+    for (const auto& c : constraints) {
+        if (c.first != c.second) seam.insert_constraint(handles[c.first], handles[c.second]);
+    }
+
+    // 标记接缝 CDT 中位于已认领区域内的面 (从每条边界边左侧出发，不跨越边界边)
+    for (auto fit = seam.all_faces_begin(); fit != seam.all_faces_end(); ++fit) fit->info().nesting_level = 0;
+    std::vector<CDT::Face_handle> stack;
+    for (const auto& be : boundary_edges) {
+        const FlatTriangle& t = tris[be.second / 3];
+        int i = be.second % 3;
+        CDT::Vertex_handle va = handles[t.v[(i + 1) % 3]], vb = handles[t.v[(i + 2) % 3]];
+        CDT::Face_handle fh;
+        int fi;
+        if (!seam.is_edge(va, vb, fh, fi)) return false; // 边界边被接缝点切开，无法拼合
+        if (fh->vertex(CDT::ccw(fi)) != va) fh = fh->neighbor(fi);
+        if (seam.is_infinite(fh)) return false;
+        if (fh->info().nesting_level == 0) {
+            fh->info().nesting_level = 1;
+            stack.push_back(fh);
+        }
+    }
+    while (!stack.empty()) {
+        CDT::Face_handle fh = stack.back();
+        stack.pop_back();
+        for (int i = 0; i < 3; ++i) {
+            CDT::Face_handle nh = fh->neighbor(i);
+            if (seam.is_infinite(nh) || nh->info().nesting_level != 0) continue;
+            uint64_t key = edge_key(fh->vertex(CDT::ccw(i))->info(), fh->vertex(CDT::cw(i))->info());
+            if (boundary_edges.count(key)) continue;
+            nh->info().nesting_level = 1;
+            stack.push_back(nh);
+        }
+    }
+
+    size_t seam_count = 0;
+    for (auto fit = seam.finite_faces_begin(); fit != seam.finite_faces_end(); ++fit) {
+        if (fit->info().nesting_level != 0) continue;
+        FlatTriangle t;
+        for (int i = 0; i < 3; ++i) t.v[i] = fit->vertex(i)->info();
+        for (int i = 0; i < 3; ++i) {
+            // 边界边上的约束是人为加的，只保留其在条带中的原始约束标记
+            auto it = boundary_edges.find(edge_key(t.v[(i + 1) % 3], t.v[(i + 2) % 3]));
+            if (it != boundary_edges.end()) t.constrained[i] = tris[it->second / 3].constrained[it->second % 3];
+            else t.constrained[i] = fit->is_constrained(i);
+        }
+        tris.push_back(t);
+        seam_count++;
+    }
+    auto t3 = Clock::now();
+
+    // --- 4. 嵌套层级标记 + 提取 ---
+    std::vector<int> level, twin;
+    mark_flat_domains(tris, level, twin);
+
+    const unsigned int kUnassigned = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(source_count, kUnassigned);
+    tiled_source_triangles_.clear();
+    vertices_.reserve(xs.size());
+    vertex_particles_.reserve(xs.size());
+    triangles_.reserve(tris.size());
+    std::vector<int> out_index(tris.size(), -1);
+    for (size_t t = 0; t < tris.size(); ++t) {
+        if (level[t] % 2 != 1) continue;
+        out_index[t] = (int)triangles_.size();
+        unsigned int v_indices[3];
+        for (int i = 0; i < 3; ++i) {
+            unsigned int src = tris[t].v[i];
+            if (remap[src] == kUnassigned) {
+                remap[src] = (unsigned int)vertices_.size();
+                vertices_.emplace_back((float)pts[src].x, (float)pts[src].y);
+                vertex_particles_.push_back(src < particle_count ? (int)src : -1);
+            }
+            v_indices[i] = remap[src];
+        }
+        triangles_.push_back({ v_indices[0], v_indices[1], v_indices[2] });
+        tiled_source_triangles_.push_back({ tris[t].v[0], tris[t].v[1], tris[t].v[2] });
+    }
+    // 半边配对 (twin) 在标记层级时已建好，换算成输出下标即为邻接
+    triangle_neighbors_.resize(triangles_.size() * 3);
+    for (size_t t = 0; t < tris.size(); ++t) {
+        if (out_index[t] < 0) continue;
+        for (int i = 0; i < 3; ++i) {
+            int h = twin[t * 3 + i];
+            triangle_neighbors_[(size_t)out_index[t] * 3 + i] = h < 0 ? -1 : out_index[h / 3];
+        }
+    }
+    build_boundary_flags();
+    auto t4 = Clock::now();
+
+    std::cout << "CGAL generated (tiled x" << tiles << (use_chains ? ", particle chains" : "") << "): " << vertices_.size()
+        << " vertices, " << triangles_.size() << " triangles (" << final_count << " from tiles, " << seam_count << " from seam)." << std::endl;
+    std::cout << "  [timing] setup " << ms(t0, t1) << " ms, tiles " << ms(t1, t2) << " ms, seam " << ms(t2, t3)
+        << " ms, mark+extract " << ms(t3, t4) << " ms" << std::endl;
+    return true;
+}
+
+// [新增] 每个边界环的粒子按弧长排序，得到闭合的约束链
+bool CGALMeshGenerator::build_particle_chains(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary,
+    std::vector<std::vector<unsigned int>>& chains) {
+    chains.assign(boundary.get_ring_count(), {});
+    for (unsigned int i = 0; i < (unsigned int)particles.size(); ++i) {
+        const auto& p = particles[i];
+        if (!p.is_boundary) continue;
+        if (p.ring_id < 0 || p.ring_id >= (int)chains.size()) return false;
+        chains[p.ring_id].push_back(i);
+    }
+    for (auto& chain : chains) {
+        if (chain.size() < 3) return false;
+        std::sort(chain.begin(), chain.end(), [&](unsigned int a, unsigned int b) {
+            if (particles[a].arc_s != particles[b].arc_s) return particles[a].arc_s < particles[b].arc_s;
+            return a < b;
+        });
+    }
+    return true;
+}
 
 //void mark_domains(CDT& cdt) {
 //    for (auto fit = cdt.all_faces_begin(); fit != cdt.all_faces_end(); ++fit) {
@@ -126,36 +945,44 @@ void CGALMeshGenerator::generate_mesh(const std::vector<Simulation2D::Particle>&
 // --- [新增] CGAL 域标记辅助函数 ---
 // 標記 Cdt 域的嵌套級別 (这是CGAL处理带孔多边形的标准方法)
 // 0 = 外部无限区域, 1 = 内部, 2 = 内部的洞, 3 = 洞里的岛...
+// [修改] 用 -1 表示未访问：原来用 0 同时表示 "未访问" 和 "外部层级"，
+// 层级为 0 的面会被反复入队。现在先把同一层级的区域整片填满，再跨过约束边进入下一层级，
+// 这样层级严格等于从外部到达该面需要穿过的约束边数 (与 mark_flat_domains 规则一致)
 void mark_domains(CDT& cdt) {
     for (auto fit = cdt.all_faces_begin(); fit != cdt.all_faces_end(); ++fit) {
-        fit->info().nesting_level = 0;
+        fit->info().nesting_level = -1;
     }
 
-    // 从无限面（外部）开始广度优先搜索
+    std::vector<CDT::Edge> border;   // 先进先出：待跨越的约束边
     std::vector<CDT::Face_handle> q;
-    q.push_back(cdt.infinite_face());
-    q.front()->info().nesting_level = 0;
-
-    std::size_t head = 0;
-    while (head < q.size()) {
-        CDT::Face_handle fh = q[head++];
-        int current_level = fh->info().nesting_level;
-
-        for (int i = 0; i < 3; ++i) {
-            CDT::Face_handle nfh = fh->neighbor(i);
-            // 如果邻居还没有被标记
-            if (nfh->info().nesting_level == 0 && nfh != cdt.infinite_face()) {
-                // 检查公共边是否是约束边
+    auto flood = [&](CDT::Face_handle start, int level) {
+        if (start->info().nesting_level != -1) return;
+        start->info().nesting_level = level;
+        q.assign(1, start);
+        while (!q.empty()) {
+            CDT::Face_handle fh = q.back();
+            q.pop_back();
+            for (int i = 0; i < 3; ++i) {
+                CDT::Face_handle nfh = fh->neighbor(i);
+                if (nfh->info().nesting_level != -1) continue;
                 if (cdt.is_constrained(CDT::Edge(fh, i))) {
-                    // 穿过约束边，嵌套级别 +1
-                    nfh->info().nesting_level = current_level + 1;
+                    // 穿过约束边，留给下一层级
+                    border.push_back(CDT::Edge(fh, i));
                 }
                 else {
                     // 未穿过约束边，级别保持不变
-                    nfh->info().nesting_level = current_level;
+                    nfh->info().nesting_level = level;
+                    q.push_back(nfh);
                 }
-                q.push_back(nfh);
             }
         }
+    };
+
+    // 从无限面（外部）开始
+    flood(cdt.infinite_face(), 0);
+    for (std::size_t head = 0; head < border.size(); ++head) {
+        CDT::Face_handle fh = border[head].first;
+        CDT::Face_handle nfh = fh->neighbor(border[head].second);
+        flood(nfh, fh->info().nesting_level + 1);
     }
 }
@@ -1,19 +1,25 @@
 ﻿#pragma once
 #include <vector>
+#include <array>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include "Simulation2D.h"
 #include "Boundary.h"
+#include "TriangulationBackend.h"
+#include "NativeDelaunay.h"
 
 // --- 关键修复：定义正确的CGAL类型 ---
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Constrained_Delaunay_triangulation_2.h>
 #include <CGAL/Triangulation_face_base_with_info_2.h>
+#include <CGAL/Triangulation_vertex_base_with_info_2.h>
 #include <CGAL/Constrained_triangulation_face_base_2.h> // <-- 必须包含这个头文件
 
 // 区域内/外标记
 struct FaceInfo2 {
     bool in_domain() const { return nesting_level % 2 == 1; }
     int nesting_level = 0;
+    int index = -1; // [新增] 提取后在 triangles_ 中的下标 (-1 = 不在域内)
 };
 
 // CGAL 内核
@@ -24,7 +30,9 @@ using Cfb = CGAL::Constrained_triangulation_face_base_2<K>;
 using Fbb = CGAL::Triangulation_face_base_with_info_2<FaceInfo2, K, Cfb>;
 
 // 顶点和数据结构
-using Vb = CGAL::Triangulation_vertex_base_2<K>;
+// [修改] 顶点携带来源索引：[0, 粒子数) 为粒子，之后为多边形约束顶点，
+// 插入时写入，提取网格时直接查平表，不再需要 std::map<Vertex_handle, ...>
+using Vb = CGAL::Triangulation_vertex_base_with_info_2<unsigned int, K>;
 using Tds = CGAL::Triangulation_data_structure_2<Vb, Fbb>;
 
 // 最终的约束德劳内三角剖分类型
@@ -33,6 +41,15 @@ using Point = CDT::Point;
 // --- 结束 ---
 
 
+enum class MeshOrdering; // MeshReorder.h
+
+// [新增] CGAL 实现的三角化后端 (参考结果，用于校验其他后端)
+class CGALTriangulationBackend : public TriangulationBackend {
+public:
+    const char* name() const override { return "cgal"; }
+    bool triangulate(const TriangulationInput& input, TriangulationResult& result) override;
+};
+
 class CGALMeshGenerator {
 public:
     struct Triangle {
@@ -43,19 +60,117 @@ public:
         unsigned int v0, v1, v2, v3;
     };
 
+    // [新增] 边界约束的来源
+    //   Polygon:       原始外环/内洞多边形顶点 (粒子落在约束边上时由 CGAL 分裂)
+    //   ParticleChain: 每个环上的边界粒子按弧长排序后首尾相连，网格顶点全部来自粒子
+    enum class ConstraintMode { Polygon, ParticleChain };
+
     CGALMeshGenerator() = default;
     ~CGALMeshGenerator() = default;
 
+    void set_constraint_mode(ConstraintMode mode) { constraint_mode_ = mode; }
+    ConstraintMode get_constraint_mode() const { return constraint_mode_; }
+
+    // [新增] 增量重网格：保留上一次的三角剖分，只移动变化的粒子顶点。
+    // 约束 / 边界 / 粒子数变化时自动退回完整重建
+    void set_incremental(bool enabled) { incremental_ = enabled; }
+    bool get_incremental() const { return incremental_; }
+    void invalidate() { cdt_valid_ = false; }
+
+    // [新增] 分块并行三角化：按 x 方向切成 tiles 条带 (带重叠)，各线程独立构建 CDT，
+    // 再对接缝区域做一次约束三角化拼合。tiles <= 1 时为串行。
+    // validate 打开时额外跑一次串行版本并比较三角形集合
+    void set_tile_count(int tiles) { tile_count_ = tiles; }
+    void set_validate_tiles(bool validate) { validate_tiles_ = validate; }
+
+    // [新增] 三角化后端：CGAL (默认，支持增量/分块) 或 Native (平铺数组实现)。
+    // 与 CGAL 的交叉校验见 main.cpp 的 --validate-backend
+    enum class Backend { CGAL, Native };
+    void set_backend(Backend backend) { backend_ = backend; }
+    Backend get_backend() const { return backend_; }
+
+    // [新增] 顶点 / 三角形重排方式 (RCM 或 Hilbert)，下游 (Qmorph、导出) 直接沿用该顺序
+    // [修改] generate_mesh 不再自动重排 (实时预览每帧都会生成网格)；调用方对最终要转换 / 导出的网格调用一次 reorder_mesh()
+    void set_reorder(MeshOrdering ordering) { reorder_ = ordering; }
+    MeshOrdering get_reorder() const { return reorder_; }
+
     // 函数签名现在是正确的
     void generate_mesh(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary);
+    // 未设置重排方式、网格为空或当前网格已经重排过时什么都不做
+    void reorder_mesh();
 
     const std::vector<glm::vec2>& get_vertices() const { return vertices_; }
     const std::vector<Triangle>& get_triangles() const { return triangles_; }
     const std::vector<Quad>& get_quads() const { return quads_; }
 
+    // [新增] 网格顶点 -> 粒子下标 (-1 表示仅属于边界多边形的顶点)
+    const std::vector<int>& get_vertex_particles() const { return vertex_particles_; }
+
+    // [新增] 三角形邻接 (提取时直接取自三角剖分，与 triangles_ 一一对应)：
+    // get_triangle_neighbors()[3t+i] 为跨过 "对着角点 i 的边" 的三角形，-1 表示域边界；
+    // get_boundary_edge_flags()[t] 的第 i 位表示这条边在域边界上
+    const std::vector<int>& get_triangle_neighbors() const { return triangle_neighbors_; }
+    const std::vector<uint8_t>& get_boundary_edge_flags() const { return boundary_edge_flags_; }
+
+    // 按 (ring_id, arc_s) 收集边界粒子链，任何环少于 3 个粒子时返回 false
+    // [修改] 改为公开的静态函数 (DirectQuadBuilder 也使用)
+    static bool build_particle_chains(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary,
+        std::vector<std::vector<unsigned int>>& chains);
+
 private:
+    // [新增] generate_mesh 的主体 (三种后端路径)
+    void build_mesh(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary);
+
+    // [新增] 完整重建 / 增量更新 cdt_，之后统一标记区域并提取
+    void rebuild_triangulation(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary, bool use_chains);
+    bool update_triangulation(const std::vector<Simulation2D::Particle>& particles);
+    bool move_vertex_in_place(CDT::Vertex_handle vh, const Point& p);
+    bool reinsert_vertex(unsigned int particle, const Point& p);
+    bool move_constrained_vertex(unsigned int particle, const Point& p);
+    void extract_mesh(unsigned int particle_count);
+
+    // [新增] 分块并行路径，失败 (接缝无法拼合) 时返回 false，由调用方退回串行
+    bool generate_tiled(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary, bool use_chains);
+    // 串行结果的域内三角形 (来源下标)，用于校验分块结果
+    void collect_domain_triangles(std::vector<std::array<unsigned int, 3>>& out) const;
+
+    // [新增] 后端输入 (来源编号与 rebuild_triangulation 一致) 及结果提取
+    void build_triangulation_input(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary,
+        bool use_chains, TriangulationInput& input) const;
+    void extract_result(const TriangulationInput& input, const TriangulationResult& result, unsigned int particle_count);
+    // [新增] 由 triangle_neighbors_ 生成 boundary_edge_flags_
+    void build_boundary_flags();
+
+    ConstraintMode constraint_mode_ = ConstraintMode::Polygon;
+
+    // [新增] 跨调用保留的三角剖分
+    CDT cdt_;
+    bool cdt_valid_ = false;
+    bool incremental_ = true;
+    std::vector<CDT::Vertex_handle> particle_handles_; // 粒子 -> 顶点 (重合粒子为空)
+    std::vector<glm::vec2> cached_positions_;          // 上次三角化时的粒子位置
+    unsigned int source_count_ = 0;                     // 粒子 + 多边形约束顶点
+    const Boundary* cached_boundary_ = nullptr;
+    bool cached_use_chains_ = false;
+    std::vector<std::vector<unsigned int>> cached_chains_;
+    size_t update_flips_ = 0, update_in_place_ = 0, update_reinserted_ = 0, update_constrained_ = 0;
+    size_t incremental_calls_ = 0, rebuild_calls_ = 0;  // 累计：增量路径实际生效的次数 / 完整重建次数
+
+    int tile_count_ = 0;
+    bool validate_tiles_ = false;
+    std::vector<std::array<unsigned int, 3>> tiled_source_triangles_; // 分块结果 (来源下标，校验用)
+    std::vector<unsigned int> source_canonical_;                      // 重合点 -> 最小来源下标
+
+    Backend backend_ = Backend::CGAL;
+    NativeTriangulationBackend native_backend_;
+
     std::vector<glm::vec2> vertices_;
+    std::vector<int> vertex_particles_;
     std::vector<Triangle> triangles_;
+    std::vector<int> triangle_neighbors_;
+    std::vector<uint8_t> boundary_edge_flags_;
     std::vector<Quad> quads_; // 新增
+    MeshOrdering reorder_ = MeshOrdering(); // None
+    bool mesh_reordered_ = false;
 
 };
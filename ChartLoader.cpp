@@ -0,0 +1,210 @@
+﻿#include "ChartLoader.h"
+#include "MappedFile.h"
+#include "ParallelFor.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    // 与 std::isspace 在 "C" locale 下的集合一致 (istream >> float 跳过的字符)
+    inline bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    // 解析一个浮点数：跳过前导空白，允许 '+' 号 (istream 接受，from_chars 不接受)
+    inline bool parse_float(const char*& p, const char* end, float& out) {
+        while (p < end && is_space(*p)) ++p;
+        if (p < end && *p == '+') ++p;
+        auto res = std::from_chars(p, end, out);
+        if (res.ec != std::errc()) return false;
+        p = res.ptr;
+        return true;
+    }
+
+    // 严格解析十进制非负整数 (整个字符串都必须是数字)
+    bool parse_index(const std::string& s, int& out) {
+        if (s.empty()) return false;
+        auto res = std::from_chars(s.data(), s.data() + s.size(), out);
+        return res.ec == std::errc() && res.ptr == s.data() + s.size() && out >= 0
+            && std::to_string(out) == s; // 拒绝 "01" 这类 load_chart_by_index 拼不出的名字
+    }
+
+    // directory_entry 在 Windows 上缓存了大小和时间，不会额外打开文件
+    FileStamp make_stamp(const fs::directory_entry& entry) {
+        std::error_code ec;
+        FileStamp stamp;
+        stamp.size = (uint64_t)entry.file_size(ec);
+        stamp.mtime = (int64_t)entry.last_write_time(ec).time_since_epoch().count();
+        return stamp;
+    }
+}
+
+uint64_t fingerprint_model_files(const ModelFileIndex& index) {
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](uint64_t v) {
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (v >> (i * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+        };
+    for (const auto& pair : index) {
+        const ChartFileSet& set = pair.second;
+        mix((uint64_t)(int64_t)pair.first);
+        mix(set.hole_stamps.size());
+        mix(set.boundary_stamp.size);
+        mix((uint64_t)set.boundary_stamp.mtime);
+        for (const auto& stamp : set.hole_stamps) {
+            mix(stamp.size);
+            mix((uint64_t)stamp.mtime);
+        }
+    }
+    return hash;
+}
+
+std::vector<glm::vec2> load_polygon_mapped(const std::string& full_path) {
+    std::vector<glm::vec2> vertices;
+    MappedFile file;
+    if (!file.open(full_path) || file.size() == 0) {
+        return vertices;
+    }
+
+    const char* p = file.data();
+    const char* end = p + file.size();
+
+    // 粗略预估顶点数，避免反复扩容 (每行至少 "x y\n" 4 个字符)
+    vertices.reserve(file.size() / 16 + 1);
+
+    // 逐行处理：每行只取前两个数，解析失败的行整行跳过 (与 getline + stringstream 相同)
+    // [修改] from_chars 接受 "inf" / "nan"，istream 不接受；这类行同样跳过，并报告文件和行号
+    size_t line_no = 0;
+    while (p < end) {
+        const char* line_end = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!line_end) line_end = end;
+        ++line_no;
+
+        const char* q = p;
+        float x, y;
+        if (parse_float(q, line_end, x) && parse_float(q, line_end, y)) {
+            if (std::isfinite(x) && std::isfinite(y)) {
+                vertices.push_back({ x, y });
+            }
+            else {
+                std::cerr << "Error: " << full_path << ":" << line_no << ": non-finite coordinate, line skipped" << std::endl;
+            }
+        }
+        p = line_end + 1;
+    }
+
+    // 移除最后一个多余的点（闭合点）
+    if (!vertices.empty()) {
+        vertices.pop_back();
+    }
+    return vertices;
+}
+
+std::map<std::string, ModelFileIndex> scan_chart_directory(const std::string& dir_path) {
+    std::map<std::string, ModelFileIndex> models;
+    // 临时记录每个 chart 的 hole 文件 (K -> path)，最后再截取连续部分
+    std::map<std::string, std::map<int, std::map<int, std::pair<std::string, FileStamp>>>> holes;
+
+    std::error_code ec;
+    if (!fs::exists(dir_path, ec)) return models;
+
+    for (const auto& entry : fs::directory_iterator(dir_path, ec)) {
+        if (!entry.is_regular_file(ec)) continue;
+
+        std::string filename = entry.path().filename().string();
+        size_t chart_pos = filename.find("_chart_");
+        if (chart_pos == std::string::npos) continue;
+
+        std::string model_name = filename.substr(0, chart_pos);
+        std::string rest = filename.substr(chart_pos + 7); // 跳过 "_chart_"
+
+        size_t underscore_pos = rest.find('_');
+        if (underscore_pos == std::string::npos) continue;
+
+        int chart_idx;
+        if (!parse_index(rest.substr(0, underscore_pos), chart_idx)) continue;
+        std::string suffix = rest.substr(underscore_pos + 1);
+
+        // 保持与 load_chart_by_index 相同的路径拼法
+        std::string path = dir_path + "/" + filename;
+
+        if (suffix == "boundary.txt") {
+            auto& files = models[model_name][chart_idx];
+            files.chart_index = chart_idx;
+            files.boundary_path = path;
+            files.boundary_stamp = make_stamp(entry);
+        }
+        else if (suffix.compare(0, 5, "hole_") == 0 && suffix.size() > 9
+            && suffix.compare(suffix.size() - 4, 4, ".txt") == 0) {
+            int hole_k;
+            if (!parse_index(suffix.substr(5, suffix.size() - 9), hole_k)) continue;
+            auto& files = models[model_name][chart_idx];
+            files.chart_index = chart_idx;
+            holes[model_name][chart_idx][hole_k] = { path, make_stamp(entry) };
+        }
+    }
+
+    // 只保留 0,1,2... 连续编号的 hole (旧代码遇到第一个缺失的编号就停止)
+    for (auto& model_pair : holes) {
+        for (auto& chart_pair : model_pair.second) {
+            auto& files = models[model_pair.first][chart_pair.first];
+            int expected = 0;
+            for (const auto& hole_pair : chart_pair.second) {
+                if (hole_pair.first != expected) break;
+                files.hole_paths.push_back(hole_pair.second.first);
+                files.hole_stamps.push_back(hole_pair.second.second);
+                expected++;
+            }
+        }
+    }
+    return models;
+}
+
+Chart2D load_chart_raw(const ChartFileSet& files) {
+    Chart2D chart;
+    if (files.boundary_path.empty()) return chart;
+
+    chart.boundary = load_polygon_mapped(files.boundary_path);
+    if (!chart.IsValid()) return chart;
+
+    for (const auto& hole_path : files.hole_paths) {
+        std::vector<glm::vec2> hole_vertices = load_polygon_mapped(hole_path);
+        if (hole_vertices.empty()) break; // 与逐个探测时 "读不到就停止" 一致
+        chart.holes.push_back(std::move(hole_vertices));
+    }
+    return chart;
+}
+
+Chart2D load_chart_fast(const ChartFileSet& files, float scale_override) {
+    Chart2D chart = load_chart_raw(files);
+    if (!chart.IsValid()) {
+        std::cerr << "Error: Could not load boundary file: " << files.boundary_path << std::endl;
+        return chart;
+    }
+    normalize_chart(chart, scale_override);
+    return chart;
+}
+
+std::map<int, Chart2D> load_model_charts_raw(const ModelFileIndex& index, unsigned int num_threads) {
+    std::vector<const ChartFileSet*> jobs;
+    jobs.reserve(index.size());
+    for (const auto& pair : index) jobs.push_back(&pair.second);
+
+    std::vector<Chart2D> loaded(jobs.size());
+    parallel_for(0, jobs.size(), [&](size_t i) {
+        loaded[i] = load_chart_raw(*jobs[i]);
+        }, num_threads);
+
+    std::map<int, Chart2D> charts;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        charts.emplace(jobs[i]->chart_index, std::move(loaded[i]));
+    }
+    return charts;
+}
@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <string>
+#include <glm/glm.hpp>
+#include "models.h"
+
+// 快速 chart 加载器
+// - 一次目录扫描得到所有模型/chart/hole 文件，不再逐个试探 hole_K 文件
+// - 每个环文件用内存映射读取，std::from_chars 解析
+// - 一个模型的多个 chart 可以并行加载
+// 解析结果与 models.h 中的 load_polygon_from_file_raw / load_chart_by_index 完全一致
+
+// 文件的大小和修改时间 (目录扫描时顺带取得，用于判断缓存是否过期)
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+
+    bool operator==(const FileStamp& o) const { return size == o.size && mtime == o.mtime; }
+    bool operator!=(const FileStamp& o) const { return !(*this == o); }
+};
+
+// 一个 chart 在磁盘上对应的文件
+struct ChartFileSet {
+    int chart_index = -1;
+    std::string boundary_path;            // 可能为空 (只找到了 hole 文件)
+    std::vector<std::string> hole_paths;  // 按 K 排序，只保留从 0 开始连续的部分
+    FileStamp boundary_stamp;
+    std::vector<FileStamp> hole_stamps;   // 与 hole_paths 一一对应
+};
+
+// 一个模型的全部 chart 文件 (Key: Chart Index)
+using ModelFileIndex = std::map<int, ChartFileSet>;
+
+// 模型源文件的指纹：chart 编号、文件数以及每个文件的大小 + 修改时间 (FNV-1a)，
+// 任何一个文本文件被修改、增加或删除都会改变它
+uint64_t fingerprint_model_files(const ModelFileIndex& index);
+
+// 扫描目录一次，返回 模型名 -> 文件索引
+// 文件名格式: <模型名>_chart_<N>_boundary.txt / <模型名>_chart_<N>_hole_<K>.txt
+std::map<std::string, ModelFileIndex> scan_chart_directory(const std::string& dir_path);
+
+// 内存映射 + from_chars 版本的 load_polygon_from_file_raw
+std::vector<glm::vec2> load_polygon_mapped(const std::string& full_path);
+
+// 加载一个 chart 的原始坐标 (不归一化)
+Chart2D load_chart_raw(const ChartFileSet& files);
+
+// 加载并归一化，等价于 load_chart_by_index(model, index, scale_override)
+Chart2D load_chart_fast(const ChartFileSet& files, float scale_override = -1.0f);
+
+// 并行加载一个模型的所有 chart (不归一化)，num_threads = 0 表示使用全部硬件线程
+std::map<int, Chart2D> load_model_charts_raw(const ModelFileIndex& index, unsigned int num_threads = 0);
@@ -0,0 +1,193 @@
+﻿#include "ChartPackage.h"
+#include "ChartLoader.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr uint32_t kPackageVersion = 2; // 2: 增加 source_fingerprint
+
+    uint64_t align_up(uint64_t v, uint64_t a) { return (v + a - 1) / a * a; }
+}
+
+bool ChartPackage::open(const std::string& path) {
+    header_ = nullptr;
+    if (!file_.open(path)) return false;
+
+    const char* base = file_.data();
+    size_t size = file_.size();
+    if (size < sizeof(ChartPackageHeader)) return false;
+
+    const auto* header = reinterpret_cast<const ChartPackageHeader*>(base);
+    if (std::memcmp(header->magic, "SMPK", 4) != 0) {
+        std::cerr << "Error: '" << path << "' is not a valid chart package." << std::endl;
+        return false;
+    }
+    if (header->version != kPackageVersion) {
+        std::cerr << "Warning: chart package '" << path << "' has version " << header->version
+            << " (expected " << kPackageVersion << "), ignored. Re-run with --pack." << std::endl;
+        return false;
+    }
+
+    // 校验各段都在文件范围内，避免损坏的文件导致越界访问
+    uint64_t index_end = sizeof(ChartPackageHeader)
+        + (uint64_t)header->chart_count * sizeof(ChartIndexEntry)
+        + (uint64_t)header->ring_count * sizeof(RingEntry);
+    uint64_t data_end = header->data_offset + header->vertex_count * sizeof(glm::vec2);
+    if (index_end > header->data_offset || data_end > size || header->data_offset % 16 != 0) {
+        std::cerr << "Error: chart package '" << path << "' is truncated." << std::endl;
+        return false;
+    }
+
+    index_ = reinterpret_cast<const ChartIndexEntry*>(base + sizeof(ChartPackageHeader));
+    rings_ = reinterpret_cast<const RingEntry*>(index_ + header->chart_count);
+    vertices_ = reinterpret_cast<const glm::vec2*>(base + header->data_offset);
+
+    for (uint32_t r = 0; r < header->ring_count; ++r) {
+        if (rings_[r].first_vertex + rings_[r].vertex_count > header->vertex_count) return false;
+    }
+    for (uint32_t i = 0; i < header->chart_count; ++i) {
+        if ((uint64_t)index_[i].first_ring + 1 + index_[i].hole_count > header->ring_count) return false;
+    }
+
+    header_ = header;
+    return true;
+}
+
+int ChartPackage::find_chart(int chart_index) const {
+    if (!header_) return -1;
+    const ChartIndexEntry* end = index_ + header_->chart_count;
+    const ChartIndexEntry* it = std::lower_bound(index_, end, chart_index,
+        [](const ChartIndexEntry& e, int idx) { return e.chart_index < idx; });
+    return (it != end && it->chart_index == chart_index) ? (int)(it - index_) : -1;
+}
+
+RingView ChartPackage::ring(uint32_t r) const {
+    RingView view;
+    view.data = vertices_ + rings_[r].first_vertex;
+    view.size = (size_t)rings_[r].vertex_count;
+    return view;
+}
+
+Chart2D ChartPackage::load_chart(size_t i, float scale_override) const {
+    Chart2D chart;
+    chart.boundary = boundary(i).to_vector();
+    for (uint32_t k = 0; k < index_[i].hole_count; ++k) {
+        chart.holes.push_back(hole(i, k).to_vector());
+    }
+    normalize_chart(chart, scale_override);
+    return chart;
+}
+
+float ChartPackage::compute_global_scale() const {
+    float global_max_dim = 0.0f;
+    for (size_t i = 0; i < chart_count(); ++i) {
+        const float* bb = index_[i].aabb;
+        global_max_dim = std::max(global_max_dim, std::max(bb[2] - bb[0], bb[3] - bb[1]));
+    }
+    if (global_max_dim < 1e-6f) return 1.0f;
+    return 10.0f / global_max_dim;
+}
+
+bool write_chart_package(const std::string& path, const std::map<int, Chart2D>& charts, uint64_t source_fingerprint) {
+    std::vector<ChartIndexEntry> index;
+    std::vector<RingEntry> rings;
+    uint64_t vertex_count = 0;
+
+    auto add_ring = [&](const std::vector<glm::vec2>& ring) {
+        rings.push_back({ vertex_count, (uint64_t)ring.size() });
+        vertex_count += ring.size();
+        };
+
+    // std::map 保证按 chart 编号升序，find_chart 依赖这一点
+    for (const auto& pair : charts) {
+        const Chart2D& chart = pair.second;
+        if (!chart.IsValid()) continue;
+
+        ChartIndexEntry e{};
+        e.chart_index = pair.first;
+        e.hole_count = (uint32_t)chart.holes.size();
+        e.first_ring = (uint32_t)rings.size();
+        e.boundary_vertex_count = (uint32_t)chart.boundary.size();
+
+        glm::vec2 min_c = chart.boundary[0], max_c = chart.boundary[0];
+        for (const auto& v : chart.boundary) {
+            min_c.x = std::min(min_c.x, v.x); min_c.y = std::min(min_c.y, v.y);
+            max_c.x = std::max(max_c.x, v.x); max_c.y = std::max(max_c.y, v.y);
+        }
+        e.aabb[0] = min_c.x; e.aabb[1] = min_c.y; e.aabb[2] = max_c.x; e.aabb[3] = max_c.y;
+        index.push_back(e);
+
+        add_ring(chart.boundary);
+        for (const auto& hole : chart.holes) add_ring(hole);
+    }
+
+    ChartPackageHeader header{};
+    std::memcpy(header.magic, "SMPK", 4);
+    header.version = kPackageVersion;
+    header.chart_count = (uint32_t)index.size();
+    header.ring_count = (uint32_t)rings.size();
+    header.vertex_count = vertex_count;
+    header.source_fingerprint = source_fingerprint;
+    uint64_t tables_end = sizeof(header) + index.size() * sizeof(ChartIndexEntry) + rings.size() * sizeof(RingEntry);
+    header.data_offset = align_up(tables_end, 16);
+
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open file for writing: " << tmp_path << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(ChartIndexEntry));
+        out.write(reinterpret_cast<const char*>(rings.data()), rings.size() * sizeof(RingEntry));
+        static const char zeros[16] = {};
+        out.write(zeros, (std::streamsize)(header.data_offset - tables_end));
+
+        for (const auto& pair : charts) {
+            const Chart2D& chart = pair.second;
+            if (!chart.IsValid()) continue;
+            out.write(reinterpret_cast<const char*>(chart.boundary.data()), chart.boundary.size() * sizeof(glm::vec2));
+            for (const auto& hole : chart.holes) {
+                out.write(reinterpret_cast<const char*>(hole.data()), hole.size() * sizeof(glm::vec2));
+            }
+        }
+        if (!out.good()) {
+            std::cerr << "Failed to write chart package: " << tmp_path << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        std::cerr << "Failed to move " << tmp_path << " -> " << path << ": " << ec.message() << std::endl;
+        fs::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool convert_text_model_to_package(const std::string& dir_path, const std::string& model_name, const std::string& out_path) {
+    auto all_models = scan_chart_directory(dir_path);
+    auto it = all_models.find(model_name);
+    if (it == all_models.end()) {
+        std::cerr << "Error: no text charts found for model '" << model_name << "'." << std::endl;
+        return false;
+    }
+
+    std::map<int, Chart2D> charts = load_model_charts_raw(it->second);
+    if (!write_chart_package(out_path, charts, fingerprint_model_files(it->second))) return false;
+
+    size_t holes = 0;
+    for (const auto& pair : charts) holes += pair.second.holes.size();
+    std::cout << "[Pack] " << model_name << ": " << charts.size() << " charts, " << holes
+        << " holes -> " << out_path << std::endl;
+    return true;
+}
@@ -0,0 +1,96 @@
+﻿#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "models.h"
+#include "MappedFile.h"
+
+// 单文件二进制 chart 包 (<模型名>.smpk)
+//
+// 布局 (小端)：
+//   ChartPackageHeader
+//   ChartIndexEntry   x chart_count   (按 chart_index 升序)
+//   RingEntry         x ring_count    (每个 chart: 外环在前，随后是各个内洞)
+//   float32 x,y 数据                   (从 data_offset 开始，16 字节对齐，连续存放)
+//
+// 打开一个模型只需要一次 mmap，任何环都可以直接以 const glm::vec2* 零拷贝访问
+
+struct ChartPackageHeader {
+    char magic[4];             // "SMPK"
+    uint32_t version;
+    uint32_t chart_count;
+    uint32_t ring_count;
+    uint64_t data_offset;      // 顶点数据起始字节偏移
+    uint64_t vertex_count;     // 所有环的顶点总数
+    uint64_t source_fingerprint; // [新增] 打包时文本源文件的指纹 (fingerprint_model_files)，0 = 没有文本来源
+};
+
+struct ChartIndexEntry {
+    int32_t chart_index;
+    uint32_t hole_count;
+    uint32_t first_ring;       // 外环在 RingEntry 表中的下标，内洞紧随其后
+    uint32_t boundary_vertex_count;
+    float aabb[4];             // 外环 (未归一化) 的 x_min, y_min, x_max, y_max
+};
+
+struct RingEntry {
+    uint64_t first_vertex;     // 在顶点数据中的下标 (以 vec2 计)
+    uint64_t vertex_count;
+};
+
+static_assert(sizeof(ChartPackageHeader) == 40, "ChartPackageHeader layout");
+static_assert(sizeof(ChartIndexEntry) == 32, "ChartIndexEntry layout");
+static_assert(sizeof(RingEntry) == 16, "RingEntry layout");
+static_assert(sizeof(glm::vec2) == 2 * sizeof(float), "glm::vec2 must be two packed floats");
+
+// 一个环的零拷贝视图
+struct RingView {
+    const glm::vec2* data = nullptr;
+    size_t size = 0;
+
+    const glm::vec2* begin() const { return data; }
+    const glm::vec2* end() const { return data + size; }
+    std::vector<glm::vec2> to_vector() const { return std::vector<glm::vec2>(begin(), end()); }
+};
+
+class ChartPackage {
+public:
+    ChartPackage() = default;
+
+    // 映射并校验包文件，失败返回 false
+    bool open(const std::string& path);
+    bool is_open() const { return header_ != nullptr; }
+
+    size_t chart_count() const { return header_ ? header_->chart_count : 0; }
+    uint64_t source_fingerprint() const { return header_ ? header_->source_fingerprint : 0; }
+    const ChartIndexEntry& entry(size_t i) const { return index_[i]; }
+    // 按 chart 编号查找，找不到返回 -1
+    int find_chart(int chart_index) const;
+
+    RingView boundary(size_t i) const { return ring(index_[i].first_ring); }
+    RingView hole(size_t i, size_t k) const { return ring(index_[i].first_ring + 1 + (uint32_t)k); }
+
+    // 拷贝出 Chart2D 并做与 load_chart_by_index 相同的归一化
+    Chart2D load_chart(size_t i, float scale_override = -1.0f) const;
+
+    // 直接由索引表中的 AABB 计算全局缩放 (等价于 main.cpp 中的 compute_global_scale)
+    float compute_global_scale() const;
+
+private:
+    RingView ring(uint32_t r) const;
+
+    MappedFile file_;
+    const ChartPackageHeader* header_ = nullptr;
+    const ChartIndexEntry* index_ = nullptr;
+    const RingEntry* rings_ = nullptr;
+    const glm::vec2* vertices_ = nullptr;
+};
+
+// 把一组 (未归一化的) chart 写成包文件；先写临时文件再原子替换
+// source_fingerprint 记录生成它的文本文件，加载时与当前文件比较以发现过期的包
+bool write_chart_package(const std::string& path, const std::map<int, Chart2D>& charts, uint64_t source_fingerprint = 0);
+
+// 转换器：把 exportdata 中某模型的文本文件 (见 ChartLoader.h) 打包为 .smpk
+bool convert_text_model_to_package(const std::string& dir_path, const std::string& model_name, const std::string& out_path);
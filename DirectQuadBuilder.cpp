@@ -0,0 +1,322 @@
+﻿#include "DirectQuadBuilder.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include "EdgeTable.h"
+
+namespace {
+    const float kMinLink = 0.5f;   // 邻居距离下限 (相对 h)
+    const float kMaxLink = 1.6f;   // 邻居距离上限 (相对 h)
+    const float kCone = 0.5f;      // 横向偏移 / 纵向距离 的上限 (约 26.6 度)
+
+    inline uint64_t directed_key(unsigned int a, unsigned int b) { return ((uint64_t)a << 32) | b; }
+
+    inline float cross2(const glm::vec2& a, const glm::vec2& b) { return a.x * b.y - a.y * b.x; }
+}
+
+bool DirectQuadBuilder::build(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+
+    quads_.clear();
+    triangles_.clear();
+    vertices_.clear();
+    linked_count_ = uncovered_count_ = 0;
+    quad_area_ = triangle_area_ = 0.0;
+    if (particles.size() < 4) return false;
+
+    std::vector<std::vector<unsigned int>> chains;
+    if (!CGALMeshGenerator::build_particle_chains(particles, boundary, chains)) {
+        std::cout << "DirectQuadBuilder: boundary particle chains incomplete." << std::endl;
+        return false;
+    }
+
+    auto t0 = Clock::now();
+    link_neighbors(particles);
+    auto t1 = Clock::now();
+    close_quads(particles, boundary, chains);
+    auto t2 = Clock::now();
+    bool ok = patch_gaps(particles, chains);
+    auto t3 = Clock::now();
+    if (!ok) {
+        std::cout << "DirectQuadBuilder: gap constraints could not be recovered (quads crossing the boundary)." << std::endl;
+        quads_.clear();
+        triangles_.clear();
+        return false;
+    }
+    compact(particles);
+    auto t4 = Clock::now();
+
+    std::cout << "DirectQuadBuilder: " << quads_.size() << " quads, " << triangles_.size() << " gap triangles ("
+        << linked_count_ << " particles with both links, " << uncovered_count_ << " not in any quad)." << std::endl;
+    std::cout << "  [timing] links " << ms(t0, t1) << " ms, quads " << ms(t1, t2) << " ms, gaps " << ms(t2, t3)
+        << " ms, compact " << ms(t3, t4) << " ms, total " << ms(t0, t4) << " ms" << std::endl;
+    return true;
+}
+
+// 均匀网格 + 局部坐标系下的锥形搜索
+void DirectQuadBuilder::link_neighbors(const std::vector<Simulation2D::Particle>& particles) {
+    const unsigned int n = (unsigned int)particles.size();
+    glm::vec2 lo(1e30f), hi(-1e30f);
+    float max_h = 0.0f;
+    for (const auto& p : particles) {
+        lo = glm::min(lo, p.position);
+        hi = glm::max(hi, p.position);
+        max_h = std::max(max_h, p.smoothing_h);
+    }
+    cell_size_ = std::max(max_h * kMaxLink, 1e-6f);
+    // 网格过大时 (h 差异悬殊) 放大格子，保证格子数与粒子数同阶
+    while ((double)((hi.x - lo.x) / cell_size_ + 1) * ((hi.y - lo.y) / cell_size_ + 1) > 4.0 * n + 16) cell_size_ *= 2.0f;
+    grid_min_ = lo;
+    grid_nx_ = (int)((hi.x - lo.x) / cell_size_) + 1;
+    grid_ny_ = (int)((hi.y - lo.y) / cell_size_) + 1;
+
+    auto cell_of = [&](const glm::vec2& p, int& cx, int& cy) {
+        cx = std::min(grid_nx_ - 1, std::max(0, (int)((p.x - grid_min_.x) / cell_size_)));
+        cy = std::min(grid_ny_ - 1, std::max(0, (int)((p.y - grid_min_.y) / cell_size_)));
+    };
+    cell_offsets_.assign((size_t)grid_nx_ * grid_ny_ + 1, 0);
+    std::vector<unsigned int> cell_index(n);
+    for (unsigned int i = 0; i < n; ++i) {
+        int cx, cy;
+        cell_of(particles[i].position, cx, cy);
+        cell_index[i] = (unsigned int)(cy * grid_nx_ + cx);
+        cell_offsets_[cell_index[i] + 1]++;
+    }
+    for (size_t c = 0; c + 1 < cell_offsets_.size(); ++c) cell_offsets_[c + 1] += cell_offsets_[c];
+    cell_particles_.resize(n);
+    std::vector<unsigned int> cursor(cell_offsets_.begin(), cell_offsets_.end() - 1);
+    for (unsigned int i = 0; i < n; ++i) cell_particles_[cursor[cell_index[i]]++] = i;
+
+    right_.assign(n, -1);
+    up_.assign(n, -1);
+    for (unsigned int i = 0; i < n; ++i) {
+        const auto& p = particles[i];
+        const float h = p.smoothing_h > 0.0f ? p.smoothing_h : max_h;
+        const float r_min = kMinLink * h, r_max = kMaxLink * h;
+        const glm::vec2 ax = p.rotation[0], ay = p.rotation[1];
+        int cx, cy;
+        cell_of(p.position, cx, cy);
+        int reach = (int)std::ceil(r_max / cell_size_);
+        float best_x = 1e30f, best_y = 1e30f;
+        for (int y = std::max(0, cy - reach); y <= std::min(grid_ny_ - 1, cy + reach); ++y) {
+            for (int x = std::max(0, cx - reach); x <= std::min(grid_nx_ - 1, cx + reach); ++x) {
+                unsigned int c = (unsigned int)(y * grid_nx_ + x);
+                for (unsigned int k = cell_offsets_[c]; k < cell_offsets_[c + 1]; ++k) {
+                    unsigned int j = cell_particles_[k];
+                    if (j == i) continue;
+                    glm::vec2 d = particles[j].position - p.position;
+                    float dx = glm::dot(d, ax), dy = glm::dot(d, ay);
+                    float dist2 = dx * dx + dy * dy;
+                    if (dist2 < r_min * r_min || dist2 > r_max * r_max) continue;
+                    if (dx > 0.0f && std::abs(dy) <= kCone * dx && dist2 < best_x) { best_x = dist2; right_[i] = (int)j; }
+                    if (dy > 0.0f && std::abs(dx) <= kCone * dy && dist2 < best_y) { best_y = dist2; up_[i] = (int)j; }
+                }
+            }
+        }
+        if (right_[i] >= 0 && up_[i] >= 0) linked_count_++;
+    }
+}
+
+bool DirectQuadBuilder::add_edge(unsigned int a, unsigned int b) {
+    if (edge_counts_[a] >= kEdgeSlots || edge_counts_[b] >= kEdgeSlots) return false;
+    edge_slots_[(size_t)a * kEdgeSlots + edge_counts_[a]++] = b;
+    edge_slots_[(size_t)b * kEdgeSlots + edge_counts_[b]++] = a;
+    return true;
+}
+
+// 只需检查附近的粒子：任何与四边形相交的已有边，至少有一个端点落在包围盒外扩 max_edge_ 的范围内
+bool DirectQuadBuilder::is_free_quad(const std::vector<Simulation2D::Particle>& particles, const unsigned int v[4]) const {
+    glm::vec2 p[4];
+    glm::vec2 lo(1e30f), hi(-1e30f);
+    for (int k = 0; k < 4; ++k) {
+        p[k] = particles[v[k]].position;
+        lo = glm::min(lo, p[k]);
+        hi = glm::max(hi, p[k]);
+    }
+    lo -= glm::vec2(max_edge_);
+    hi += glm::vec2(max_edge_);
+    auto orient = [](const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) {
+        float d = cross2(b - a, c - a);
+        return (d > 0.0f) - (d < 0.0f);
+    };
+    auto is_vertex = [&](unsigned int j) { return j == v[0] || j == v[1] || j == v[2] || j == v[3]; };
+
+    int x0 = std::max(0, (int)((lo.x - grid_min_.x) / cell_size_)), x1 = std::min(grid_nx_ - 1, (int)((hi.x - grid_min_.x) / cell_size_));
+    int y0 = std::max(0, (int)((lo.y - grid_min_.y) / cell_size_)), y1 = std::min(grid_ny_ - 1, (int)((hi.y - grid_min_.y) / cell_size_));
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            unsigned int c = (unsigned int)(y * grid_nx_ + x);
+            for (unsigned int k = cell_offsets_[c]; k < cell_offsets_[c + 1]; ++k) {
+                unsigned int j = cell_particles_[k];
+                const glm::vec2& q = particles[j].position;
+                if (q.x < lo.x || q.y < lo.y || q.x > hi.x || q.y > hi.y) continue;
+                bool vertex = is_vertex(j);
+                if (!vertex) {
+                    // 严格在内部 (或落在边上) 的粒子
+                    bool inside = true;
+                    for (int e = 0; e < 4 && inside; ++e) inside = orient(p[e], p[(e + 1) % 4], q) >= 0;
+                    if (inside) return false;
+                }
+                for (int s = 0; s < edge_counts_[j]; ++s) {
+                    unsigned int o = edge_slots_[(size_t)j * kEdgeSlots + s];
+                    const glm::vec2& r = particles[o].position;
+                    for (int e = 0; e < 4; ++e) {
+                        unsigned int a = v[e], b = v[(e + 1) % 4];
+                        if (j == a || j == b || o == a || o == b) continue; // 共享端点
+                        if (orient(p[e], p[(e + 1) % 4], q) * orient(p[e], p[(e + 1) % 4], r) < 0
+                            && orient(q, r, p[e]) * orient(q, r, p[(e + 1) % 4]) < 0) return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// i -> right -> 角点 -> up 闭合；两条路径给出的角点不一致时放弃
+void DirectQuadBuilder::close_quads(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary,
+    const std::vector<std::vector<unsigned int>>& chains) {
+    const unsigned int n = (unsigned int)particles.size();
+    used_edges_.clear();
+    used_edges_.reserve((size_t)n * 4);
+    quads_.reserve(n);
+    edge_slots_.resize((size_t)n * kEdgeSlots);
+    edge_counts_.assign(n, 0);
+    max_edge_ = 0.0f;
+    for (const auto& chain : chains) {
+        for (size_t k = 0; k < chain.size(); ++k) {
+            unsigned int a = chain[k], b = chain[(k + 1) % chain.size()];
+            add_edge(a, b);
+            max_edge_ = std::max(max_edge_, glm::length(particles[a].position - particles[b].position));
+        }
+    }
+
+    for (unsigned int i = 0; i < n; ++i) {
+        int r = right_[i], u = up_[i];
+        if (r < 0 || u < 0 || r == u) continue;
+        int c1 = up_[r], c2 = right_[u];
+        int c = c1 >= 0 ? c1 : c2;
+        if (c < 0 || (c1 >= 0 && c2 >= 0 && c1 != c2)) continue;
+        if (c == (int)i || c == r || c == u) continue;
+
+        const unsigned int v[4] = { i, (unsigned int)r, (unsigned int)c, (unsigned int)u };
+        glm::vec2 p[4];
+        for (int k = 0; k < 4; ++k) p[k] = particles[v[k]].position;
+        bool convex = true;
+        for (int k = 0; k < 4 && convex; ++k) {
+            convex = cross2(p[(k + 1) % 4] - p[k], p[(k + 2) % 4] - p[(k + 1) % 4]) > 0.0f;
+        }
+        if (!convex) continue;
+        if (!boundary.is_inside(0.25f * (p[0] + p[1] + p[2] + p[3]))) continue;
+
+        bool free = true;
+        for (int k = 0; k < 4 && free; ++k) free = used_edges_.count(directed_key(v[k], v[(k + 1) % 4])) == 0;
+        if (!free || !is_free_quad(particles, v)) continue;
+
+        // 新边登记到两端 (反向边已存在的无需重复登记)；槽位用完时放弃这个四边形
+        bool registered = true;
+        for (int k = 0; k < 4 && registered; ++k) {
+            unsigned int a = v[k], b = v[(k + 1) % 4];
+            if (used_edges_.count(directed_key(b, a))) continue;
+            bool on_chain = false;
+            for (int s = 0; s < edge_counts_[a] && !on_chain; ++s) on_chain = edge_slots_[(size_t)a * kEdgeSlots + s] == b;
+            if (!on_chain) registered = edge_counts_[a] < kEdgeSlots && edge_counts_[b] < kEdgeSlots;
+        }
+        if (!registered) continue;
+        for (int k = 0; k < 4; ++k) {
+            unsigned int a = v[k], b = v[(k + 1) % 4];
+            used_edges_.insert(directed_key(a, b));
+            if (used_edges_.count(directed_key(b, a))) continue;
+            bool on_chain = false;
+            for (int s = 0; s < edge_counts_[a] && !on_chain; ++s) on_chain = edge_slots_[(size_t)a * kEdgeSlots + s] == b;
+            if (!on_chain) {
+                add_edge(a, b);
+                max_edge_ = std::max(max_edge_, glm::length(p[(k + 1) % 4] - p[k]));
+            }
+        }
+        quads_.push_back({ v[0], v[1], v[2], v[3] });
+    }
+}
+
+// 空隙 = 域 \ 四边形区域，约束取两者边界的对称差：CDT 的奇偶层级恰好在空隙中为奇数
+bool DirectQuadBuilder::patch_gaps(const std::vector<Simulation2D::Particle>& particles,
+    const std::vector<std::vector<unsigned int>>& chains) {
+    const unsigned int n = (unsigned int)particles.size();
+
+    // 四边形区域的边界边：反向边未被占用的有向边
+    std::vector<uint64_t> keys;
+    std::vector<char> covered(n, 0), on_gap(n, 0);
+    for (const auto& q : quads_) {
+        const unsigned int v[4] = { q.v0, q.v1, q.v2, q.v3 };
+        for (int k = 0; k < 4; ++k) {
+            unsigned int a = v[k], b = v[(k + 1) % 4];
+            covered[a] = 1;
+            if (used_edges_.count(directed_key(b, a))) continue;
+            keys.push_back(EdgeTable::key(a, b));
+            on_gap[a] = on_gap[b] = 1;
+        }
+    }
+    for (const auto& chain : chains) {
+        for (size_t k = 0; k < chain.size(); ++k) {
+            keys.push_back(EdgeTable::key(chain[k], chain[(k + 1) % chain.size()]));
+            on_gap[chain[k]] = 1;
+        }
+    }
+    for (unsigned int i = 0; i < n; ++i) {
+        if (!covered[i]) {
+            on_gap[i] = 1;
+            uncovered_count_++;
+        }
+    }
+
+    // 对称差：出现偶数次的边 (四边形边恰好落在边界链上) 互相抵消
+    std::sort(keys.begin(), keys.end());
+    TriangulationInput input;
+    std::vector<unsigned int> local(n, 0xFFFFFFFFu), global;
+    for (unsigned int i = 0; i < n; ++i) {
+        if (!on_gap[i]) continue;
+        local[i] = (unsigned int)input.points.size();
+        input.points.push_back(particles[i].position);
+        global.push_back(i);
+    }
+    for (size_t lo = 0; lo < keys.size();) {
+        size_t hi = lo + 1;
+        while (hi < keys.size() && keys[hi] == keys[lo]) ++hi;
+        if ((hi - lo) % 2 == 1) {
+            unsigned int a = (unsigned int)(keys[lo] >> 32), b = (unsigned int)(keys[lo] & 0xFFFFFFFFu);
+            input.constraints.emplace_back(local[a], local[b]);
+        }
+        lo = hi;
+    }
+
+    TriangulationResult result;
+    if (!backend_.triangulate(input, result)) return false;
+    triangles_.reserve(result.triangles.size());
+    for (const auto& t : result.triangles) triangles_.push_back({ global[t[0]], global[t[1]], global[t[2]] });
+    return true;
+}
+
+// 只保留被引用的粒子，按首次出现的顺序编号
+void DirectQuadBuilder::compact(const std::vector<Simulation2D::Particle>& particles) {
+    const unsigned int kUnassigned = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(particles.size(), kUnassigned);
+    vertices_.reserve(particles.size());
+    auto map = [&](unsigned int& v) {
+        if (remap[v] == kUnassigned) {
+            remap[v] = (unsigned int)vertices_.size();
+            vertices_.push_back(particles[v].position);
+        }
+        v = remap[v];
+    };
+    for (auto& q : quads_) {
+        map(q.v0); map(q.v1); map(q.v2); map(q.v3);
+        const glm::vec2 &a = vertices_[q.v0], &b = vertices_[q.v1], &c = vertices_[q.v2], &d = vertices_[q.v3];
+        quad_area_ += 0.5 * (cross2(c - a, d - b));
+    }
+    for (auto& t : triangles_) {
+        map(t.v0); map(t.v1); map(t.v2);
+        triangle_area_ += 0.5 * cross2(vertices_[t.v1] - vertices_[t.v0], vertices_[t.v2] - vertices_[t.v0]);
+    }
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Simulation2D.h"
+#include "Boundary.h"
+#include "CGALMeshGenerator.h"
+#include "NativeDelaunay.h"
+
+// 直接从已对齐的 SPH 粒子构建四边形为主网格 (不经过整体三角化 + Qmorph 配对)
+//
+//   1. 均匀网格哈希，给每个粒子在其局部坐标系 (rotation 的两列) 下找最近的 +x / +y 邻居
+//      (锥角 |横向| <= 0.5 * 纵向，距离在 [0.5h, 1.6h])；
+//   2. 粒子 i、right(i)、up(i) 与 up(right(i)) / right(up(i)) 闭合成四边形，
+//      要求逆时针严格凸、重心在域内、内部没有其他粒子、边不与已有四边形边或边界链相交；
+//   3. 剩余空隙：未被覆盖的粒子 + 四边形区域边界上的粒子 + 边界粒子链，
+//      约束取 "边界粒子链" 与 "四边形区域边界" 的对称差，用轻量 CDT 三角化后按奇偶层级
+//      自然排除四边形区域 (域内且不在四边形内的部分层级为奇数)。
+// 边界粒子链不完整或空隙约束无法恢复 (四边形与边界交叉) 时返回 false。
+class DirectQuadBuilder {
+public:
+    bool build(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary);
+
+    const std::vector<glm::vec2>& get_vertices() const { return vertices_; }
+    const std::vector<CGALMeshGenerator::Quad>& get_quads() const { return quads_; }
+    const std::vector<CGALMeshGenerator::Triangle>& get_triangles() const { return triangles_; }
+
+    // 上一次 build 的统计
+    size_t get_linked_count() const { return linked_count_; }     // 同时找到 +x 和 +y 邻居的粒子
+    size_t get_uncovered_count() const { return uncovered_count_; } // 不属于任何四边形的粒子
+    double get_quad_area() const { return quad_area_; }
+    double get_triangle_area() const { return triangle_area_; }
+
+private:
+    void link_neighbors(const std::vector<Simulation2D::Particle>& particles);
+    void close_quads(const std::vector<Simulation2D::Particle>& particles, const Boundary& boundary,
+        const std::vector<std::vector<unsigned int>>& chains);
+    // 新四边形不能包含其他粒子，边不能与已有四边形边 / 边界链相交
+    bool is_free_quad(const std::vector<Simulation2D::Particle>& particles, const unsigned int v[4]) const;
+    bool add_edge(unsigned int a, unsigned int b);
+    bool patch_gaps(const std::vector<Simulation2D::Particle>& particles,
+        const std::vector<std::vector<unsigned int>>& chains);
+    void compact(const std::vector<Simulation2D::Particle>& particles);
+
+    // 均匀网格 (CSR)
+    std::vector<unsigned int> cell_offsets_, cell_particles_;
+    glm::vec2 grid_min_ = glm::vec2(0.0f);
+    float cell_size_ = 1.0f;
+    int grid_nx_ = 0, grid_ny_ = 0;
+
+    std::vector<int> right_, up_;
+    std::unordered_set<uint64_t> used_edges_; // 已被四边形占用的有向边 (a << 32 | b)
+    static const int kEdgeSlots = 8;
+    std::vector<unsigned int> edge_slots_;    // 每个粒子关联的已有边 (四边形边 + 边界链)，kEdgeSlots 个一组
+    std::vector<uint8_t> edge_counts_;
+    float max_edge_ = 0.0f;
+    std::vector<CGALMeshGenerator::Quad> quads_;
+    std::vector<CGALMeshGenerator::Triangle> triangles_;
+    std::vector<glm::vec2> vertices_;
+    NativeTriangulationBackend backend_;
+
+    size_t linked_count_ = 0, uncovered_count_ = 0;
+    double quad_area_ = 0.0, triangle_area_ = 0.0;
+};
@@ -0,0 +1,101 @@
+﻿#include "EdgeTable.h"
+#include <algorithm>
+#include "ParallelFor.h"
+
+namespace {
+    const unsigned int kRadixBits = 16;
+    const unsigned int kRadix = 1u << kRadixBits;
+    // 少于这个数量的半边不值得开线程 (每块的直方图本身就有 64K 项)
+    const size_t kMinPerChunk = 1 << 17;
+}
+
+void EdgeTable::build(const std::vector<uint64_t>& keys, unsigned int num_threads) {
+    const size_t n = keys.size();
+    keys_.assign(keys.begin(), keys.end());
+    ids_.resize(n);
+    keys_tmp_.resize(n);
+    ids_tmp_.resize(n);
+    twin_.assign(n, -1);
+    edge_count_ = boundary_count_ = non_manifold_count_ = 0;
+    if (n == 0) return;
+
+    uint64_t any = 0, all = ~0ull;
+    for (size_t h = 0; h < n; ++h) {
+        ids_[h] = (uint32_t)h;
+        any |= keys_[h];
+        all &= keys_[h];
+    }
+    const uint64_t varying = any ^ all; // 在所有键中都相同的位不参与排序
+
+    if (n < kRadix) {
+        // 数量少时直方图清零的开销占主导，直接比较排序 (按 (键, 半边) 排，结果与基数排序一致)
+        std::sort(ids_.begin(), ids_.end(), [&](uint32_t a, uint32_t b) {
+            return keys_[a] != keys_[b] ? keys_[a] < keys_[b] : a < b;
+        });
+        for (size_t i = 0; i < n; ++i) keys_tmp_[i] = keys_[ids_[i]];
+        keys_.swap(keys_tmp_);
+    }
+    else {
+        if (num_threads == 0) num_threads = default_thread_count();
+        unsigned int chunks = (unsigned int)std::max<size_t>(1, std::min<size_t>(num_threads, n / kMinPerChunk));
+        histogram_.resize((size_t)chunks * kRadix);
+
+        for (int shift = 0; shift < 64; shift += kRadixBits) {
+            if (((varying >> shift) & (kRadix - 1)) == 0) continue;
+            sort_pass(shift, chunks);
+        }
+    }
+
+    // 相邻相等键为同一条边
+    for (size_t lo = 0; lo < n;) {
+        size_t hi = lo + 1;
+        while (hi < n && keys_[hi] == keys_[lo]) ++hi;
+        edge_count_++;
+        if (hi - lo == 1) {
+            boundary_count_++;
+        }
+        else if (hi - lo == 2) {
+            twin_[ids_[lo]] = (int)ids_[lo + 1];
+            twin_[ids_[lo + 1]] = (int)ids_[lo];
+        }
+        else {
+            non_manifold_count_++;
+        }
+        lo = hi;
+    }
+}
+
+// 一趟稳定的计数排序：各块统计直方图，按 (桶, 块) 顺序求前缀，再各自分发
+void EdgeTable::sort_pass(int shift, unsigned int chunks) {
+    const size_t n = keys_.size();
+    const size_t chunk_size = (n + chunks - 1) / chunks;
+
+    parallel_for(0, chunks, [&](size_t c) {
+        uint32_t* hist = histogram_.data() + c * kRadix;
+        std::fill(hist, hist + kRadix, 0u);
+        size_t lo = c * chunk_size, hi = std::min(n, lo + chunk_size);
+        for (size_t i = lo; i < hi; ++i) hist[(keys_[i] >> shift) & (kRadix - 1)]++;
+    }, chunks);
+
+    uint32_t offset = 0;
+    for (unsigned int d = 0; d < kRadix; ++d) {
+        for (unsigned int c = 0; c < chunks; ++c) {
+            uint32_t count = histogram_[(size_t)c * kRadix + d];
+            histogram_[(size_t)c * kRadix + d] = offset;
+            offset += count;
+        }
+    }
+
+    parallel_for(0, chunks, [&](size_t c) {
+        uint32_t* next = histogram_.data() + c * kRadix;
+        size_t lo = c * chunk_size, hi = std::min(n, lo + chunk_size);
+        for (size_t i = lo; i < hi; ++i) {
+            uint32_t dst = next[(keys_[i] >> shift) & (kRadix - 1)]++;
+            keys_tmp_[dst] = keys_[i];
+            ids_tmp_[dst] = ids_[i];
+        }
+    }, chunks);
+
+    keys_.swap(keys_tmp_);
+    ids_.swap(ids_tmp_);
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 平铺边表：由三角形半边的无向边键配对出相邻关系，替代 std::map<Edge, std::vector<...>>。
+//
+// 半边 h (调用方约定，一般为 三角形 * 3 + 边号) 的键为 (较小顶点 << 32) | 较大顶点。
+// (键, h) 打包后做 LSD 基数排序 (每趟 16 位，所有键在该位段相同的趟直接跳过，
+// 每趟按块并行统计 + 稳定分发)，排序后相邻的相等键即为同一条边。
+// 所有缓冲区都是成员，容量稳定后重复 build 不再分配内存。
+class EdgeTable {
+public:
+    static uint64_t key(unsigned int a, unsigned int b) {
+        return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+    }
+
+    // keys[h] 为半边 h 的键。恰好两条半边共享同一键时互为 twin，
+    // 只出现一次 (边界) 或超过两次 (非流形) 的为 -1
+    void build(const std::vector<uint64_t>& keys, unsigned int num_threads = 0);
+
+    const std::vector<int>& twins() const { return twin_; }
+    size_t edge_count() const { return edge_count_; }             // 不同的无向边数
+    size_t boundary_count() const { return boundary_count_; }     // 只出现一次的边
+    size_t non_manifold_count() const { return non_manifold_count_; }
+
+private:
+    void sort_pass(int shift, unsigned int chunks);
+
+    std::vector<uint64_t> keys_, keys_tmp_;
+    std::vector<uint32_t> ids_, ids_tmp_;
+    std::vector<uint32_t> histogram_; // chunks * 65536
+    std::vector<int> twin_;
+    size_t edge_count_ = 0, boundary_count_ = 0, non_manifold_count_ = 0;
+};
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <string>
+#include <cstddef>
+
+// 只读内存映射文件
+// Windows 下使用 CreateFileMapping / MapViewOfFile，其他平台使用 mmap
+// 空文件可以正常 open()，此时 data() 为 nullptr、size() 为 0
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { swap(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) { close(); swap(other); }
+        return *this;
+    }
+
+    // 打开并映射整个文件，失败返回 false
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const { return is_open_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void swap(MappedFile& other) noexcept;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool is_open_ = false;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#endif
+};
@@ -0,0 +1,334 @@
+﻿#include "MeshExporter.h"
+#include "ParallelFor.h"
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // 每块格式化的元素个数
+    const size_t kChunk = 1 << 16;
+
+    size_t chunk_count(size_t n) { return (n + kChunk - 1) / kChunk; }
+
+    bool host_is_little_endian() {
+        const uint16_t probe = 1;
+        unsigned char first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    // 按指定字节序追加 4 字节的值
+    template <typename T>
+    inline char* put32(char* p, T value, bool swap) {
+        static_assert(sizeof(T) == 4, "put32");
+        uint32_t bits;
+        std::memcpy(&bits, &value, 4);
+        if (swap) bits = (bits >> 24) | ((bits >> 8) & 0xff00u) | ((bits << 8) & 0xff0000u) | (bits << 24);
+        std::memcpy(p, &bits, 4);
+        return p + 4;
+    }
+
+    inline char* put_text(char* p, const char* s) {
+        size_t n = std::strlen(s);
+        std::memcpy(p, s, n);
+        return p + n;
+    }
+
+    // 预留足够空间，格式化后截断到实际长度
+    template <typename Func>
+    void fill_chunk(std::string& out, size_t capacity, Func&& fn) {
+        out.resize(capacity);
+        char* end = fn(&out[0], &out[0] + capacity);
+        out.resize((size_t)(end - &out[0]));
+    }
+}
+
+const char* MeshExporter::extension(MeshFormat format) {
+    switch (format) {
+    case MeshFormat::Ply: return ".ply";
+    case MeshFormat::Vtk: return ".vtk";
+    default: return ".obj";
+    }
+}
+
+bool MeshExporter::parse_format(const std::string& name, MeshFormat& format) {
+    if (name == "obj") format = MeshFormat::Obj;
+    else if (name == "ply") format = MeshFormat::Ply;
+    else if (name == "vtk") format = MeshFormat::Vtk;
+    else return false;
+    return true;
+}
+
+bool MeshExporter::write(const std::string& path, MeshFormat format, const std::vector<glm::vec2>& vertices,
+    const std::vector<CGALMeshGenerator::Quad>& quads, const std::vector<CGALMeshGenerator::Triangle>& triangles,
+    const std::vector<Edge>& boundary_edges) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto t0 = Clock::now();
+    bytes_ = 0;
+
+    compact(vertices, quads, triangles, boundary_edges);
+
+    std::vector<std::string> chunks;
+    if (format == MeshFormat::Obj) format_obj(chunks);
+    else if (format == MeshFormat::Ply) format_ply(chunks);
+    else format_vtk(chunks);
+    auto t1 = Clock::now();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "MeshExporter: failed to open " << path << std::endl;
+        return false;
+    }
+    for (const auto& chunk : chunks) {
+        out.write(chunk.data(), (std::streamsize)chunk.size());
+        bytes_ += chunk.size();
+    }
+    out.close();
+    if (!out) {
+        std::cerr << "MeshExporter: failed to write " << path << std::endl;
+        return false;
+    }
+    auto t2 = Clock::now();
+
+    auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    std::cout << "MeshExporter: " << path << " (" << vertices_.size() << " vertices";
+    if (removed_vertices_) std::cout << ", " << removed_vertices_ << " unused removed";
+    std::cout << ", " << quads_.size() << " quads, " << triangles_.size() << " tris, " << bytes_ / 1024 << " KB) format "
+        << ms(t0, t1) << " ms, write " << ms(t1, t2) << " ms" << std::endl;
+    return true;
+}
+
+// 按原顺序保留被面引用的顶点 (前缀和重编号)
+void MeshExporter::compact(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Quad>& quads,
+    const std::vector<CGALMeshGenerator::Triangle>& triangles, const std::vector<Edge>& boundary_edges) {
+    const unsigned int kUnused = 0xffffffffu;
+    remap_.assign(vertices.size(), kUnused);
+    for (const auto& q : quads) remap_[q.v0] = remap_[q.v1] = remap_[q.v2] = remap_[q.v3] = 0;
+    for (const auto& t : triangles) remap_[t.v0] = remap_[t.v1] = remap_[t.v2] = 0;
+
+    vertices_.clear();
+    vertices_.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        if (remap_[i] == kUnused) continue;
+        remap_[i] = (unsigned int)vertices_.size();
+        vertices_.push_back(vertices[i]);
+    }
+    removed_vertices_ = vertices.size() - vertices_.size();
+
+    quads_.resize(quads.size());
+    triangles_.resize(triangles.size());
+    if (removed_vertices_ == 0) {
+        quads_ = quads;
+        triangles_ = triangles;
+    }
+    else {
+        parallel_for_range(0, quads.size(), [&](size_t lo, size_t hi, unsigned int) {
+            for (size_t i = lo; i < hi; ++i) {
+                const auto& q = quads[i];
+                quads_[i] = { remap_[q.v0], remap_[q.v1], remap_[q.v2], remap_[q.v3] };
+            }
+        }, threads_);
+        parallel_for_range(0, triangles.size(), [&](size_t lo, size_t hi, unsigned int) {
+            for (size_t i = lo; i < hi; ++i) {
+                const auto& t = triangles[i];
+                triangles_[i] = { remap_[t.v0], remap_[t.v1], remap_[t.v2] };
+            }
+        }, threads_);
+    }
+
+    edges_.clear();
+    for (const auto& e : boundary_edges) {
+        if (e[0] >= remap_.size() || e[1] >= remap_.size()) continue;
+        if (remap_[e[0]] == kUnused || remap_[e[1]] == kUnused) continue;
+        edges_.push_back({ remap_[e[0]], remap_[e[1]] });
+    }
+}
+
+// 顶点 "v x y 0\n" 最多约 40 字节，面 "f a b c d\n" 最多 46 字节 (索引从 1 开始)
+void MeshExporter::format_obj(std::vector<std::string>& chunks) const {
+    const size_t nv = chunk_count(vertices_.size()), nq = chunk_count(quads_.size()), nt = chunk_count(triangles_.size());
+    chunks.assign(nv + nq + nt + 1, std::string());
+
+    parallel_for(0, chunks.size() - 1, [&](size_t c) {
+        if (c < nv) {
+            size_t lo = c * kChunk, hi = std::min(vertices_.size(), lo + kChunk);
+            fill_chunk(chunks[c], (hi - lo) * 48, [&](char* p, char* end) {
+                for (size_t i = lo; i < hi; ++i) {
+                    p = put_text(p, "v ");
+                    p = std::to_chars(p, end, vertices_[i].x).ptr;
+                    *p++ = ' ';
+                    p = std::to_chars(p, end, vertices_[i].y).ptr;
+                    p = put_text(p, " 0\n");
+                }
+                return p;
+            });
+        }
+        else if (c < nv + nq) {
+            size_t lo = (c - nv) * kChunk, hi = std::min(quads_.size(), lo + kChunk);
+            fill_chunk(chunks[c], (hi - lo) * 48, [&](char* p, char* end) {
+                for (size_t i = lo; i < hi; ++i) {
+                    const unsigned int v[4] = { quads_[i].v0, quads_[i].v1, quads_[i].v2, quads_[i].v3 };
+                    *p++ = 'f';
+                    for (int k = 0; k < 4; ++k) {
+                        *p++ = ' ';
+                        p = std::to_chars(p, end, v[k] + 1).ptr;
+                    }
+                    *p++ = '\n';
+                }
+                return p;
+            });
+        }
+        else {
+            size_t lo = (c - nv - nq) * kChunk, hi = std::min(triangles_.size(), lo + kChunk);
+            fill_chunk(chunks[c], (hi - lo) * 40, [&](char* p, char* end) {
+                for (size_t i = lo; i < hi; ++i) {
+                    const unsigned int v[3] = { triangles_[i].v0, triangles_[i].v1, triangles_[i].v2 };
+                    *p++ = 'f';
+                    for (int k = 0; k < 3; ++k) {
+                        *p++ = ' ';
+                        p = std::to_chars(p, end, v[k] + 1).ptr;
+                    }
+                    *p++ = '\n';
+                }
+                return p;
+            });
+        }
+    }, threads_);
+
+    // 边界边数量很少，串行追加
+    std::string& tail = chunks.back();
+    if (!edges_.empty()) {
+        fill_chunk(tail, 16 + edges_.size() * 26, [&](char* p, char* end) {
+            p = put_text(p, "g boundary\n");
+            for (const auto& e : edges_) {
+                *p++ = 'l';
+                *p++ = ' ';
+                p = std::to_chars(p, end, e[0] + 1).ptr;
+                *p++ = ' ';
+                p = std::to_chars(p, end, e[1] + 1).ptr;
+                *p++ = '\n';
+            }
+            return p;
+        });
+    }
+}
+
+void MeshExporter::format_ply(std::vector<std::string>& chunks) const {
+    const bool swap = !host_is_little_endian();
+    const size_t nv = chunk_count(vertices_.size()), nq = chunk_count(quads_.size()), nt = chunk_count(triangles_.size());
+    chunks.assign(1 + nv + nq + nt, std::string());
+
+    chunks[0] = "ply\nformat binary_little_endian 1.0\ncomment SPHMesh quad-dominant mesh\n"
+        "element vertex " + std::to_string(vertices_.size()) + "\n"
+        "property float x\nproperty float y\nproperty float z\n"
+        "element face " + std::to_string(quads_.size() + triangles_.size()) + "\n"
+        "property list uchar int vertex_indices\nend_header\n";
+
+    parallel_for(1, chunks.size(), [&](size_t c) {
+        size_t k = c - 1;
+        if (k < nv) {
+            size_t lo = k * kChunk, hi = std::min(vertices_.size(), lo + kChunk);
+            fill_chunk(chunks[c], (hi - lo) * 12, [&](char* p, char*) {
+                for (size_t i = lo; i < hi; ++i) {
+                    p = put32(p, vertices_[i].x, swap);
+                    p = put32(p, vertices_[i].y, swap);
+                    p = put32(p, 0.0f, swap);
+                }
+                return p;
+            });
+        }
+        else if (k < nv + nq) {
+            size_t lo = (k - nv) * kChunk, hi = std::min(quads_.size(), lo + kChunk);
+            fill_chunk(chunks[c], (hi - lo) * 17, [&](char* p, char*) {
+                for (size_t i = lo; i < hi; ++i) {
+                    *p++ = (char)4;
+                    p = put32(p, (int32_t)quads_[i].v0, swap);
+                    p = put32(p, (int32_t)quads_[i].v1, swap);
+                    p = put32(p, (int32_t)quads_[i].v2, swap);
+                    p = put32(p, (int32_t)quads_[i].v3, swap);
+                }
+                return p;
+            });
+        }
+        else {
+            size_t lo = (k - nv - nq) * kChunk, hi = std::min(triangles_.size(), lo + kChunk);
+            fill_chunk(chunks[c], (hi - lo) * 13, [&](char* p, char*) {
+                for (size_t i = lo; i < hi; ++i) {
+                    *p++ = (char)3;
+                    p = put32(p, (int32_t)triangles_[i].v0, swap);
+                    p = put32(p, (int32_t)triangles_[i].v1, swap);
+                    p = put32(p, (int32_t)triangles_[i].v2, swap);
+                }
+                return p;
+            });
+        }
+    }, threads_);
+}
+
+// 旧式 VTK 的二进制数据规定为大端
+void MeshExporter::format_vtk(std::vector<std::string>& chunks) const {
+    const bool swap = host_is_little_endian();
+    const size_t nv = chunk_count(vertices_.size()), nq = chunk_count(quads_.size()), nt = chunk_count(triangles_.size());
+    const size_t cells = quads_.size() + triangles_.size();
+    // 头 | 点 | CELLS 头 | 四边形 | 三角形 | CELL_TYPES 头 | 类型 | 结尾换行
+    chunks.assign(1 + nv + 1 + nq + nt + 1 + 1 + 1, std::string());
+    const size_t points_begin = 1, cells_header = 1 + nv, quads_begin = cells_header + 1,
+        tris_begin = quads_begin + nq, types_header = tris_begin + nt, types_chunk = types_header + 1;
+
+    chunks[0] = "# vtk DataFile Version 3.0\nSPHMesh quad-dominant mesh\nBINARY\nDATASET UNSTRUCTURED_GRID\n"
+        "POINTS " + std::to_string(vertices_.size()) + " float\n";
+    chunks[cells_header] = "\nCELLS " + std::to_string(cells) + " " + std::to_string(quads_.size() * 5 + triangles_.size() * 4) + "\n";
+    chunks[types_header] = "\nCELL_TYPES " + std::to_string(cells) + "\n";
+    chunks.back() = "\n";
+
+    parallel_for(points_begin, types_header, [&](size_t c) {
+        if (c < cells_header) {
+            size_t lo = (c - points_begin) * kChunk, hi = std::min(vertices_.size(), lo + kChunk);
+            fill_chunk(chunks[c], (hi - lo) * 12, [&](char* p, char*) {
+                for (size_t i = lo; i < hi; ++i) {
+                    p = put32(p, vertices_[i].x, swap);
+                    p = put32(p, vertices_[i].y, swap);
+                    p = put32(p, 0.0f, swap);
+                }
+                return p;
+            });
+        }
+        else if (c == cells_header) {
+            return;
+        }
+        else if (c < tris_begin) {
+            size_t lo = (c - quads_begin) * kChunk, hi = std::min(quads_.size(), lo + kChunk);
+            fill_chunk(chunks[c], (hi - lo) * 20, [&](char* p, char*) {
+                for (size_t i = lo; i < hi; ++i) {
+                    p = put32(p, (int32_t)4, swap);
+                    p = put32(p, (int32_t)quads_[i].v0, swap);
+                    p = put32(p, (int32_t)quads_[i].v1, swap);
+                    p = put32(p, (int32_t)quads_[i].v2, swap);
+                    p = put32(p, (int32_t)quads_[i].v3, swap);
+                }
+                return p;
+            });
+        }
+        else {
+            size_t lo = (c - tris_begin) * kChunk, hi = std::min(triangles_.size(), lo + kChunk);
+            fill_chunk(chunks[c], (hi - lo) * 16, [&](char* p, char*) {
+                for (size_t i = lo; i < hi; ++i) {
+                    p = put32(p, (int32_t)3, swap);
+                    p = put32(p, (int32_t)triangles_[i].v0, swap);
+                    p = put32(p, (int32_t)triangles_[i].v1, swap);
+                    p = put32(p, (int32_t)triangles_[i].v2, swap);
+                }
+                return p;
+            });
+        }
+    }, threads_);
+
+    // 单元类型：VTK_QUAD = 9，VTK_TRIANGLE = 5
+    fill_chunk(chunks[types_chunk], cells * 4, [&](char* p, char*) {
+        for (size_t i = 0; i < quads_.size(); ++i) p = put32(p, (int32_t)9, swap);
+        for (size_t i = 0; i < triangles_.size(); ++i) p = put32(p, (int32_t)5, swap);
+        return p;
+    });
+}
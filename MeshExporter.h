@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "CGALMeshGenerator.h"
+
+// 网格导出 (四边形 + 三角形混合网格)
+//
+//   Obj: 文本，std::to_chars 格式化；顶点 / 面按块分给多个线程格式化到各自的缓冲区，
+//        再按顺序一次性写盘。可选的边界边写成 "g boundary" + "l a b"
+//   Ply: binary_little_endian 1.0，顶点 float x y z，面 uchar 个数 + int 索引
+//   Vtk: 旧式 VTK 二进制 UNSTRUCTURED_GRID (按规范为大端)，单元类型 5 (三角形) / 9 (四边形)
+// 写出前压缩掉没有被任何面引用的顶点 (保持原有的相对顺序)。
+enum class MeshFormat { Obj, Ply, Vtk };
+
+class MeshExporter {
+public:
+    using Edge = std::array<unsigned int, 2>;
+
+    // 0 = 硬件并发数
+    void set_threads(unsigned int threads) { threads_ = threads; }
+
+    bool write(const std::string& path, MeshFormat format, const std::vector<glm::vec2>& vertices,
+        const std::vector<CGALMeshGenerator::Quad>& quads, const std::vector<CGALMeshGenerator::Triangle>& triangles,
+        const std::vector<Edge>& boundary_edges = {});
+
+    static const char* extension(MeshFormat format);
+    // "obj" / "ply" / "vtk"，无法识别时返回 false
+    static bool parse_format(const std::string& name, MeshFormat& format);
+
+    // 上一次 write 的统计
+    size_t get_vertex_count() const { return vertices_.size(); }
+    size_t get_removed_vertex_count() const { return removed_vertices_; }
+    size_t get_byte_count() const { return bytes_; }
+
+private:
+    void compact(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Quad>& quads,
+        const std::vector<CGALMeshGenerator::Triangle>& triangles, const std::vector<Edge>& boundary_edges);
+    void format_obj(std::vector<std::string>& chunks) const;
+    void format_ply(std::vector<std::string>& chunks) const;
+    void format_vtk(std::vector<std::string>& chunks) const;
+
+    unsigned int threads_ = 0;
+
+    // 压缩后的网格
+    std::vector<unsigned int> remap_;
+    std::vector<glm::vec2> vertices_;
+    std::vector<CGALMeshGenerator::Quad> quads_;
+    std::vector<CGALMeshGenerator::Triangle> triangles_;
+    std::vector<Edge> edges_;
+    size_t removed_vertices_ = 0;
+    size_t bytes_ = 0;
+};
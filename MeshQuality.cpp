@@ -0,0 +1,261 @@
+﻿#include "MeshQuality.h"
+#include "ParallelFor.h"
+#include "Qmorph.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    const float kRadToDeg = 57.2957795f;
+    const float kDegenerate = 1e6f; // 零长度边 / 零面积单元的长宽比
+    const double kPercentiles[5] = { 0.01, 0.05, 0.50, 0.95, 0.99 };
+
+    enum SeriesIndex { MinAngle, MaxAngle, AspectRatio, ScaledJacobian, QmorphQuality, EdgeSizeRatio };
+
+    MeshQuality::Series make_series(const char* name, float lo, float hi, int bins) {
+        MeshQuality::Series s;
+        s.name = name;
+        s.lo = lo;
+        s.hi = hi;
+        s.bins = bins;
+        return s;
+    }
+
+    inline float cross2(const glm::vec2& a, const glm::vec2& b) { return a.x * b.y - a.y * b.x; }
+
+    // 多边形角点 b (前一点 a，后一点 c) 的内角，sign 为单元朝向 (逆时针 +1)
+    inline float interior_angle(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, float sign) {
+        glm::vec2 u = c - b, v = a - b;
+        float angle = std::atan2(sign * cross2(u, v), glm::dot(u, v));
+        if (angle < 0.0f) angle += 6.2831853f; // 凹角
+        return angle * kRadToDeg;
+    }
+
+    void write_summary(std::ofstream& out, const MeshQuality::Series& s, const char* indent) {
+        const auto& m = s.summary;
+        out << indent << "\"" << s.name << "\": {\n";
+        out << indent << "  \"count\": " << m.count << ", \"invalid\": " << m.invalid << ", \"min\": " << m.min << ", \"max\": " << m.max << ", \"mean\": " << m.mean << ",\n";
+        out << indent << "  \"percentiles\": { \"p1\": " << m.percentiles[0] << ", \"p5\": " << m.percentiles[1] << ", \"p50\": "
+            << m.percentiles[2] << ", \"p95\": " << m.percentiles[3] << ", \"p99\": " << m.percentiles[4] << " },\n";
+        out << indent << "  \"histogram\": { \"lo\": " << s.lo << ", \"hi\": " << s.hi << ", \"below\": " << m.below
+            << ", \"above\": " << m.above << ", \"counts\": [";
+        for (size_t b = 0; b < m.histogram.size(); ++b) out << (b ? ", " : "") << m.histogram[b];
+        out << "] }\n" << indent << "}";
+    }
+
+    void write_group(std::ofstream& out, const char* name, const std::vector<MeshQuality::Series>& series) {
+        out << "  \"" << name << "\": {";
+        bool first = true;
+        for (const auto& s : series) {
+            if (s.summary.count == 0 && s.summary.invalid == 0) continue;
+            out << (first ? "\n" : ",\n");
+            write_summary(out, s, "    ");
+            first = false;
+        }
+        out << (first ? "}" : "\n  }");
+    }
+}
+
+void MeshQuality::analyze(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Quad>& quads,
+    const std::vector<CGALMeshGenerator::Triangle>& triangles, const BackgroundGrid* grid) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto t0 = Clock::now();
+    vertex_count_ = vertices.size();
+    triangle_count_ = triangles.size();
+    quad_count_ = quads.size();
+
+    triangle_series_ = {
+        make_series("min_angle", 0.0f, 90.0f, 45),
+        make_series("max_angle", 60.0f, 180.0f, 60),
+        make_series("aspect_ratio", 1.0f, 5.0f, 40),
+        make_series("scaled_jacobian", -1.0f, 1.0f, 40),
+        make_series("qmorph_quality", 0.0f, 1.0f, 20), // 三角形不使用
+        make_series("edge_size_ratio", 0.0f, 3.0f, 60),
+    };
+    quad_series_ = triangle_series_;
+    quad_series_[MinAngle].hi = 180.0f;
+    quad_series_[MinAngle].bins = 90;
+    quad_series_[MaxAngle] = make_series("max_angle", 90.0f, 360.0f, 135);
+
+    analyze_triangles(vertices, triangles, grid);
+    analyze_quads(vertices, quads, grid);
+
+    // 每个序列独立汇总
+    std::vector<Series*> all;
+    for (auto& s : triangle_series_) all.push_back(&s);
+    for (auto& s : quad_series_) all.push_back(&s);
+    parallel_for(0, all.size(), [&](size_t i) { summarize(*all[i]); }, threads_);
+
+    analyze_ms_ = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+void MeshQuality::analyze_triangles(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Triangle>& triangles,
+    const BackgroundGrid* grid) {
+    const size_t n = triangles.size();
+    for (int s : { MinAngle, MaxAngle, AspectRatio, ScaledJacobian }) triangle_series_[s].values.resize(n);
+    if (grid) triangle_series_[EdgeSizeRatio].values.resize(n * 3);
+    float* min_angle = triangle_series_[MinAngle].values.data();
+    float* max_angle = triangle_series_[MaxAngle].values.data();
+    float* aspect = triangle_series_[AspectRatio].values.data();
+    float* jacobian = triangle_series_[ScaledJacobian].values.data();
+    float* size_ratio = triangle_series_[EdgeSizeRatio].values.data();
+
+    parallel_for_range(0, n, [&](size_t lo, size_t hi, unsigned int) {
+        for (size_t t = lo; t < hi; ++t) {
+            const glm::vec2 p[3] = { vertices[triangles[t].v0], vertices[triangles[t].v1], vertices[triangles[t].v2] };
+            float area2 = cross2(p[1] - p[0], p[2] - p[0]);
+            float sign = area2 < 0.0f ? -1.0f : 1.0f;
+            float len[3], amin = 360.0f, amax = 0.0f, jmin = 1.0f, lmax = 0.0f;
+            for (int k = 0; k < 3; ++k) {
+                const glm::vec2& a = p[(k + 2) % 3];
+                const glm::vec2& b = p[k];
+                const glm::vec2& c = p[(k + 1) % 3];
+                len[k] = glm::length(c - b);
+                lmax = std::max(lmax, len[k]);
+                float angle = interior_angle(a, b, c, sign);
+                amin = std::min(amin, angle);
+                amax = std::max(amax, angle);
+                float denom = glm::length(c - b) * glm::length(a - b);
+                float j = denom > 0.0f ? std::abs(area2) / denom * 1.1547005f : 0.0f; // 2/√3
+                jmin = std::min(jmin, j);
+                if (grid) size_ratio[3 * t + k] = len[k] / grid->get_target_size(0.5f * (b + c));
+            }
+            if (area2 == 0.0f) amin = amax = 0.0f;
+            min_angle[t] = amin;
+            max_angle[t] = amax;
+            jacobian[t] = std::min(1.0f, jmin) * (area2 < 0.0f ? -1.0f : 1.0f);
+            float a = 0.5f * std::abs(area2);
+            aspect[t] = a > 0.0f ? lmax * (len[0] + len[1] + len[2]) / (6.9282032f * a) : kDegenerate; // 4√3
+        }
+    }, threads_);
+}
+
+void MeshQuality::analyze_quads(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Quad>& quads,
+    const BackgroundGrid* grid) {
+    const size_t n = quads.size();
+    for (int s : { MinAngle, MaxAngle, AspectRatio, ScaledJacobian, QmorphQuality }) quad_series_[s].values.resize(n);
+    if (grid) quad_series_[EdgeSizeRatio].values.resize(n * 4);
+    float* min_angle = quad_series_[MinAngle].values.data();
+    float* max_angle = quad_series_[MaxAngle].values.data();
+    float* aspect = quad_series_[AspectRatio].values.data();
+    float* jacobian = quad_series_[ScaledJacobian].values.data();
+    float* quality = quad_series_[QmorphQuality].values.data();
+    float* size_ratio = quad_series_[EdgeSizeRatio].values.data();
+
+    parallel_for_range(0, n, [&](size_t lo, size_t hi, unsigned int) {
+        // Qmorph 质量按 SoA 批量计算
+        const size_t kBatch = 256;
+        std::vector<float> soa(8 * kBatch);
+        const float* columns[8];
+        for (int c = 0; c < 8; ++c) columns[c] = soa.data() + c * kBatch;
+
+        for (size_t base = lo; base < hi; base += kBatch) {
+            size_t count = std::min(kBatch, hi - base);
+            for (size_t i = 0; i < count; ++i) {
+                const auto& q = quads[base + i];
+                const glm::vec2 p[4] = { vertices[q.v0], vertices[q.v1], vertices[q.v2], vertices[q.v3] };
+                for (int k = 0; k < 4; ++k) {
+                    soa[(2 * k) * kBatch + i] = p[k].x;
+                    soa[(2 * k + 1) * kBatch + i] = p[k].y;
+                }
+
+                // [修改] Qmorph 与 DirectQuadBuilder 输出的四边形都是逆时针，朝向固定为 +1：
+                // 按自身对角线叉积取符号会把翻转的四边形当成正常单元
+                const float sign = 1.0f;
+                float amin = 360.0f, amax = 0.0f, jmin = 1.0f, lmin = 1e30f, lmax = 0.0f;
+                for (int k = 0; k < 4; ++k) {
+                    const glm::vec2& a = p[(k + 3) % 4];
+                    const glm::vec2& b = p[k];
+                    const glm::vec2& c = p[(k + 1) % 4];
+                    float len = glm::length(c - b);
+                    lmin = std::min(lmin, len);
+                    lmax = std::max(lmax, len);
+                    float angle = interior_angle(a, b, c, sign);
+                    amin = std::min(amin, angle);
+                    amax = std::max(amax, angle);
+                    float denom = glm::length(c - b) * glm::length(a - b);
+                    jmin = std::min(jmin, denom > 0.0f ? sign * cross2(c - b, a - b) / denom : 0.0f);
+                    if (grid) size_ratio[4 * (base + i) + k] = len / grid->get_target_size(0.5f * (b + c));
+                }
+                min_angle[base + i] = amin;
+                max_angle[base + i] = amax;
+                jacobian[base + i] = jmin;
+                aspect[base + i] = lmin > 0.0f ? lmax / lmin : kDegenerate;
+            }
+            Qmorph::calculate_quad_quality_batch(columns, quality + base, count);
+        }
+    }, threads_);
+}
+
+void MeshQuality::summarize(Series& series) {
+    Summary& m = series.summary;
+    m = Summary();
+    m.histogram.assign(series.bins, 0);
+
+    // [修改] NaN 既不 < lo 也不 >= hi，转换成直方图下标是未定义行为，也会破坏 nth_element 的比较；
+    // 非有限值先移到末尾单独计数，之后只处理 [begin, valid_end)
+    auto valid_end = std::partition(series.values.begin(), series.values.end(), [](float v) { return std::isfinite(v); });
+    m.count = (size_t)(valid_end - series.values.begin());
+    m.invalid = series.values.size() - m.count;
+    if (m.count == 0) return;
+
+    double sum = 0.0;
+    float vmin = series.values[0], vmax = series.values[0];
+    const float scale = series.bins / (series.hi - series.lo);
+    for (auto it = series.values.begin(); it != valid_end; ++it) {
+        const float v = *it;
+        sum += v;
+        vmin = std::min(vmin, v);
+        vmax = std::max(vmax, v);
+        if (v < series.lo) ++m.below;
+        else if (v >= series.hi) ++m.above;
+        else m.histogram[std::min(series.bins - 1, (int)((v - series.lo) * scale))]++;
+    }
+    m.min = vmin;
+    m.max = vmax;
+    m.mean = sum / m.count;
+
+    // 百分位：依次 nth_element，每次只在上一次位置之后的部分里找
+    auto first = series.values.begin();
+    for (int p = 0; p < 5; ++p) {
+        auto nth = series.values.begin() + (size_t)std::llround(kPercentiles[p] * (m.count - 1));
+        std::nth_element(first, nth, valid_end);
+        m.percentiles[p] = *nth;
+        first = nth;
+    }
+}
+
+bool MeshQuality::write_json(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "MeshQuality: failed to open " << path << std::endl;
+        return false;
+    }
+    out << "{\n";
+    out << "  \"vertices\": " << vertex_count_ << ",\n";
+    out << "  \"triangles\": " << triangle_count_ << ",\n";
+    out << "  \"quads\": " << quad_count_ << ",\n";
+    out << "  \"analyze_ms\": " << analyze_ms_ << ",\n";
+    write_group(out, "triangle_metrics", triangle_series_);
+    out << ",\n";
+    write_group(out, "quad_metrics", quad_series_);
+    out << "\n}\n";
+    return (bool)out;
+}
+
+void MeshQuality::print_summary() const {
+    std::cout << "MeshQuality: " << triangle_count_ << " triangles, " << quad_count_ << " quads in " << analyze_ms_ << " ms" << std::endl;
+    auto print = [](const char* group, const std::vector<Series>& series) {
+        for (const auto& s : series) {
+            if (s.summary.count == 0 && s.summary.invalid == 0) continue;
+            std::cout << "  " << group << " " << s.name << ": min " << s.summary.min << ", p5 " << s.summary.percentiles[1]
+                << ", median " << s.summary.percentiles[2] << ", p95 " << s.summary.percentiles[3] << ", max " << s.summary.max;
+            if (s.summary.invalid > 0) std::cout << " (" << s.summary.invalid << " invalid)";
+            std::cout << std::endl;
+        }
+    };
+    print("tri ", triangle_series_);
+    print("quad", quad_series_);
+}
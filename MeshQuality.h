@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "CGALMeshGenerator.h"
+#include "BackgroundGrid.h"
+
+// 网格质量统计 (三角形与四边形分开统计)
+//
+//   min_angle / max_angle  内角 (度)
+//   aspect_ratio           三角形: Lmax * (L1 + L2 + L3) / (4√3 * 面积)；四边形: Lmax / Lmin。理想值均为 1
+//   scaled_jacobian        各角点 sin(夹角) 的最小值 (按单元整体朝向取符号，三角形再乘 2/√3)；理想值 1，<= 0 为退化或翻转
+//   edge_size_ratio        边长 / 边中点处 BackgroundGrid 的目标尺寸 h (按单元逐边统计，共享边计两次)
+//   qmorph_quality         仅四边形，Qmorph::calculate_quad_quality
+// 逐单元计算和直方图都按线程切块并行；百分位用 nth_element 精确求出。非有限值单独计数，不进入直方图和百分位。
+class MeshQuality {
+public:
+    struct Summary {
+        size_t count = 0;                          // 有效 (有限) 值的个数，其余统计都只针对有效值
+        size_t invalid = 0;                        // [新增] NaN / Inf (如零长边、完全退化的单元)
+        double min = 0.0, max = 0.0, mean = 0.0;
+        double percentiles[5] = { 0, 0, 0, 0, 0 }; // 1 / 5 / 50 / 95 / 99
+        std::vector<uint64_t> histogram;           // [lo, hi) 等分，越界的计入 below / above
+        uint64_t below = 0, above = 0;
+    };
+
+    struct Series {
+        const char* name = "";
+        float lo = 0.0f, hi = 1.0f;
+        int bins = 1;
+        std::vector<float> values;
+        Summary summary;
+    };
+
+    // 0 = 硬件并发数
+    void set_threads(unsigned int threads) { threads_ = threads; }
+
+    // grid 为空时不统计 edge_size_ratio
+    void analyze(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Quad>& quads,
+        const std::vector<CGALMeshGenerator::Triangle>& triangles, const BackgroundGrid* grid);
+
+    bool write_json(const std::string& path) const;
+    void print_summary() const;
+
+    const std::vector<Series>& get_triangle_series() const { return triangle_series_; }
+    const std::vector<Series>& get_quad_series() const { return quad_series_; }
+
+private:
+    void analyze_triangles(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Triangle>& triangles,
+        const BackgroundGrid* grid);
+    void analyze_quads(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Quad>& quads,
+        const BackgroundGrid* grid);
+    static void summarize(Series& series);
+
+    unsigned int threads_ = 0;
+    size_t vertex_count_ = 0, triangle_count_ = 0, quad_count_ = 0;
+    double analyze_ms_ = 0.0;
+    std::vector<Series> triangle_series_, quad_series_;
+};
@@ -0,0 +1,264 @@
+﻿#include "MeshReorder.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    // (x, y) 在 2^16 x 2^16 网格上的 Hilbert 曲线下标
+    uint64_t hilbert_index(uint32_t x, uint32_t y) {
+        uint64_t d = 0;
+        for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+            uint32_t rx = (x & s) ? 1u : 0u;
+            uint32_t ry = (y & s) ? 1u : 0u;
+            d += (uint64_t)s * s * ((3u * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = s - 1 - x;
+                    y = s - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    template <size_t N>
+    void sort_by_span(const std::vector<std::array<unsigned int, N>>& elements, std::vector<unsigned int>& order) {
+        std::vector<uint64_t> keys(elements.size());
+        for (size_t e = 0; e < elements.size(); ++e) {
+            unsigned int lo = elements[e][0], hi = elements[e][0];
+            for (size_t k = 1; k < N; ++k) {
+                lo = std::min(lo, elements[e][k]);
+                hi = std::max(hi, elements[e][k]);
+            }
+            keys[e] = ((uint64_t)lo << 32) | hi;
+        }
+        order.resize(elements.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+    }
+}
+
+const char* MeshReorder::name(MeshOrdering method) {
+    switch (method) {
+    case MeshOrdering::ReverseCuthillMcKee: return "RCM";
+    case MeshOrdering::Hilbert: return "Hilbert";
+    default: return "none";
+    }
+}
+
+void MeshReorder::compute_vertex_order(MeshOrdering method, const std::vector<glm::vec2>& vertices,
+    const std::vector<Triangle>& triangles, const std::vector<Quad>& quads) {
+    const size_t n = vertices.size();
+    if (method == MeshOrdering::Hilbert) order_hilbert(vertices);
+    else if (method == MeshOrdering::ReverseCuthillMcKee) {
+        build_graph(n, triangles, quads);
+        order_rcm(n);
+    }
+    else {
+        order_.resize(n);
+        std::iota(order_.begin(), order_.end(), 0u);
+    }
+    new_index_.resize(n);
+    for (size_t k = 0; k < n; ++k) new_index_[order_[k]] = (unsigned int)k;
+}
+
+void MeshReorder::remap_elements(std::vector<Triangle>& triangles, std::vector<Quad>& quads) const {
+    for (auto& t : triangles) t = { new_index_[t.v0], new_index_[t.v1], new_index_[t.v2] };
+    for (auto& q : quads) q = { new_index_[q.v0], new_index_[q.v1], new_index_[q.v2], new_index_[q.v3] };
+}
+
+void MeshReorder::apply(MeshOrdering method, std::vector<glm::vec2>& vertices, std::vector<Triangle>& triangles, std::vector<Quad>& quads) {
+    if (method == MeshOrdering::None || vertices.empty()) return;
+    MeshReorder reorder;
+    reorder.compute_vertex_order(method, vertices, triangles, quads);
+    reorder.permute_vertices(vertices);
+    reorder.remap_elements(triangles, quads);
+
+    std::vector<unsigned int> order;
+    element_order(triangles, order);
+    std::vector<Triangle> sorted_triangles(triangles.size());
+    for (size_t k = 0; k < order.size(); ++k) sorted_triangles[k] = triangles[order[k]];
+    triangles.swap(sorted_triangles);
+    element_order(quads, order);
+    std::vector<Quad> sorted_quads(quads.size());
+    for (size_t k = 0; k < order.size(); ++k) sorted_quads[k] = quads[order[k]];
+    quads.swap(sorted_quads);
+}
+
+void MeshReorder::element_order(const std::vector<Triangle>& triangles, std::vector<unsigned int>& order) {
+    std::vector<std::array<unsigned int, 3>> e(triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) e[i] = { triangles[i].v0, triangles[i].v1, triangles[i].v2 };
+    sort_by_span(e, order);
+}
+
+void MeshReorder::element_order(const std::vector<Quad>& quads, std::vector<unsigned int>& order) {
+    std::vector<std::array<unsigned int, 4>> e(quads.size());
+    for (size_t i = 0; i < quads.size(); ++i) e[i] = { quads[i].v0, quads[i].v1, quads[i].v2, quads[i].v3 };
+    sort_by_span(e, order);
+}
+
+// 第 i 行最左的非零列 = 包含 i 的单元中最小的顶点号，只需遍历一次单元
+MeshOrderStats MeshReorder::measure(size_t vertex_count, const std::vector<Triangle>& triangles, const std::vector<Quad>& quads) {
+    MeshOrderStats stats;
+    std::vector<unsigned int> row_min(vertex_count);
+    std::iota(row_min.begin(), row_min.end(), 0u);
+    auto visit = [&](const unsigned int* v, int count) {
+        unsigned int lo = v[0], hi = v[0];
+        for (int k = 1; k < count; ++k) {
+            lo = std::min(lo, v[k]);
+            hi = std::max(hi, v[k]);
+        }
+        stats.bandwidth = std::max<size_t>(stats.bandwidth, hi - lo);
+        for (int k = 0; k < count; ++k) row_min[v[k]] = std::min(row_min[v[k]], lo);
+    };
+    for (const auto& t : triangles) {
+        const unsigned int v[3] = { t.v0, t.v1, t.v2 };
+        visit(v, 3);
+    }
+    for (const auto& q : quads) {
+        const unsigned int v[4] = { q.v0, q.v1, q.v2, q.v3 };
+        visit(v, 4);
+    }
+    for (size_t i = 0; i < vertex_count; ++i) stats.profile += i - row_min[i];
+    return stats;
+}
+
+// 单元内所有顶点对 (四边形含对角线)，先按行计数再填充，最后每行排序去重
+void MeshReorder::build_graph(size_t vertex_count, const std::vector<Triangle>& triangles, const std::vector<Quad>& quads) {
+    graph_offsets_.assign(vertex_count + 1, 0);
+    for (const auto& t : triangles) {
+        graph_offsets_[t.v0 + 1] += 2; graph_offsets_[t.v1 + 1] += 2; graph_offsets_[t.v2 + 1] += 2;
+    }
+    for (const auto& q : quads) {
+        graph_offsets_[q.v0 + 1] += 3; graph_offsets_[q.v1 + 1] += 3; graph_offsets_[q.v2 + 1] += 3; graph_offsets_[q.v3 + 1] += 3;
+    }
+    for (size_t i = 0; i < vertex_count; ++i) graph_offsets_[i + 1] += graph_offsets_[i];
+    graph_neighbors_.resize(graph_offsets_[vertex_count]);
+    std::vector<unsigned int> fill(graph_offsets_.begin(), graph_offsets_.end() - 1);
+    auto link = [&](const unsigned int* v, int count) {
+        for (int a = 0; a < count; ++a) {
+            for (int b = 0; b < count; ++b) {
+                if (a != b) graph_neighbors_[fill[v[a]]++] = v[b];
+            }
+        }
+    };
+    for (const auto& t : triangles) {
+        const unsigned int v[3] = { t.v0, t.v1, t.v2 };
+        link(v, 3);
+    }
+    for (const auto& q : quads) {
+        const unsigned int v[4] = { q.v0, q.v1, q.v2, q.v3 };
+        link(v, 4);
+    }
+
+    // 原地压缩
+    unsigned int write = 0;
+    for (size_t i = 0; i < vertex_count; ++i) {
+        auto first = graph_neighbors_.begin() + graph_offsets_[i];
+        auto last = graph_neighbors_.begin() + graph_offsets_[i + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        graph_offsets_[i] = write;
+        for (auto it = first; it != last; ++it) graph_neighbors_[write++] = *it;
+    }
+    graph_offsets_[vertex_count] = write;
+    graph_neighbors_.resize(write);
+}
+
+int MeshReorder::bfs_levels(unsigned int start, std::vector<unsigned int>& last_level) {
+    // level_ 中 >= 0 的都是本次 BFS 访问过的，结束后恢复为 -1
+    queue_.clear();
+    queue_.push_back(start);
+    level_[start] = 0;
+    for (size_t head = 0; head < queue_.size(); ++head) {
+        unsigned int v = queue_[head];
+        for (unsigned int k = graph_offsets_[v]; k < graph_offsets_[v + 1]; ++k) {
+            unsigned int w = graph_neighbors_[k];
+            if (level_[w] < 0) {
+                level_[w] = level_[v] + 1;
+                queue_.push_back(w);
+            }
+        }
+    }
+    int depth = level_[queue_.back()];
+    last_level.clear();
+    for (unsigned int v : queue_) {
+        if (level_[v] == depth) last_level.push_back(v);
+        level_[v] = -1;
+    }
+    return depth;
+}
+
+void MeshReorder::order_rcm(size_t vertex_count) {
+    auto degree = [&](unsigned int v) { return graph_offsets_[v + 1] - graph_offsets_[v]; };
+    order_.clear();
+    order_.reserve(vertex_count);
+    level_.assign(vertex_count, -1);
+    std::vector<uint8_t> placed(vertex_count, 0);
+    std::vector<unsigned int> last_level, neighbors;
+
+    // 按度数从小到大尝试作为种子，每个连通分量只处理一次
+    std::vector<unsigned int> seeds(vertex_count);
+    std::iota(seeds.begin(), seeds.end(), 0u);
+    std::stable_sort(seeds.begin(), seeds.end(), [&](unsigned int a, unsigned int b) { return degree(a) < degree(b); });
+
+    for (unsigned int seed : seeds) {
+        if (placed[seed]) continue;
+
+        // 伪外围点：反复跳到最后一层度数最小的点，直到层数不再增加
+        unsigned int start = seed;
+        int depth = bfs_levels(start, last_level);
+        for (int iter = 0; iter < 8; ++iter) {
+            unsigned int candidate = *std::min_element(last_level.begin(), last_level.end(),
+                [&](unsigned int a, unsigned int b) { return degree(a) < degree(b); });
+            std::vector<unsigned int> candidate_level;
+            int candidate_depth = bfs_levels(candidate, candidate_level);
+            if (candidate_depth <= depth) break;
+            start = candidate;
+            depth = candidate_depth;
+            last_level.swap(candidate_level);
+        }
+
+        // Cuthill-McKee：邻居按度数升序入队
+        size_t head = order_.size();
+        order_.push_back(start);
+        placed[start] = 1;
+        for (; head < order_.size(); ++head) {
+            unsigned int v = order_[head];
+            neighbors.clear();
+            for (unsigned int k = graph_offsets_[v]; k < graph_offsets_[v + 1]; ++k) {
+                unsigned int w = graph_neighbors_[k];
+                if (!placed[w]) {
+                    placed[w] = 1;
+                    neighbors.push_back(w);
+                }
+            }
+            std::sort(neighbors.begin(), neighbors.end(), [&](unsigned int a, unsigned int b) {
+                return degree(a) != degree(b) ? degree(a) < degree(b) : a < b;
+            });
+            order_.insert(order_.end(), neighbors.begin(), neighbors.end());
+        }
+    }
+    std::reverse(order_.begin(), order_.end());
+}
+
+void MeshReorder::order_hilbert(const std::vector<glm::vec2>& vertices) {
+    const size_t n = vertices.size();
+    order_.resize(n);
+    std::iota(order_.begin(), order_.end(), 0u);
+    if (n == 0) return;
+    glm::vec2 lo = vertices[0], hi = vertices[0];
+    for (const auto& v : vertices) {
+        lo = glm::min(lo, v);
+        hi = glm::max(hi, v);
+    }
+    float extent = std::max(std::max(hi.x - lo.x, hi.y - lo.y), 1e-20f);
+    float scale = 65535.0f / extent;
+    std::vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t x = (uint32_t)std::min(65535.0f, (vertices[i].x - lo.x) * scale);
+        uint32_t y = (uint32_t)std::min(65535.0f, (vertices[i].y - lo.y) * scale);
+        keys[i] = hilbert_index(x, y);
+    }
+    std::stable_sort(order_.begin(), order_.end(), [&](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "CGALMeshGenerator.h"
+
+// 输出网格的顶点 / 单元重排 (改善下游有限元矩阵的带宽和缓存局部性)
+//
+//   ReverseCuthillMcKee: 单元内任意两个顶点视为耦合，每个连通分量从伪外围点出发按度数升序 BFS，再整体反转
+//   Hilbert:             顶点按包围盒内 2^16 x 2^16 网格上的 Hilbert 曲线下标排序
+// 单元按 (最小新顶点号, 最大新顶点号) 排序，与顶点顺序对应；单元内角点顺序不变。
+enum class MeshOrdering { None, ReverseCuthillMcKee, Hilbert };
+
+// 矩阵带宽 / 轮廓 (单元内所有顶点对都算作非零元)
+struct MeshOrderStats {
+    size_t bandwidth = 0;   // max |i - j|
+    uint64_t profile = 0;   // sum_i (i - 第 i 行最左非零列)
+};
+
+class MeshReorder {
+public:
+    using Triangle = CGALMeshGenerator::Triangle;
+    using Quad = CGALMeshGenerator::Quad;
+
+    // 计算顶点新顺序，之后用 get_new_index() 把旧下标映射到新下标
+    void compute_vertex_order(MeshOrdering method, const std::vector<glm::vec2>& vertices,
+        const std::vector<Triangle>& triangles, const std::vector<Quad>& quads);
+    const std::vector<unsigned int>& get_new_index() const { return new_index_; } // 旧 -> 新
+    const std::vector<unsigned int>& get_order() const { return order_; }         // 新 -> 旧
+
+    // 按 new_index 重排数组 (out[new_index[i]] = in[i])
+    template <typename T>
+    void permute_vertices(std::vector<T>& values) const {
+        std::vector<T> out(values.size());
+        for (size_t i = 0; i < values.size(); ++i) out[new_index_[i]] = values[i];
+        values.swap(out);
+    }
+    void remap_elements(std::vector<Triangle>& triangles, std::vector<Quad>& quads) const;
+
+    // [新增] 整个网格重排一次：顶点按 method，三角形 / 四边形再按新顶点号排序 (适用于没有邻接等附加数组的网格)
+    static void apply(MeshOrdering method, std::vector<glm::vec2>& vertices, std::vector<Triangle>& triangles, std::vector<Quad>& quads);
+
+    // 单元局部性顺序：返回 order (新 -> 旧)，不修改输入
+    static void element_order(const std::vector<Triangle>& triangles, std::vector<unsigned int>& order);
+    static void element_order(const std::vector<Quad>& quads, std::vector<unsigned int>& order);
+
+    static MeshOrderStats measure(size_t vertex_count, const std::vector<Triangle>& triangles, const std::vector<Quad>& quads);
+
+    static const char* name(MeshOrdering method);
+
+private:
+    void build_graph(size_t vertex_count, const std::vector<Triangle>& triangles, const std::vector<Quad>& quads);
+    void order_rcm(size_t vertex_count);
+    void order_hilbert(const std::vector<glm::vec2>& vertices);
+    // 从 start 出发 BFS，返回层数，last_level 为最后一层的顶点
+    int bfs_levels(unsigned int start, std::vector<unsigned int>& last_level);
+
+    // 顶点耦合图 (CSR，已去重)
+    std::vector<unsigned int> graph_offsets_, graph_neighbors_;
+    std::vector<unsigned int> new_index_, order_;
+    std::vector<int> level_;
+    std::vector<unsigned int> queue_;
+};
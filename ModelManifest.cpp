@@ -0,0 +1,165 @@
+﻿#include "ModelManifest.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr uint32_t kManifestVersion = 1;
+
+    struct ManifestHeader {
+        char magic[4];         // "SMMF"
+        uint32_t version;
+        uint32_t chart_count;
+        uint32_t stamp_count;
+        float global_scale;
+        uint32_t reserved;
+    };
+
+    template <typename T>
+    bool read_array(std::ifstream& in, std::vector<T>& out, size_t n) {
+        out.resize(n);
+        in.read(reinterpret_cast<char*>(out.data()), n * sizeof(T));
+        return in.good();
+    }
+}
+
+bool ModelManifest::load(const std::string& path) {
+    std::error_code ec;
+    uint64_t file_size = (uint64_t)fs::file_size(path, ec);
+    if (ec) return false;
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+
+    ManifestHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in.good() || std::memcmp(header.magic, "SMMF", 4) != 0 || header.version != kManifestVersion) {
+        return false;
+    }
+
+    // [修改] 先用文件大小核对头部的计数，截断或损坏的清单不会触发巨大的分配
+    uint64_t expected_size = sizeof(ManifestHeader)
+        + (uint64_t)header.chart_count * (sizeof(ManifestChartEntry) + sizeof(uint32_t))
+        + (uint64_t)header.stamp_count * sizeof(FileStamp);
+    if (expected_size != file_size) return false;
+
+    global_scale_ = header.global_scale;
+    if (!read_array(in, charts_, header.chart_count)
+        || !read_array(in, stamp_counts_, header.chart_count)
+        || !read_array(in, stamps_, header.stamp_count)) {
+        return false;
+    }
+
+    // 每个 chart 的文件数之和必须正好是记录的文件总数，matches() 依赖这一点
+    uint64_t stamp_sum = 0;
+    for (uint32_t count : stamp_counts_) stamp_sum += count;
+    return stamp_sum == stamps_.size();
+}
+
+bool ModelManifest::save(const std::string& path) const {
+    ManifestHeader header{};
+    std::memcpy(header.magic, "SMMF", 4);
+    header.version = kManifestVersion;
+    header.chart_count = (uint32_t)charts_.size();
+    header.stamp_count = (uint32_t)stamps_.size();
+    header.global_scale = global_scale_;
+
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(charts_.data()), charts_.size() * sizeof(ManifestChartEntry));
+        out.write(reinterpret_cast<const char*>(stamp_counts_.data()), stamp_counts_.size() * sizeof(uint32_t));
+        out.write(reinterpret_cast<const char*>(stamps_.data()), stamps_.size() * sizeof(FileStamp));
+        if (!out.good()) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        fs::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool ModelManifest::matches(const ModelFileIndex& files) const {
+    if (files.size() != charts_.size()) return false;
+
+    size_t chart_i = 0;
+    size_t stamp_i = 0;
+    for (const auto& pair : files) {
+        const ChartFileSet& set = pair.second;
+        if (charts_[chart_i].chart_index != pair.first) return false;
+        if (stamp_counts_[chart_i] != 1 + set.hole_stamps.size()) return false;
+        if (stamp_i + stamp_counts_[chart_i] > stamps_.size()) return false;
+
+        if (stamps_[stamp_i++] != set.boundary_stamp) return false;
+        for (const auto& stamp : set.hole_stamps) {
+            if (stamps_[stamp_i++] != stamp) return false;
+        }
+        chart_i++;
+    }
+    return true;
+}
+
+ModelManifest ModelManifest::build(const ModelFileIndex& files) {
+    ModelManifest manifest;
+    std::map<int, Chart2D> charts = load_model_charts_raw(files);
+
+    float global_max_dim = 0.0f;
+    for (const auto& pair : files) {
+        const ChartFileSet& set = pair.second;
+        const Chart2D& chart = charts[pair.first];
+
+        ManifestChartEntry e;
+        e.chart_index = pair.first;
+        e.hole_count = (uint32_t)chart.holes.size();
+        e.boundary_vertex_count = (uint32_t)chart.boundary.size();
+        for (const auto& hole : chart.holes) e.hole_vertex_count += (uint32_t)hole.size();
+
+        if (chart.IsValid()) {
+            glm::vec2 min_c = chart.boundary[0], max_c = chart.boundary[0];
+            for (const auto& v : chart.boundary) {
+                min_c.x = std::min(min_c.x, v.x); min_c.y = std::min(min_c.y, v.y);
+                max_c.x = std::max(max_c.x, v.x); max_c.y = std::max(max_c.y, v.y);
+            }
+            e.aabb[0] = min_c.x; e.aabb[1] = min_c.y; e.aabb[2] = max_c.x; e.aabb[3] = max_c.y;
+            global_max_dim = std::max(global_max_dim, std::max(max_c.x - min_c.x, max_c.y - min_c.y));
+        }
+        manifest.charts_.push_back(e);
+
+        manifest.stamps_.push_back(set.boundary_stamp);
+        manifest.stamps_.insert(manifest.stamps_.end(), set.hole_stamps.begin(), set.hole_stamps.end());
+        manifest.stamp_counts_.push_back((uint32_t)(1 + set.hole_stamps.size()));
+    }
+
+    // 与 compute_global_scale 相同：让整个模型中最大的部分适应 10.0 的视口
+    manifest.global_scale_ = (global_max_dim < 1e-6f) ? 1.0f : 10.0f / global_max_dim;
+    return manifest;
+}
+
+const ManifestChartEntry* ModelManifest::find_chart(int chart_index) const {
+    auto it = std::lower_bound(charts_.begin(), charts_.end(), chart_index,
+        [](const ManifestChartEntry& e, int idx) { return e.chart_index < idx; });
+    return (it != charts_.end() && it->chart_index == chart_index) ? &*it : nullptr;
+}
+
+ModelManifest load_or_build_manifest(const std::string& manifest_path, const ModelFileIndex& files) {
+    ModelManifest manifest;
+    if (manifest.load(manifest_path) && manifest.matches(files)) {
+        return manifest;
+    }
+
+    std::cout << "[Manifest] '" << manifest_path << "' missing or stale, rebuilding..." << std::endl;
+    manifest = ModelManifest::build(files);
+    if (!manifest.save(manifest_path)) {
+        std::cerr << "Warning: could not write manifest " << manifest_path << std::endl;
+    }
+    return manifest;
+}
@@ -0,0 +1,45 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ChartLoader.h"
+
+// 模型清单 (exportdata/<模型名>.manifest)
+// 记录每个 chart 的 AABB、顶点数、洞数以及整个模型的全局缩放比例，
+// 启动时只需读这一个小文件，而不必把所有 boundary 文件重新解析一遍。
+// 清单同时保存了每个源文件的 大小 + 修改时间，任何一个对不上就视为过期并重建。
+
+struct ManifestChartEntry {
+    int32_t chart_index = -1;
+    uint32_t hole_count = 0;             // 实际加载到的洞数
+    uint32_t boundary_vertex_count = 0;
+    uint32_t hole_vertex_count = 0;      // 所有洞的顶点总数
+    float aabb[4] = { 0, 0, 0, 0 };      // 外环 (未归一化) 的 x_min, y_min, x_max, y_max
+};
+
+class ModelManifest {
+public:
+    // 从磁盘读取，文件不存在或格式不符时返回 false
+    bool load(const std::string& path);
+    // 原子写入 (先写临时文件再 rename)
+    bool save(const std::string& path) const;
+
+    // 与当前目录扫描结果比较：chart 集合、文件数量、大小和修改时间都一致才算有效
+    bool matches(const ModelFileIndex& files) const;
+
+    // 加载 (并行) 模型的所有 chart，统计元数据
+    static ModelManifest build(const ModelFileIndex& files);
+
+    float get_global_scale() const { return global_scale_; }
+    const std::vector<ManifestChartEntry>& get_charts() const { return charts_; }
+    const ManifestChartEntry* find_chart(int chart_index) const;
+
+private:
+    float global_scale_ = 1.0f;
+    std::vector<ManifestChartEntry> charts_;   // 按 chart 编号升序
+    std::vector<FileStamp> stamps_;            // 每个 chart: boundary 在前，随后是各个 hole 文件
+    std::vector<uint32_t> stamp_counts_;       // 每个 chart 对应的文件数
+};
+
+// 读取清单，过期或缺失时重建并写回
+ModelManifest load_or_build_manifest(const std::string& manifest_path, const ModelFileIndex& files);
@@ -0,0 +1,611 @@
+﻿#include "NativeDelaunay.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <sstream>
+
+// ================= 精确谓词 =================
+// 双精度过滤 (Shewchuk 的静态误差界)，不确定时用无重叠扩展 (expansion) 精确求值
+namespace {
+    typedef std::vector<double> Expansion;
+
+    inline void two_sum(double a, double b, double& x, double& y) {
+        x = a + b;
+        double bv = x - a;
+        double av = x - bv;
+        y = (a - av) + (b - bv);
+    }
+
+    inline void two_product(double a, double b, double& x, double& y) {
+        x = a * b;
+        y = std::fma(a, b, -x);
+    }
+
+    // e + f (e, f 按幅值递增、无重叠)，逐项 grow，并去掉零分量
+    Expansion expansion_sum(const Expansion& e, const Expansion& f) {
+        Expansion h = e;
+        for (double b : f) {
+            Expansion g;
+            g.reserve(h.size() + 1);
+            double q = b;
+            for (double hv : h) {
+                double sum, err;
+                two_sum(q, hv, sum, err);
+                if (err != 0.0) g.push_back(err);
+                q = sum;
+            }
+            if (q != 0.0 || g.empty()) g.push_back(q);
+            h.swap(g);
+        }
+        return h;
+    }
+
+    Expansion scale_expansion(const Expansion& e, double b) {
+        Expansion h;
+        h.reserve(e.size() * 2);
+        double q = 0.0;
+        for (size_t i = 0; i < e.size(); ++i) {
+            double hi, lo;
+            two_product(e[i], b, hi, lo);
+            if (i == 0) {
+                if (lo != 0.0) h.push_back(lo);
+                q = hi;
+                continue;
+            }
+            double sum, err;
+            two_sum(q, lo, sum, err);
+            if (err != 0.0) h.push_back(err);
+            two_sum(hi, sum, q, err);
+            if (err != 0.0) h.push_back(err);
+        }
+        if (q != 0.0 || h.empty()) h.push_back(q);
+        return h;
+    }
+
+    Expansion multiply(const Expansion& e, const Expansion& f) {
+        Expansion h{ 0.0 };
+        for (double b : f) h = expansion_sum(h, scale_expansion(e, b));
+        return h;
+    }
+
+    Expansion difference(double a, double b) {
+        double x, y;
+        two_sum(a, -b, x, y);
+        if (y == 0.0) return Expansion{ x };
+        return Expansion{ y, x };
+    }
+
+    Expansion negate(Expansion e) {
+        for (auto& v : e) v = -v;
+        return e;
+    }
+
+    // 最高位非零分量的符号即整体符号
+    int sign(const Expansion& e) {
+        for (size_t i = e.size(); i-- > 0;) {
+            if (e[i] > 0.0) return 1;
+            if (e[i] < 0.0) return -1;
+        }
+        return 0;
+    }
+
+    const double kEpsilon = 1.1102230246251565e-16; // 2^-53
+    const double kCcwErrBound = (3.0 + 16.0 * kEpsilon) * kEpsilon;
+    const double kIccErrBound = (10.0 + 96.0 * kEpsilon) * kEpsilon;
+
+    int orient2d(double ax, double ay, double bx, double by, double cx, double cy) {
+        double detleft = (ax - cx) * (by - cy);
+        double detright = (ay - cy) * (bx - cx);
+        double det = detleft - detright;
+        double bound = kCcwErrBound * (std::abs(detleft) + std::abs(detright));
+        if (det > bound) return 1;
+        if (-det > bound) return -1;
+
+        Expansion l = multiply(difference(ax, cx), difference(by, cy));
+        Expansion r = multiply(difference(ay, cy), difference(bx, cx));
+        return sign(expansion_sum(l, negate(r)));
+    }
+
+    int incircle2d(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy) {
+        double adx = ax - dx, ady = ay - dy;
+        double bdx = bx - dx, bdy = by - dy;
+        double cdx = cx - dx, cdy = cy - dy;
+        double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy, alift = adx * adx + ady * ady;
+        double cdxady = cdx * ady, adxcdy = adx * cdy, blift = bdx * bdx + bdy * bdy;
+        double adxbdy = adx * bdy, bdxady = bdx * ady, clift = cdx * cdx + cdy * cdy;
+        double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+        double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift
+            + (std::abs(cdxady) + std::abs(adxcdy)) * blift
+            + (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+        double bound = kIccErrBound * permanent;
+        if (det > bound) return 1;
+        if (-det > bound) return -1;
+
+        Expansion eadx = difference(ax, dx), eady = difference(ay, dy);
+        Expansion ebdx = difference(bx, dx), ebdy = difference(by, dy);
+        Expansion ecdx = difference(cx, dx), ecdy = difference(cy, dy);
+        Expansion ea = expansion_sum(multiply(eadx, eadx), multiply(eady, eady));
+        Expansion eb = expansion_sum(multiply(ebdx, ebdx), multiply(ebdy, ebdy));
+        Expansion ec = expansion_sum(multiply(ecdx, ecdx), multiply(ecdy, ecdy));
+        Expansion bc = expansion_sum(multiply(ebdx, ecdy), negate(multiply(ecdx, ebdy)));
+        Expansion ca = expansion_sum(multiply(ecdx, eady), negate(multiply(eadx, ecdy)));
+        Expansion ab = expansion_sum(multiply(eadx, ebdy), negate(multiply(ebdx, eady)));
+        Expansion total = expansion_sum(expansion_sum(multiply(ea, bc), multiply(eb, ca)), multiply(ec, ab));
+        return sign(total);
+    }
+
+    // 16 位交错的 Morton 码
+    inline uint64_t spread_bits(uint32_t v) {
+        uint64_t x = v;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x << 2)) & 0x3333333333333333ull;
+        x = (x | (x << 1)) & 0x5555555555555555ull;
+        return x;
+    }
+}
+
+int NativeTriangulationBackend::orient(unsigned int a, unsigned int b, unsigned int c) const {
+    return orient2d(px_[a], py_[a], px_[b], py_[b], px_[c], py_[c]);
+}
+
+// > 0：d 在三角形 (a, b, c) (逆时针) 的外接圆内
+int NativeTriangulationBackend::incircle(unsigned int a, unsigned int b, unsigned int c, unsigned int d) const {
+    return incircle2d(px_[a], py_[a], px_[b], py_[b], px_[c], py_[c], px_[d], py_[d]);
+}
+
+// ================= 拓扑基本操作 =================
+
+int NativeTriangulationBackend::new_triangle() {
+    int t = (int)(tv_.size() / 3);
+    tv_.resize(tv_.size() + 3, kNone);
+    tn_.resize(tn_.size() + 3, -1);
+    tc_.resize(tc_.size() + 3, 0);
+    return t;
+}
+
+void NativeTriangulationBackend::set_triangle(int t, unsigned int a, unsigned int b, unsigned int c) {
+    tv_[3 * t] = a;
+    tv_[3 * t + 1] = b;
+    tv_[3 * t + 2] = c;
+    vt_[a] = vt_[b] = vt_[c] = t;
+}
+
+void NativeTriangulationBackend::link(int he, int other, uint8_t constrained) {
+    tn_[he] = other;
+    tc_[he] = constrained;
+    if (other >= 0) {
+        tn_[other] = he;
+        tc_[other] = constrained;
+    }
+}
+
+// 可见性行走：跨过 p 所在一侧为负的边，起始边随机化以避免退化时循环
+int NativeTriangulationBackend::locate(unsigned int p, int& tri, int& edge, unsigned int& vertex) {
+    int t = last_;
+    while (true) {
+        walk_seed_ = walk_seed_ * 1103515245u + 12345u;
+        int start = (int)((walk_seed_ >> 16) % 3);
+        int zero_count = 0, zero_edges[2] = { -1, -1 };
+        bool moved = false;
+        for (int k = 0; k < 3; ++k) {
+            int i = (start + k) % 3;
+            unsigned int a = tv_[3 * t + (i + 1) % 3], b = tv_[3 * t + (i + 2) % 3];
+            int o = orient(a, b, p);
+            if (o < 0) {
+                t = tn_[3 * t + i] / 3;
+                moved = true;
+                break;
+            }
+            if (o == 0 && zero_count < 2) zero_edges[zero_count++] = i;
+        }
+        if (moved) continue;
+
+        tri = t;
+        if (zero_count == 0) return 0;
+        if (zero_count == 1) {
+            edge = zero_edges[0];
+            return 1;
+        }
+        vertex = tv_[3 * t + (3 - zero_edges[0] - zero_edges[1])];
+        return 2;
+    }
+}
+
+// (a, b, c) + 内部点 p -> (p, b, c), (p, c, a), (p, a, b)
+void NativeTriangulationBackend::split_triangle(int t, unsigned int p) {
+    unsigned int a = tv_[3 * t], b = tv_[3 * t + 1], c = tv_[3 * t + 2];
+    int na = tn_[3 * t], nb = tn_[3 * t + 1], nc = tn_[3 * t + 2];
+    uint8_t ca = tc_[3 * t], cb = tc_[3 * t + 1], cc = tc_[3 * t + 2];
+    int t1 = new_triangle(), t2 = new_triangle();
+
+    set_triangle(t, p, b, c);
+    set_triangle(t1, p, c, a);
+    set_triangle(t2, p, a, b);
+    link(3 * t, na, ca);
+    link(3 * t1, nb, cb);
+    link(3 * t2, nc, cc);
+    link(3 * t + 1, 3 * t1 + 2, 0);
+    link(3 * t + 2, 3 * t2 + 1, 0);
+    link(3 * t1 + 1, 3 * t2 + 2, 0);
+
+    legalize_stack_.push_back(3 * t);
+    legalize_stack_.push_back(3 * t1);
+    legalize_stack_.push_back(3 * t2);
+    last_ = t;
+}
+
+// p 落在 t 的边 i (a-b) 上：(x, a, b) + (y, b, a) -> 4 个三角形
+void NativeTriangulationBackend::split_edge(int t, int i, unsigned int p) {
+    int n = tn_[3 * t + i];
+    int t2 = n / 3, j = n % 3;
+    unsigned int x = tv_[3 * t + i], a = tv_[3 * t + (i + 1) % 3], b = tv_[3 * t + (i + 2) % 3];
+    unsigned int y = tv_[3 * t2 + j];
+    uint8_t c_ab = tc_[3 * t + i];
+    int n_bx = tn_[3 * t + (i + 1) % 3], n_xa = tn_[3 * t + (i + 2) % 3];
+    uint8_t c_bx = tc_[3 * t + (i + 1) % 3], c_xa = tc_[3 * t + (i + 2) % 3];
+    int n_ay = tn_[3 * t2 + (j + 1) % 3], n_yb = tn_[3 * t2 + (j + 2) % 3];
+    uint8_t c_ay = tc_[3 * t2 + (j + 1) % 3], c_yb = tc_[3 * t2 + (j + 2) % 3];
+    int t3 = new_triangle(), t4 = new_triangle();
+
+    set_triangle(t, p, x, a);
+    set_triangle(t3, p, b, x);
+    set_triangle(t2, p, y, b);
+    set_triangle(t4, p, a, y);
+    link(3 * t, n_xa, c_xa);
+    link(3 * t3, n_bx, c_bx);
+    link(3 * t2, n_yb, c_yb);
+    link(3 * t4, n_ay, c_ay);
+    link(3 * t + 2, 3 * t3 + 1, 0);
+    link(3 * t3 + 2, 3 * t2 + 1, c_ab);
+    link(3 * t2 + 2, 3 * t4 + 1, 0);
+    link(3 * t4 + 2, 3 * t + 1, c_ab);
+
+    legalize_stack_.push_back(3 * t);
+    legalize_stack_.push_back(3 * t3);
+    legalize_stack_.push_back(3 * t2);
+    legalize_stack_.push_back(3 * t4);
+    last_ = t;
+}
+
+// 翻转 t 的边 i：(p, a, b) + (w, b, a) -> (p, a, w) + (w, b, p)
+void NativeTriangulationBackend::flip(int t, int i) {
+    int n = tn_[3 * t + i];
+    int t2 = n / 3, j = n % 3;
+    unsigned int p = tv_[3 * t + i], a = tv_[3 * t + (i + 1) % 3], b = tv_[3 * t + (i + 2) % 3];
+    unsigned int w = tv_[3 * t2 + j];
+    int n_bp = tn_[3 * t + (i + 1) % 3], n_pa = tn_[3 * t + (i + 2) % 3];
+    uint8_t c_bp = tc_[3 * t + (i + 1) % 3], c_pa = tc_[3 * t + (i + 2) % 3];
+    int n_aw = tn_[3 * t2 + (j + 1) % 3], n_wb = tn_[3 * t2 + (j + 2) % 3];
+    uint8_t c_aw = tc_[3 * t2 + (j + 1) % 3], c_wb = tc_[3 * t2 + (j + 2) % 3];
+
+    set_triangle(t, p, a, w);
+    set_triangle(t2, w, b, p);
+    link(3 * t, n_aw, c_aw);
+    link(3 * t + 2, n_pa, c_pa);
+    link(3 * t2, n_bp, c_bp);
+    link(3 * t2 + 2, n_wb, c_wb);
+    link(3 * t + 1, 3 * t2 + 1, 0);
+}
+
+// 新点总在三角形的角点 0，待检查的边是它的对边；翻转后对边为 (t, 0) 与 (t2, 2)
+void NativeTriangulationBackend::legalize() {
+    while (!legalize_stack_.empty()) {
+        int he = legalize_stack_.back();
+        legalize_stack_.pop_back();
+        int n = tn_[he];
+        if (n < 0 || tc_[he]) continue;
+        int t = he / 3, i = he % 3;
+        int t2 = n / 3;
+        if (incircle(tv_[3 * t], tv_[3 * t + 1], tv_[3 * t + 2], tv_[n]) > 0) {
+            flip(t, i);
+            legalize_stack_.push_back(3 * t);
+            legalize_stack_.push_back(3 * t2 + 2);
+        }
+    }
+}
+
+void NativeTriangulationBackend::insert_point(unsigned int p) {
+    int t, edge;
+    unsigned int vertex;
+    int kind = locate(p, t, edge, vertex);
+    if (kind == 2) return; // 重合点已在去重时合并，这里只会是包围顶点之外的极端情况
+    if (kind == 0) split_triangle(t, p);
+    else split_edge(t, edge, p);
+    legalize();
+}
+
+// ================= 约束恢复 =================
+
+// 绕 u 旋转查找边 (u, v)，返回该边的任一半边
+bool NativeTriangulationBackend::find_edge(unsigned int u, unsigned int v, int& he) const {
+    auto corner = [&](int t) { return (tv_[3 * t] == u) ? 0 : (tv_[3 * t + 1] == u ? 1 : 2); };
+    auto scan = [&](int t, int k) {
+        if (tv_[3 * t + (k + 1) % 3] == v) { he = 3 * t + (k + 2) % 3; return true; }
+        if (tv_[3 * t + (k + 2) % 3] == v) { he = 3 * t + (k + 1) % 3; return true; }
+        return false;
+    };
+
+    // 逆时针绕 u 一圈
+    const int start = vt_[u];
+    int t = start;
+    while (true) {
+        int k = corner(t);
+        if (scan(t, k)) return true;
+        int n = tn_[3 * t + (k + 1) % 3];
+        if (n < 0) break;
+        t = n / 3;
+        if (t == start) return false;
+    }
+    // 碰到外边界 (只有包围顶点会出现)，再顺时针找另一侧
+    t = start;
+    while (true) {
+        int k = corner(t);
+        if (scan(t, k)) return true;
+        int n = tn_[3 * t + (k + 2) % 3];
+        if (n < 0) return false;
+        t = n / 3;
+    }
+}
+
+// 从 a 出发沿线段 a-b 收集穿过的边；遇到线段上的顶点时返回该顶点 (collinear)。
+// [修改] 穿过已有约束边 (两条约束相交) 时返回 false：翻边法会把先插入的约束翻掉
+bool NativeTriangulationBackend::collect_crossings(unsigned int a, unsigned int b,
+    std::vector<std::pair<unsigned int, unsigned int>>& crossing, unsigned int& collinear) {
+    crossing.clear();
+    collinear = kNone;
+    auto on_ray = [&](unsigned int q) {
+        return (px_[q] - px_[a]) * (px_[b] - px_[a]) + (py_[q] - py_[a]) * (py_[b] - py_[a]) > 0.0;
+    };
+
+    // 1. 绕 a 找到线段离开 a 时所在的三角形
+    int start = vt_[a], t = start, k = 0;
+    unsigned int right = kNone, left = kNone;
+    do {
+        k = (tv_[3 * t] == a) ? 0 : (tv_[3 * t + 1] == a ? 1 : 2);
+        unsigned int p = tv_[3 * t + (k + 1) % 3], q = tv_[3 * t + (k + 2) % 3];
+        int o1 = orient(a, p, b), o2 = orient(a, q, b);
+        if (o1 == 0 && on_ray(p)) { collinear = p; return true; }
+        if (o2 == 0 && on_ray(q)) { collinear = q; return true; }
+        if (o1 > 0 && o2 < 0) { right = p; left = q; break; }
+        int n = tn_[3 * t + (k + 1) % 3];
+        if (n < 0) return false;
+        t = n / 3;
+    } while (t != start);
+    if (right == kNone) return false;
+    crossing.emplace_back(right, left);
+
+    // 2. 沿线段逐个三角形前进
+    int he = 3 * t + k;
+    while (true) {
+        if (tc_[he]) return false;
+        int n = tn_[he];
+        if (n < 0) return false;
+        int t2 = n / 3;
+        unsigned int w = tv_[n];
+        if (w == b) return true;
+        int o = orient(a, b, w);
+        if (o == 0) { collinear = w; return true; }
+        unsigned int keep = (o > 0) ? right : left;      // 与 w 异侧的端点保留
+        unsigned int drop = (o > 0) ? left : right;      // 被 w 替换的端点
+        int kd = (tv_[3 * t2] == drop) ? 0 : (tv_[3 * t2 + 1] == drop ? 1 : 2);
+        he = 3 * t2 + kd;                                 // 对着被替换端点的边 (keep, w)
+        if (o > 0) left = w; else right = w;
+        crossing.emplace_back(keep, w);
+    }
+}
+
+// Sloan: 反复翻转与 a-b 相交且所在四边形为凸的边，直到 a-b 成为三角剖分的边
+bool NativeTriangulationBackend::insert_constraint(unsigned int a, unsigned int b) {
+    std::vector<std::pair<unsigned int, unsigned int>> work{ { a, b } };
+    std::vector<std::pair<unsigned int, unsigned int>> crossing;
+    while (!work.empty()) {
+        std::pair<unsigned int, unsigned int> seg = work.back();
+        work.pop_back();
+        a = seg.first;
+        b = seg.second;
+        if (a == b) continue;
+
+        int he;
+        if (!find_edge(a, b, he)) {
+            unsigned int collinear;
+            if (!collect_crossings(a, b, crossing, collinear)) return false;
+            if (collinear != kNone) {
+                work.emplace_back(collinear, b);
+                work.emplace_back(a, collinear);
+                continue;
+            }
+
+            std::deque<std::pair<unsigned int, unsigned int>> queue(crossing.begin(), crossing.end());
+            size_t guard = 64 + 16 * crossing.size() * crossing.size();
+            while (!queue.empty()) {
+                if (guard-- == 0) return false;
+                std::pair<unsigned int, unsigned int> e = queue.front();
+                queue.pop_front();
+                int eh;
+                if (!find_edge(e.first, e.second, eh) || tn_[eh] < 0) return false;
+                int t = eh / 3, i = eh % 3;
+                unsigned int x = tv_[eh], y = tv_[tn_[eh]];
+                // 四边形严格凸 <=> u、v 在对角线 x-y 的两侧
+                if (orient(x, y, e.first) * orient(x, y, e.second) >= 0) {
+                    queue.push_back(e);
+                    continue;
+                }
+                flip(t, i);
+                if (x != a && x != b && y != a && y != b && orient(a, b, x) * orient(a, b, y) < 0) {
+                    queue.emplace_back(x, y);
+                }
+            }
+            if (!find_edge(a, b, he)) return false;
+        }
+        link(he, tn_[he], 1);
+        constraint_segments_.emplace_back(a, b);
+    }
+    return true;
+}
+
+// 全局 Lawson 翻边 (约束边不动)，恢复约束 Delaunay 性质
+void NativeTriangulationBackend::restore_delaunay() {
+    legalize_stack_.clear();
+    int tri_count = (int)(tv_.size() / 3);
+    for (int he = 0; he < tri_count * 3; ++he) legalize_stack_.push_back(he);
+    while (!legalize_stack_.empty()) {
+        int he = legalize_stack_.back();
+        legalize_stack_.pop_back();
+        int n = tn_[he];
+        if (n < 0 || tc_[he]) continue;
+        int t = he / 3, i = he % 3, t2 = n / 3;
+        if (incircle(tv_[3 * t], tv_[3 * t + 1], tv_[3 * t + 2], tv_[n]) > 0) {
+            flip(t, i);
+            for (int k = 0; k < 3; ++k) {
+                legalize_stack_.push_back(3 * t + k);
+                legalize_stack_.push_back(3 * t2 + k);
+            }
+        }
+    }
+}
+
+// 与 mark_domains 相同的规则：从外部 (含包围顶点的三角形) 出发，每穿过一条约束边层级 +1
+void NativeTriangulationBackend::mark_domains(std::vector<int>& level) const {
+    const int tri_count = (int)(tv_.size() / 3);
+    level.assign(tri_count, -1);
+    std::vector<std::pair<int, int>> border;
+    std::vector<int> queue;
+    auto flood = [&](int start, int lvl) {
+        if (level[start] != -1) return;
+        level[start] = lvl;
+        queue.assign(1, start);
+        while (!queue.empty()) {
+            int t = queue.back();
+            queue.pop_back();
+            for (int i = 0; i < 3; ++i) {
+                int n = tn_[3 * t + i];
+                if (n < 0 || level[n / 3] != -1) continue;
+                if (tc_[3 * t + i]) border.emplace_back(n / 3, lvl + 1);
+                else {
+                    level[n / 3] = lvl;
+                    queue.push_back(n / 3);
+                }
+            }
+        }
+    };
+    for (int t = 0; t < tri_count; ++t) {
+        if (tv_[3 * t] >= point_count_ || tv_[3 * t + 1] >= point_count_ || tv_[3 * t + 2] >= point_count_) flood(t, 0);
+    }
+    for (size_t head = 0; head < border.size(); ++head) flood(border[head].first, border[head].second);
+}
+
+// ================= 入口 =================
+
+bool NativeTriangulationBackend::triangulate(const TriangulationInput& input, TriangulationResult& result) {
+    result.triangles.clear();
+    result.neighbors.clear();
+    point_count_ = (unsigned int)input.points.size();
+    if (point_count_ < 3) return false;
+
+    px_.resize(point_count_ + 3);
+    py_.resize(point_count_ + 3);
+    double min_x = 1e300, min_y = 1e300, max_x = -1e300, max_y = -1e300;
+    for (unsigned int i = 0; i < point_count_; ++i) {
+        px_[i] = input.points[i].x;
+        py_[i] = input.points[i].y;
+        min_x = std::min(min_x, px_[i]); max_x = std::max(max_x, px_[i]);
+        min_y = std::min(min_y, py_[i]); max_y = std::max(max_y, py_[i]);
+    }
+
+    // 包围三角形：坐标取 float 可表示的值，保证与输入点的坐标差在双精度下精确
+    double cx = 0.5 * (min_x + max_x), cy = 0.5 * (min_y + max_y);
+    double d = std::max(std::max(max_x - min_x, max_y - min_y), 1e-6);
+    const unsigned int s0 = point_count_, s1 = point_count_ + 1, s2 = point_count_ + 2;
+    px_[s0] = (float)(cx - 20.0 * d); py_[s0] = (float)(cy - 10.0 * d);
+    px_[s1] = (float)(cx + 20.0 * d); py_[s1] = (float)(cy - 10.0 * d);
+    px_[s2] = (float)cx;              py_[s2] = (float)(cy + 20.0 * d);
+
+    tv_.clear(); tn_.clear(); tc_.clear();
+    tv_.reserve((size_t)point_count_ * 6 + 3);
+    tn_.reserve((size_t)point_count_ * 6 + 3);
+    tc_.reserve((size_t)point_count_ * 6 + 3);
+    vt_.assign(point_count_ + 3, -1);
+    set_triangle(new_triangle(), s0, s1, s2);
+    last_ = 0;
+
+    // 重合点只插入代表点，按 Morton 码排序后插入
+    std::vector<unsigned int> canonical = canonical_source_ids(input.points);
+    double qx = 65535.0 / std::max(max_x - min_x, 1e-30), qy = 65535.0 / std::max(max_y - min_y, 1e-30);
+    std::vector<std::pair<uint64_t, unsigned int>> order;
+    order.reserve(point_count_);
+    for (unsigned int i = 0; i < point_count_; ++i) {
+        if (canonical[i] != i) continue;
+        uint32_t ix = (uint32_t)((px_[i] - min_x) * qx), iy = (uint32_t)((py_[i] - min_y) * qy);
+        order.emplace_back(spread_bits(ix) | (spread_bits(iy) << 1), i);
+    }
+    std::sort(order.begin(), order.end());
+    for (const auto& o : order) insert_point(o.second);
+
+    constraints_.clear();
+    constraint_segments_.clear();
+    constraint_offsets_.assign(1, 0);
+    for (const auto& c : input.constraints) {
+        unsigned int a = canonical[c.first], b = canonical[c.second];
+        if (a == b) continue;
+        constraints_.emplace_back(a, b);
+        bool inserted = insert_constraint(a, b);
+        constraint_offsets_.push_back((unsigned int)constraint_segments_.size());
+        if (!inserted) return false;
+    }
+    restore_delaunay();
+
+    std::vector<int> level;
+    mark_domains(level);
+    const int tri_count = (int)(tv_.size() / 3);
+    // 域内三角形重新编号，邻接直接由 tn_ 换算
+    std::vector<int> out_index(tri_count, -1);
+    result.triangles.reserve(tri_count);
+    for (int t = 0; t < tri_count; ++t) {
+        if (level[t] % 2 != 1) continue;
+        out_index[t] = (int)result.triangles.size();
+        result.triangles.push_back({ tv_[3 * t], tv_[3 * t + 1], tv_[3 * t + 2] });
+    }
+    result.neighbors.resize(result.triangles.size());
+    for (int t = 0; t < tri_count; ++t) {
+        if (out_index[t] < 0) continue;
+        for (int i = 0; i < 3; ++i) {
+            int n = tn_[3 * t + i];
+            result.neighbors[out_index[t]][i] = n < 0 ? -1 : out_index[n / 3];
+        }
+    }
+    return true;
+}
+
+bool NativeTriangulationBackend::check_constrained_delaunay(std::string& report) const {
+    size_t inverted = 0, non_delaunay = 0, missing_constraints = 0, broken_links = 0;
+    const int tri_count = (int)(tv_.size() / 3);
+    for (int t = 0; t < tri_count; ++t) {
+        if (orient(tv_[3 * t], tv_[3 * t + 1], tv_[3 * t + 2]) <= 0) inverted++;
+        for (int i = 0; i < 3; ++i) {
+            int n = tn_[3 * t + i];
+            if (n < 0) continue;
+            if (tn_[n] != 3 * t + i || tc_[n] != tc_[3 * t + i]) broken_links++;
+            if (!tc_[3 * t + i] && incircle(tv_[3 * t], tv_[3 * t + 1], tv_[3 * t + 2], tv_[n]) > 0) non_delaunay++;
+        }
+    }
+    // [修改] 约束在共线点处被拆分，按实际标记的子线段校验：子线段首尾相接地从 a 走到 b、都在 a-b 上且都已标记
+    for (size_t i = 0; i < constraints_.size() && i + 1 < constraint_offsets_.size(); ++i) {
+        const unsigned int a = constraints_[i].first, b = constraints_[i].second;
+        unsigned int at = a;
+        bool ok = constraint_offsets_[i] < constraint_offsets_[i + 1];
+        for (unsigned int k = constraint_offsets_[i]; k < constraint_offsets_[i + 1] && ok; ++k) {
+            const auto& seg = constraint_segments_[k];
+            int he;
+            ok = seg.first == at && orient(a, b, seg.second) == 0 && find_edge(seg.first, seg.second, he) && tc_[he];
+            at = seg.second;
+        }
+        if (!ok || at != b) missing_constraints++;
+    }
+    std::ostringstream ss;
+    ss << tri_count << " triangles, " << inverted << " inverted, " << non_delaunay << " non-Delaunay edges, "
+        << missing_constraints << " missing constraints, " << broken_links << " broken links";
+    report = ss.str();
+    return inverted == 0 && non_delaunay == 0 && missing_constraints == 0 && broken_links == 0;
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TriangulationBackend.h"
+
+// 轻量约束 Delaunay 三角化 (只依赖平铺数组)
+//
+//   1. 点按 Morton 码排序后逐点插入 (包围三角形 + 从上一个三角形出发的可见性行走定位)，
+//      插入后做 Lawson 翻边；
+//   2. 约束边用 Sloan 的翻边法恢复 (约束穿过共线点时在该点处拆分，与已有约束相交时失败)；
+//   3. 全局 Lawson 翻边 (跳过约束边) 得到约束 Delaunay；
+//   4. 从包含包围顶点的三角形 (外部) 出发按穿过约束边的次数标记嵌套层级。
+// orient / incircle 使用带误差界的浮点过滤 + 扩展精度精确回退，结果与输入顺序无关
+// (共圆的退化情况除外，此时对角线的选择可能与 CGAL 不同)。
+//
+// 数据布局：三角形 t 的角点 i 为 tv_[3t+i] (逆时针)，边 i 对着角点 i，
+// tn_[3t+i] 为同一条边在相邻三角形中的半边编号 (3t'+j，-1 表示没有)，tc_ 为约束标记。
+class NativeTriangulationBackend : public TriangulationBackend {
+public:
+    const char* name() const override { return "native"; }
+    bool triangulate(const TriangulationInput& input, TriangulationResult& result) override;
+
+    // 校验上一次的结果：所有三角形为正向，非约束边满足局部 Delaunay，所有约束 (按拆分后的子线段) 都存在。
+    // 局部 Delaunay 在约束三角化中等价于全局约束 Delaunay
+    bool check_constrained_delaunay(std::string& report) const;
+
+private:
+    static constexpr unsigned int kNone = 0xFFFFFFFFu;
+
+    int orient(unsigned int a, unsigned int b, unsigned int c) const;
+    int incircle(unsigned int a, unsigned int b, unsigned int c, unsigned int d) const;
+
+    int new_triangle();
+    void set_triangle(int t, unsigned int a, unsigned int b, unsigned int c);
+    void link(int he, int other, uint8_t constrained);
+
+    // 返回 0 = 在三角形内部, 1 = 在边 edge 上, 2 = 与顶点 vertex 重合
+    int locate(unsigned int p, int& tri, int& edge, unsigned int& vertex);
+    void insert_point(unsigned int p);
+    void split_triangle(int t, unsigned int p);
+    void split_edge(int t, int i, unsigned int p);
+    void flip(int t, int i);
+    void legalize();
+
+    bool find_edge(unsigned int u, unsigned int v, int& he) const;
+    bool insert_constraint(unsigned int a, unsigned int b);
+    bool collect_crossings(unsigned int a, unsigned int b, std::vector<std::pair<unsigned int, unsigned int>>& crossing, unsigned int& collinear);
+    void restore_delaunay();
+    void mark_domains(std::vector<int>& level) const;
+
+    std::vector<double> px_, py_;       // 点坐标 (末尾 3 个为包围三角形顶点)
+    unsigned int point_count_ = 0;      // 输入点数
+    std::vector<unsigned int> tv_;
+    std::vector<int> tn_;
+    std::vector<uint8_t> tc_;
+    std::vector<int> vt_;               // 顶点 -> 某个关联三角形
+    std::vector<int> legalize_stack_;
+    int last_ = 0;                      // 上次插入的三角形，作为下一次定位的起点
+    uint32_t walk_seed_ = 1;
+    std::vector<std::pair<unsigned int, unsigned int>> constraints_; // 已去重的约束，供校验
+    // [新增] 实际标记的子线段 (约束在共线点处拆分)，约束 i 对应 [constraint_offsets_[i], constraint_offsets_[i+1])，按 a -> b 排列
+    std::vector<std::pair<unsigned int, unsigned int>> constraint_segments_;
+    std::vector<unsigned int> constraint_offsets_;
+};
@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+// 默认线程数：硬件并发数 (取不到时用 4)
+inline unsigned int default_thread_count() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 4;
+}
+
+// 简单的并行 for：对 [begin, end) 中的每个 i 调用 fn(i)
+// 以 grain 为单位动态分块，适合每个元素耗时不均匀的情况 (例如逐文件加载)
+template <typename Func>
+void parallel_for(size_t begin, size_t end, Func&& fn, unsigned int num_threads = 0, size_t grain = 1) {
+    if (end <= begin) return;
+    if (num_threads == 0) num_threads = default_thread_count();
+    if (grain == 0) grain = 1;
+
+    size_t count = end - begin;
+    size_t max_useful = (count + grain - 1) / grain;
+    num_threads = (unsigned int)std::min<size_t>(num_threads, max_useful);
+
+    if (num_threads <= 1) {
+        for (size_t i = begin; i < end; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next(begin);
+    auto worker = [&]() {
+        while (true) {
+            size_t lo = next.fetch_add(grain);
+            if (lo >= end) break;
+            size_t hi = std::min(end, lo + grain);
+            for (size_t i = lo; i < hi; ++i) fn(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (unsigned int t = 1; t < num_threads; ++t) threads.emplace_back(worker);
+    worker(); // 当前线程也参与
+    for (auto& th : threads) th.join();
+}
+
+// 静态切块版本：把 [begin, end) 平均切成 num_threads 段，调用 fn(lo, hi, thread_index)
+// 适合每个元素耗时均匀、且需要线程私有累加器的情况
+template <typename Func>
+void parallel_for_range(size_t begin, size_t end, Func&& fn, unsigned int num_threads = 0) {
+    if (end <= begin) return;
+    if (num_threads == 0) num_threads = default_thread_count();
+    size_t count = end - begin;
+    num_threads = (unsigned int)std::min<size_t>(num_threads, count);
+
+    if (num_threads <= 1) {
+        fn(begin, end, 0u);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    size_t chunk = (count + num_threads - 1) / num_threads;
+    for (unsigned int t = 1; t < num_threads; ++t) {
+        size_t lo = begin + t * chunk;
+        size_t hi = std::min(end, lo + chunk);
+        if (lo >= hi) break;
+        threads.emplace_back([&fn, lo, hi, t]() { fn(lo, hi, t); });
+    }
+    fn(begin, std::min(end, begin + chunk), 0u);
+    for (auto& th : threads) th.join();
+}
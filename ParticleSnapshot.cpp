@@ -0,0 +1,181 @@
+﻿#include "ParticleSnapshot.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    constexpr uint32_t kSnapshotVersion = 1;
+
+    template <typename T>
+    void write_vector(std::ofstream& out, const std::vector<T>& v) {
+        out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+    }
+
+    template <typename T>
+    bool read_channel(const char*& p, const char* end, std::vector<T>& out, size_t n) {
+        size_t bytes = n * sizeof(T);
+        if ((size_t)(end - p) < bytes) return false;
+        out.resize(n);
+        std::memcpy(out.data(), p, bytes);
+        p += bytes;
+        return true;
+    }
+}
+
+void ParticleSnapshot::capture(const std::vector<Simulation2D::Particle>& particles, uint64_t step_index, uint32_t channel_mask) {
+    step = step_index;
+    channels = channel_mask | SNAPSHOT_POSITION;
+    size_t n = particles.size();
+
+    positions.resize(n);
+    velocities.resize((channels & SNAPSHOT_VELOCITY) ? n : 0);
+    smoothing_h.resize((channels & SNAPSHOT_SMOOTHING_H) ? n : 0);
+    frames.resize((channels & SNAPSHOT_FRAME) ? n : 0);
+
+    for (size_t i = 0; i < n; ++i) {
+        const auto& p = particles[i];
+        positions[i] = p.position;
+        if (!velocities.empty()) velocities[i] = p.velocity;
+        if (!smoothing_h.empty()) smoothing_h[i] = p.smoothing_h;
+        if (!frames.empty()) frames[i] = p.rotation[0];
+    }
+}
+
+bool write_particle_snapshot(const std::string& path, const ParticleSnapshot& snapshot) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, "SPSN", 4);
+    header.version = kSnapshotVersion;
+    header.step = snapshot.step;
+    header.count = (uint32_t)snapshot.positions.size();
+    header.channels = snapshot.channels;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_vector(out, snapshot.positions);
+    if (header.channels & SNAPSHOT_VELOCITY) write_vector(out, snapshot.velocities);
+    if (header.channels & SNAPSHOT_SMOOTHING_H) write_vector(out, snapshot.smoothing_h);
+    if (header.channels & SNAPSHOT_FRAME) write_vector(out, snapshot.frames);
+    return out.good();
+}
+
+bool read_particle_snapshot(const std::string& path, ParticleSnapshot& out) {
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(SnapshotHeader)) return false;
+
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, "SPSN", 4) != 0 || header.version != kSnapshotVersion) return false;
+
+    const char* p = file.data() + sizeof(header);
+    const char* end = file.data() + file.size();
+    out = ParticleSnapshot{};
+    out.step = header.step;
+    out.channels = header.channels;
+
+    if (!read_channel(p, end, out.positions, header.count)) return false;
+    if ((header.channels & SNAPSHOT_VELOCITY) && !read_channel(p, end, out.velocities, header.count)) return false;
+    if ((header.channels & SNAPSHOT_SMOOTHING_H) && !read_channel(p, end, out.smoothing_h, header.count)) return false;
+    if ((header.channels & SNAPSHOT_FRAME) && !read_channel(p, end, out.frames, header.count)) return false;
+    return true;
+}
+
+bool convert_snapshot_to_csv(const std::string& snapshot_path, const std::string& csv_path) {
+    ParticleSnapshot snapshot;
+    if (!read_particle_snapshot(snapshot_path, snapshot)) {
+        std::cerr << "Error: could not read snapshot " << snapshot_path << std::endl;
+        return false;
+    }
+
+    std::ofstream out(csv_path);
+    if (!out.is_open()) return false;
+
+    out << "x,y";
+    if (!snapshot.velocities.empty()) out << ",vx,vy";
+    if (!snapshot.smoothing_h.empty()) out << ",h";
+    if (!snapshot.frames.empty()) out << ",fx,fy";
+    out << "\n";
+
+    for (size_t i = 0; i < snapshot.positions.size(); ++i) {
+        out << snapshot.positions[i].x << "," << snapshot.positions[i].y;
+        if (!snapshot.velocities.empty()) out << "," << snapshot.velocities[i].x << "," << snapshot.velocities[i].y;
+        if (!snapshot.smoothing_h.empty()) out << "," << snapshot.smoothing_h[i];
+        if (!snapshot.frames.empty()) out << "," << snapshot.frames[i].x << "," << snapshot.frames[i].y;
+        out << "\n";
+    }
+    return out.good();
+}
+
+// ================= SnapshotWriter =================
+
+SnapshotWriter::SnapshotWriter() {
+    io_thread_ = std::thread(&SnapshotWriter::io_loop, this);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (io_thread_.joinable()) io_thread_.join();
+}
+
+bool SnapshotWriter::submit(const std::vector<Simulation2D::Particle>& particles, uint64_t step,
+    uint32_t channels, const std::string& path) {
+    int slot = -1;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_ >= 0) {
+            // 还有一块没开始写：两块缓冲都被占用，丢弃这次
+            dropped_++;
+            return false;
+        }
+        slot = (writing_ == 0) ? 1 : 0;
+    }
+
+    // 拷贝在锁外进行：I/O 线程只会碰 writing_ 那一块
+    slots_[slot].snapshot.capture(particles, step, channels);
+    slots_[slot].path = path;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = slot;
+    }
+    cv_.notify_all();
+    return true;
+}
+
+void SnapshotWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return pending_ < 0 && writing_ < 0; });
+}
+
+void SnapshotWriter::io_loop() {
+    while (true) {
+        int slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stop_ || pending_ >= 0; });
+            if (pending_ < 0) return; // stop_ 且没有待写的快照
+            slot = pending_;
+            pending_ = -1;
+            writing_ = slot;
+        }
+
+        const Slot& s = slots_[slot];
+        if (write_particle_snapshot(s.path, s.snapshot)) {
+            written_++;
+        }
+        else {
+            std::cerr << "Failed to write particle snapshot: " << s.path << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            writing_ = -1;
+        }
+        cv_.notify_all();
+    }
+}
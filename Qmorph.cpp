@@ -4,6 +4,12 @@
 #include <algorithm>
 #include <set>
 #include <cmath>
+#include <chrono>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include "ParallelFor.h"
+#include "MeshReorder.h"
 
 // --- 辅助函数：创建排序后的边，方便作为map的键 ---
 Qmorph::Edge Qmorph::make_sorted_edge(Vert_idx v1, Vert_idx v2) {
@@ -30,26 +36,18 @@ Qmorph::Result Qmorph::run(const CGALMeshGenerator& delaunay_mesh) {
     fixed_vertices_.assign(vertices.size(), false);
 
     // --- 标记边界顶点 (这些点在平滑时不能动) ---
-    // 我们先建立一次全局邻接关系来统计边的引用次数
-    std::map<Edge, int> edge_counts;
-    for (const auto& t : initial_triangles) {
-        edge_counts[make_sorted_edge(t.v0, t.v1)]++;
-        edge_counts[make_sorted_edge(t.v1, t.v2)]++;
-        edge_counts[make_sorted_edge(t.v2, t.v0)]++;
-    }
-    for (const auto& pair : edge_counts) {
-        if (pair.second == 1) { // 只有1个三角形引用的边是边界边
-            fixed_vertices_[pair.first.first] = true;
-            fixed_vertices_[pair.first.second] = true;
+    // [修改] 邻接直接来自三角剖分，没有邻居的边就是边界边
+    build_adjacency(initial_triangles, delaunay_mesh.get_triangle_neighbors());
+    for (Tri_idx i = 0; i < initial_triangles.size(); ++i) {
+        for (int j = 0; j < 3; ++j) {
+            if (adj_list_[i].neighbors[j] == SIZE_MAX) {
+                fixed_vertices_[adj_list_[i].edges[j].first] = true;
+                fixed_vertices_[adj_list_[i].edges[j].second] = true;
+            }
         }
     }
 
     // --- 多阶段迭代策略 (Scheme 1 & 3) ---
-    struct PassConfig {
-        float threshold;
-        bool do_smooth;
-    };
-
     // 定义三个阶段：
     // 1. 高质量合并 (只合并几乎完美的矩形) -> 平滑
     // 2. 中质量合并 (合并一般的四边形) -> 平滑
@@ -60,21 +58,99 @@ Qmorph::Result Qmorph::run(const CGALMeshGenerator& delaunay_mesh) {
         { 0.01f, false }
     };
 
-    std::cout << "Qmorph: Starting Priority-Based Optimization..." << std::endl;
-
-    for (int i = 0; i < passes.size(); ++i) {
-        // 1. 每次合并前，基于当前状态重建邻接关系
-        build_adjacency(initial_triangles);
-
-        // 2. 执行基于优先级的合并
-        int merged = priority_merge_pass(vertices, initial_triangles, passes[i].threshold);
-        std::cout << "  Pass " << i + 1 << " (Thres=" << passes[i].threshold << "): Merged " << merged << " quads." << std::endl;
+    // [新增] 配对方式对比：每次都从相同的初始顶点开始
+    if (benchmark_matching_) {
+        using Clock = std::chrono::high_resolution_clock;
+        auto timed_run = [&](MatchingMode mode, unsigned int threads, std::vector<int>& counts) {
+            std::vector<glm::vec2> work_vertices = vertices;
+            auto b0 = Clock::now();
+            counts = run_passes(work_vertices, initial_triangles, passes, mode, threads, false);
+            return std::chrono::duration<double, std::milli>(Clock::now() - b0).count();
+        };
+        std::vector<int> greedy_counts;
+        double greedy_ms = timed_run(MatchingMode::Greedy, 1, greedy_counts);
+        auto print_counts = [&](const std::vector<int>& counts) {
+            for (size_t i = 0; i < counts.size(); ++i) std::cout << (i ? "/" : "") << counts[i];
+        };
+        std::cout << "Qmorph [benchmark] greedy: ";
+        print_counts(greedy_counts);
+        std::cout << " quads per pass, " << greedy_ms << " ms" << std::endl;
+        const unsigned int max_threads = default_thread_count();
+        for (unsigned int threads = 1;; threads = std::min(threads * 2, max_threads)) {
+            std::vector<int> counts;
+            double ld_ms = timed_run(MatchingMode::LocallyDominant, threads, counts);
+            bool no_worse = true;
+            for (size_t i = 0; i < counts.size(); ++i) no_worse = no_worse && counts[i] >= greedy_counts[i];
+            std::cout << "Qmorph [benchmark] locally dominant, " << threads << " thread(s): ";
+            print_counts(counts);
+            std::cout << " quads per pass, " << ld_ms << " ms" << (no_worse ? "" : " -> FEWER QUADS THAN GREEDY") << std::endl;
+            if (threads >= max_threads) break;
+        }
+    }
 
-        // 3. 对剩余的三角形进行平滑，改善形状以便下一轮合并
-        if (passes[i].do_smooth) {
-            smooth_vertices(vertices, initial_triangles);
+    // [新增] 度量对比：同一组候选上的质量差与评估耗时，以及各自跑完全部阶段后的合并结果
+    if (compare_metric_) {
+        using Clock = std::chrono::high_resolution_clock;
+        auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+        const QualityMetric saved_metric = quality_metric_;
+        active_mode_ = MatchingMode::LocallyDominant; // 不需要堆
+        quality_metric_ = QualityMetric::Exact;
+        build_candidates(vertices, initial_triangles);
+
+        auto c0 = Clock::now();
+        score_candidates(vertices, score_ids_);
+        auto c1 = Clock::now();
+        std::vector<float> exact_quality(candidates_.size());
+        for (size_t c = 0; c < candidates_.size(); ++c) exact_quality[c] = candidates_[c].quality;
+        quality_metric_ = QualityMetric::Fast;
+        score_candidates(vertices, score_ids_);
+        auto c2 = Clock::now();
+
+        float max_diff = 0.0f;
+        size_t band_changes = 0;
+        auto band = [&](float q) { int b = 0; for (const auto& pass : passes) b += q >= pass.threshold; return b; };
+        for (size_t c = 0; c < candidates_.size(); ++c) {
+            max_diff = std::max(max_diff, std::abs(candidates_[c].quality - exact_quality[c]));
+            if (band(candidates_[c].quality) != band(exact_quality[c])) band_changes++;
+        }
+        std::cout << "Qmorph [metric] " << candidates_.size() << " candidates: exact " << ms(c0, c1) << " ms, fast " << ms(c1, c2)
+            << " ms; max |dq| = " << max_diff << ", " << band_changes << " change threshold band" << std::endl;
+
+        auto quad_keys = [](const std::vector<CGALMeshGenerator::Quad>& quads) {
+            std::vector<std::array<unsigned int, 4>> keys;
+            keys.reserve(quads.size());
+            for (const auto& q : quads) {
+                std::array<unsigned int, 4> k = { q.v0, q.v1, q.v2, q.v3 };
+                std::sort(k.begin(), k.end());
+                keys.push_back(k);
+            }
+            std::sort(keys.begin(), keys.end());
+            return keys;
+        };
+        std::vector<std::vector<int>> counts(2);
+        std::vector<std::vector<std::array<unsigned int, 4>>> keys(2);
+        const QualityMetric metrics[2] = { QualityMetric::Exact, QualityMetric::Fast };
+        for (int m = 0; m < 2; ++m) {
+            quality_metric_ = metrics[m];
+            std::vector<glm::vec2> work_vertices = vertices;
+            counts[m] = run_passes(work_vertices, initial_triangles, passes, matching_mode_, matching_threads_, false);
+            keys[m] = quad_keys(result_.quads);
         }
+        std::vector<std::array<unsigned int, 4>> common;
+        std::set_intersection(keys[0].begin(), keys[0].end(), keys[1].begin(), keys[1].end(), std::back_inserter(common));
+        for (int m = 0; m < 2; ++m) {
+            std::cout << "Qmorph [metric] " << (m == 0 ? "exact" : "fast ") << ": ";
+            for (size_t i = 0; i < counts[m].size(); ++i) std::cout << (i ? "/" : "") << counts[m][i];
+            std::cout << " quads per pass" << std::endl;
+        }
+        std::cout << "Qmorph [metric] " << common.size() << " quads in common, " << keys[0].size() - common.size()
+            << " only exact, " << keys[1].size() - common.size() << " only fast" << std::endl;
+        quality_metric_ = saved_metric;
     }
+
+    std::cout << "Qmorph: Starting Priority-Based Optimization"
+        << (matching_mode_ == MatchingMode::LocallyDominant ? " (locally dominant matching)" : "") << "..." << std::endl;
+    run_passes(vertices, initial_triangles, passes, matching_mode_, matching_threads_, true);
     //// --- 终极清理：处理剩余三角形 (3-to-1 Split) ---
     //std::cout << "Final Cleanup: Splitting remaining " << result_.remaining_triangles.size() << " triangles..." << std::endl;
 
@@ -119,54 +195,133 @@ Qmorph::Result Qmorph::run(const CGALMeshGenerator& delaunay_mesh) {
         }
     }
 
+    // [修改] 阶段之间的平滑只对未合并的三角形取平均、不检查翻转，会把已合并四边形的角点拉坏，
+    // 它的结果只用于候选打分。导出的几何从生成器的原始位置开始
+    vertices = delaunay_mesh.get_vertices();
+
+    // [新增] 最终网格平滑，结果随 Result 返回 (导出与显示直接使用)
+    if (final_iterations_ > 0) {
+        auto s0 = std::chrono::high_resolution_clock::now();
+        smooth_final_mesh(vertices, final_iterations_, final_threads_);
+        auto s1 = std::chrono::high_resolution_clock::now();
+        std::cout << "  Final smoothing: " << final_iterations_ << " Jacobi iterations in "
+            << std::chrono::duration<double, std::milli>(s1 - s0).count() << " ms (" << smooth_limited_
+            << " moves shortened to avoid inverted elements)." << std::endl;
+    }
+    size_t inverted = 0, concave = 0;
+    count_bad_elements(vertices, inverted, concave);
+    if (inverted > 0 || concave > 0) {
+        std::cout << "  Warning: " << inverted << " inverted and " << concave << " concave elements in the final mesh." << std::endl;
+    }
+    result_.vertices = std::move(vertices);
+
+    // [新增] 合并顺序与空间位置无关，按单元的最小 / 最大顶点号重新排列
+    if (element_reorder_) {
+        std::vector<unsigned int> order;
+        MeshReorder::element_order(result_.quads, order);
+        std::vector<CGALMeshGenerator::Quad> quads(order.size());
+        for (size_t k = 0; k < order.size(); ++k) quads[k] = result_.quads[order[k]];
+        result_.quads.swap(quads);
+        MeshReorder::element_order(result_.remaining_triangles, order);
+        std::vector<CGALMeshGenerator::Triangle> tris(order.size());
+        for (size_t k = 0; k < order.size(); ++k) tris[k] = result_.remaining_triangles[order[k]];
+        result_.remaining_triangles.swap(tris);
+        MeshOrderStats stats = MeshReorder::measure(result_.vertices.size(), result_.remaining_triangles, result_.quads);
+        std::cout << "  Element reorder: bandwidth " << stats.bandwidth << ", profile " << stats.profile << std::endl;
+    }
+
     std::cout << "Qmorph Complete: " << result_.quads.size() << " quads, "
         << result_.remaining_triangles.size() << " triangles remaining." << std::endl;
 
-    return result_;
+    return std::move(result_);
 }
 
 
-// --- 步骤 1: 构建邻接关系，这是所有后续操作的基础 ---
-// --- 构建邻接关系 (只考虑未合并的三角形) ---
-void Qmorph::build_adjacency(const std::vector<CGALMeshGenerator::Triangle>& triangles) {
-    edge_to_tri_map_.clear();
-    // 重新初始化 adj_list_，确保大小匹配
-    if (adj_list_.size() != triangles.size()) {
-        adj_list_.assign(triangles.size(), Tri_adj{});
-    }
-    else {
-        // 清空旧数据
-        for (auto& adj : adj_list_) adj = Tri_adj{};
+// [新增] 重置合并状态并依次执行各阶段
+std::vector<int> Qmorph::run_passes(std::vector<glm::vec2>& vertices,
+    const std::vector<CGALMeshGenerator::Triangle>& triangles,
+    const std::vector<PassConfig>& passes, MatchingMode mode, unsigned int num_threads, bool verbose) {
+    result_.quads.clear();
+    merged_triangles_.assign(triangles.size(), false);
+    active_mode_ = mode;
+
+    // [修改] 候选只整体评估一次，之后各阶段共用
+    build_candidates(vertices, triangles);
+    if (verbose) std::cout << "  Candidates: " << candidates_.size() << " interior edges evaluated." << std::endl;
+
+    std::vector<int> counts;
+    for (int i = 0; i < passes.size(); ++i) {
+        // 1. 执行合并 (已合并的三角形和过期条目在弹出 / 选择时跳过)
+        int merged = mode == MatchingMode::LocallyDominant
+            ? dominant_merge_pass(passes[i].threshold, num_threads)
+            : priority_merge_pass(passes[i].threshold);
+        counts.push_back(merged);
+        if (verbose) std::cout << "  Pass " << i + 1 << " (Thres=" << passes[i].threshold << "): Merged " << merged << " quads." << std::endl;
+
+        // 2. 对剩余的三角形进行平滑，改善形状以便下一轮合并；只重新评估受影响的候选
+        if (passes[i].do_smooth) {
+            smooth_vertices(vertices, triangles, moved_vertices_);
+            size_t rescored = rescore_candidates(vertices, moved_vertices_);
+            if (verbose) std::cout << "    Smoothed " << moved_vertices_.size() << " vertices, re-scored " << rescored << " candidates." << std::endl;
+        }
     }
+    return counts;
+}
 
-    for (Tri_idx i = 0; i < triangles.size(); ++i) {
-        if (merged_triangles_[i]) continue; // 跳过已合并的
 
+// --- 步骤 1: 构建邻接关系，这是所有后续操作的基础 ---
+// [修改] edges[j] 为 (v_j, v_{j+1})，对应生成器中对着角点 j+2 的边
+void Qmorph::build_adjacency(const std::vector<CGALMeshGenerator::Triangle>& triangles,
+    const std::vector<int>& neighbors) {
+    adj_list_.assign(triangles.size(), Tri_adj{});
+
+    for (Tri_idx i = 0; i < triangles.size(); ++i) {
         const auto& t = triangles[i];
         Vert_idx v[3] = { t.v0, t.v1, t.v2 };
         for (int j = 0; j < 3; ++j) {
-            Edge edge = make_sorted_edge(v[j], v[(j + 1) % 3]);
-            adj_list_[i].edges[j] = edge;
-            edge_to_tri_map_[edge].push_back(i);
+            adj_list_[i].edges[j] = make_sorted_edge(v[j], v[(j + 1) % 3]);
         }
     }
+
+    if (neighbors.size() == triangles.size() * 3) {
+        for (Tri_idx i = 0; i < triangles.size(); ++i) {
+            for (int j = 0; j < 3; ++j) {
+                int n = neighbors[i * 3 + (j + 2) % 3];
+                if (n >= 0) adj_list_[i].neighbors[j] = (Tri_idx)n;
+            }
+        }
+        return;
+    }
+
+    // 没有现成邻接 (例如外部传入的三角形) 时按边配对，只有恰好两个三角形共享的边才是内部边
+    // [修改] 平铺边表 (64 位键 + 基数排序)，不再为每条边分配 std::map 节点和 vector
+    edge_keys_.resize(triangles.size() * 3);
+    for (Tri_idx i = 0; i < triangles.size(); ++i) {
+        for (int j = 0; j < 3; ++j) {
+            const Edge& e = adj_list_[i].edges[j];
+            edge_keys_[i * 3 + j] = EdgeTable::key(e.first, e.second);
+        }
+    }
+    edge_table_.build(edge_keys_);
+    const auto& twins = edge_table_.twins();
+    for (Tri_idx h = 0; h < twins.size(); ++h) {
+        if (twins[h] >= 0) adj_list_[h / 3].neighbors[h % 3] = (Tri_idx)twins[h] / 3;
+    }
 }
 
 
 // --- 步骤 2: 快速配对合并，处理最理想的情况 ---
 void Qmorph::initial_pair_merging(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Triangle>& triangles) {
-    for (const auto& pair : edge_to_tri_map_) {
-        const auto& edge = pair.first;
-        const auto& tri_indices = pair.second;
-
-        if (tri_indices.size() == 2) { // 是内部边
-            Tri_idx idx1 = tri_indices[0];
-            Tri_idx idx2 = tri_indices[1];
+    for (Tri_idx idx1 = 0; idx1 < triangles.size(); ++idx1) {
+        for (int j = 0; j < 3; ++j) {
+            Tri_idx idx2 = adj_list_[idx1].neighbors[j];
+            if (idx2 == SIZE_MAX || idx2 < idx1) continue; // 边界边，或已从另一侧处理过
 
             if (merged_triangles_[idx1] || merged_triangles_[idx2]) {
                 continue; // 其中一个已经被合并
             }
 
+            const Edge& edge = adj_list_[idx1].edges[j];
             const auto& t1 = triangles[idx1];
             const auto& t2 = triangles[idx2];
 
@@ -230,30 +385,225 @@ float Qmorph::calculate_quad_quality(const glm::vec2& p0, const glm::vec2& p1, c
     return std::max(0.0f, 1.0f - (dev / (2.0f * 3.14159f)));
 }
 
-int Qmorph::priority_merge_pass(const std::vector<glm::vec2>& vertices,
-    const std::vector<CGALMeshGenerator::Triangle>& triangles,
-    float quality_threshold) {
-    std::priority_queue<PotentialQuad> pq;
-
-    // 1. Evaluate all internal edges
-    for (const auto& pair : edge_to_tri_map_) {
-        if (pair.second.size() == 2) {
-            Tri_idx t1 = pair.second[0];
-            Tri_idx t2 = pair.second[1];
-            pq.push(evaluate_merge(t1, t2, triangles, vertices, pair.first));
+// [新增] calculate_quad_quality 的批量版本，结果相同 (误差约 1e-6)：
+//   角点处两条边 u, v 的夹角 θ 满足 |θ - 90°| = atan(|u·v| / |u×v|)，
+//   而 u×v 正是凸性检测已经算出的叉积，所以不需要 normalize (开方) 和 acos；
+//   atan 在 [0, 1] 上用奇次多项式逼近 (最大误差约 2e-6 弧度)，比值大于 1 时取余角。
+namespace {
+    const float kHalfPi = 1.5707963f;
+    const float kDevScale = 1.0f / (2.0f * 3.14159f); // 与 calculate_quad_quality 的归一化一致
+
+    inline float atan_unit(float r) { // r ∈ [0, 1]
+        float r2 = r * r;
+        float p = -0.01172120f;
+        p = p * r2 + 0.05265332f;
+        p = p * r2 - 0.11643287f;
+        p = p * r2 + 0.19354346f;
+        p = p * r2 - 0.33262347f;
+        p = p * r2 + 0.99997726f;
+        return p * r;
+    }
+
+    inline float corner_deviation(float dot, float cross) {
+        float a = std::abs(dot), b = std::abs(cross);
+        float lo = std::min(a, b), hi = std::max(std::max(a, b), 1e-30f);
+        float t = atan_unit(lo / hi);
+        return a > b ? kHalfPi - t : t;
+    }
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QMORPH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void Qmorph::calculate_quad_quality_batch(const float* const soa[8], float* out, size_t count) {
+    size_t i = 0;
+#ifdef QMORPH_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 tiny = _mm_set1_ps(1e-30f);
+    const __m128 half_pi = _mm_set1_ps(kHalfPi);
+    auto atan_unit4 = [](__m128 r) {
+        __m128 r2 = _mm_mul_ps(r, r);
+        __m128 p = _mm_set1_ps(-0.01172120f);
+        p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(0.05265332f));
+        p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(-0.11643287f));
+        p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(0.19354346f));
+        p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(-0.33262347f));
+        p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(0.99997726f));
+        return _mm_mul_ps(p, r);
+    };
+    for (; i + 4 <= count; i += 4) {
+        __m128 px[4], py[4];
+        for (int k = 0; k < 4; ++k) {
+            px[k] = _mm_loadu_ps(soa[2 * k] + i);
+            py[k] = _mm_loadu_ps(soa[2 * k + 1] + i);
+        }
+        // 边 e_k = p_{k+1} - p_k
+        __m128 ex[4], ey[4];
+        for (int k = 0; k < 4; ++k) {
+            ex[k] = _mm_sub_ps(px[(k + 1) % 4], px[k]);
+            ey[k] = _mm_sub_ps(py[(k + 1) % 4], py[k]);
+        }
+        __m128 all_pos = _mm_castsi128_ps(_mm_set1_epi32(-1)), all_neg = all_pos;
+        __m128 dev = zero;
+        for (int k = 0; k < 4; ++k) {
+            // 角点 p_{k+1}：叉积 e_k × e_{k+1} (凸性)，点积 -e_k · e_{k+1} (取绝对值，符号无关)
+            int n = (k + 1) % 4;
+            __m128 cr = _mm_sub_ps(_mm_mul_ps(ex[k], ey[n]), _mm_mul_ps(ey[k], ex[n]));
+            __m128 dt = _mm_add_ps(_mm_mul_ps(ex[k], ex[n]), _mm_mul_ps(ey[k], ey[n]));
+            all_pos = _mm_and_ps(all_pos, _mm_cmpgt_ps(cr, zero));
+            all_neg = _mm_and_ps(all_neg, _mm_cmplt_ps(cr, zero));
+            __m128 a = _mm_andnot_ps(sign, dt), b = _mm_andnot_ps(sign, cr);
+            __m128 lo = _mm_min_ps(a, b), hi = _mm_max_ps(_mm_max_ps(a, b), tiny);
+            __m128 t = atan_unit4(_mm_div_ps(lo, hi));
+            __m128 swap = _mm_cmpgt_ps(a, b);
+            t = _mm_or_ps(_mm_and_ps(swap, _mm_sub_ps(half_pi, t)), _mm_andnot_ps(swap, t));
+            dev = _mm_add_ps(dev, t);
+        }
+        __m128 q = _mm_max_ps(zero, _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(dev, _mm_set1_ps(kDevScale))));
+        __m128 convex = _mm_or_ps(all_pos, all_neg);
+        _mm_storeu_ps(out + i, _mm_and_ps(convex, q));
+    }
+#endif
+    for (; i < count; ++i) {
+        float ex[4], ey[4];
+        for (int k = 0; k < 4; ++k) {
+            ex[k] = soa[2 * ((k + 1) % 4)][i] - soa[2 * k][i];
+            ey[k] = soa[2 * ((k + 1) % 4) + 1][i] - soa[2 * k + 1][i];
+        }
+        bool all_pos = true, all_neg = true;
+        float dev = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+            int n = (k + 1) % 4;
+            float cr = ex[k] * ey[n] - ey[k] * ex[n];
+            float dt = ex[k] * ex[n] + ey[k] * ey[n];
+            all_pos = all_pos && cr > 0;
+            all_neg = all_neg && cr < 0;
+            dev += corner_deviation(dt, cr);
         }
+        out[i] = (all_pos || all_neg) ? std::max(0.0f, 1.0f - dev * kDevScale) : 0.0f;
     }
+}
 
-    int merge_count = 0;
-    while (!pq.empty()) {
-        PotentialQuad candidate = pq.top();
-        pq.pop();
+// [新增] 每条内部边 (两侧三角形下标小的一侧负责) 建一个候选，同时建立 顶点 -> 三角形 的 CSR
+void Qmorph::build_candidates(const std::vector<glm::vec2>& vertices,
+    const std::vector<CGALMeshGenerator::Triangle>& triangles) {
+    candidates_.clear();
+    tri_candidates_.assign(triangles.size() * 3, -1);
+    for (Tri_idx t1 = 0; t1 < triangles.size(); ++t1) {
+        for (int j = 0; j < 3; ++j) {
+            Tri_idx t2 = adj_list_[t1].neighbors[j];
+            if (t2 == SIZE_MAX || t2 < t1) continue;
+            int c = (int)candidates_.size();
+            candidates_.push_back(evaluate_merge(t1, t2, triangles, adj_list_[t1].edges[j]));
+            tri_candidates_[t1 * 3 + j] = c;
+            for (int k = 0; k < 3; ++k) {
+                if (adj_list_[t2].neighbors[k] == t1 && adj_list_[t2].edges[k] == adj_list_[t1].edges[j]) tri_candidates_[t2 * 3 + k] = c;
+            }
+        }
+    }
+    score_ids_.resize(candidates_.size());
+    std::iota(score_ids_.begin(), score_ids_.end(), 0u);
+    score_candidates(vertices, score_ids_);
+    candidate_version_.assign(candidates_.size(), 0);
+    candidate_stamp_.assign(candidates_.size(), 0);
+    rescore_round_ = 0;
+
+    std::vector<HeapEntry> entries;
+    if (active_mode_ == MatchingMode::Greedy) {
+        entries.resize(candidates_.size());
+        for (size_t c = 0; c < candidates_.size(); ++c) entries[c] = { candidates_[c].quality, (uint32_t)c, 0u };
+    }
+    heap_ = std::priority_queue<HeapEntry>(std::less<HeapEntry>(), std::move(entries)); // 线性建堆
 
-        // Valid checks
-        if (candidate.quality < quality_threshold) continue; // Stop if quality drops too low? Or just skip?
-        // Since it's a priority queue, we could technically break, 
-        // but let's just continue to find other disconnected islands.
+    vert_tri_offsets_.assign(vertices.size() + 1, 0);
+    for (const auto& t : triangles) {
+        vert_tri_offsets_[t.v0 + 1]++;
+        vert_tri_offsets_[t.v1 + 1]++;
+        vert_tri_offsets_[t.v2 + 1]++;
+    }
+    for (size_t v = 0; v < vertices.size(); ++v) vert_tri_offsets_[v + 1] += vert_tri_offsets_[v];
+    vert_tris_.resize(triangles.size() * 3);
+    std::vector<unsigned int> cursor(vert_tri_offsets_.begin(), vert_tri_offsets_.end() - 1);
+    for (Tri_idx i = 0; i < triangles.size(); ++i) {
+        vert_tris_[cursor[triangles[i].v0]++] = (unsigned int)i;
+        vert_tris_[cursor[triangles[i].v1]++] = (unsigned int)i;
+        vert_tris_[cursor[triangles[i].v2]++] = (unsigned int)i;
+    }
+}
+
+// [新增] 四边形质量只取决于两三角形的 4 个顶点，所以只有关联三角形含移动顶点的候选需要重新评估
+size_t Qmorph::rescore_candidates(const std::vector<glm::vec2>& vertices, const std::vector<Vert_idx>& moved) {
+    rescore_round_++;
+    score_ids_.clear();
+    for (Vert_idx v : moved) {
+        for (unsigned int k = vert_tri_offsets_[v]; k < vert_tri_offsets_[v + 1]; ++k) {
+            Tri_idx t = vert_tris_[k];
+            if (merged_triangles_[t]) continue;
+            for (int j = 0; j < 3; ++j) {
+                int c = tri_candidates_[t * 3 + j];
+                if (c < 0 || candidate_stamp_[c] == rescore_round_) continue;
+                candidate_stamp_[c] = rescore_round_;
+                const PotentialQuad& cand = candidates_[c];
+                if (merged_triangles_[cand.t1] || merged_triangles_[cand.t2]) continue;
+                score_ids_.push_back((uint32_t)c);
+            }
+        }
+    }
+
+    // 四边形顶点不变，只需重新计算质量
+    score_candidates(vertices, score_ids_);
+    for (uint32_t c : score_ids_) {
+        ++candidate_version_[c];
+        if (active_mode_ == MatchingMode::Greedy) heap_.push({ candidates_[c].quality, c, candidate_version_[c] });
+    }
+    return score_ids_.size();
+}
+
+// [新增] Exact 逐个调用原函数；Fast 按块收集顶点坐标到 SoA 缓冲后批量计算
+void Qmorph::score_candidates(const std::vector<glm::vec2>& vertices, const std::vector<uint32_t>& ids) {
+    if (quality_metric_ == QualityMetric::Exact) {
+        for (uint32_t c : ids) {
+            PotentialQuad& cand = candidates_[c];
+            cand.quality = calculate_quad_quality(vertices[cand.v1_opp], vertices[cand.v1_shared],
+                vertices[cand.v2_opp], vertices[cand.v2_shared]);
+        }
+        return;
+    }
+
+    const size_t kScoreBatch = 256;
+    soa_.resize(8 * kScoreBatch + kScoreBatch);
+    float* out = soa_.data() + 8 * kScoreBatch;
+    const float* soa[8];
+    for (int k = 0; k < 8; ++k) soa[k] = soa_.data() + k * kScoreBatch;
+
+    for (size_t base = 0; base < ids.size(); base += kScoreBatch) {
+        size_t n = std::min(kScoreBatch, ids.size() - base);
+        for (size_t i = 0; i < n; ++i) {
+            const PotentialQuad& cand = candidates_[ids[base + i]];
+            const Vert_idx quad[4] = { cand.v1_opp, cand.v1_shared, cand.v2_opp, cand.v2_shared };
+            for (int k = 0; k < 4; ++k) {
+                soa_[(2 * k) * kScoreBatch + i] = vertices[quad[k]].x;
+                soa_[(2 * k + 1) * kScoreBatch + i] = vertices[quad[k]].y;
+            }
+        }
+        calculate_quad_quality_batch(soa, out, n);
+        for (size_t i = 0; i < n; ++i) candidates_[ids[base + i]].quality = out[i];
+    }
+}
 
+int Qmorph::priority_merge_pass(float quality_threshold) {
+    int merge_count = 0;
+    while (!heap_.empty()) {
+        HeapEntry top = heap_.top();
+        // 堆有序，低于阈值的全部留给后续 (阈值更低的) 阶段
+        if (top.quality < quality_threshold) break;
+        heap_.pop();
+
+        if (top.version != candidate_version_[top.candidate]) continue; // 已重新评估，过期条目
+        const PotentialQuad& candidate = candidates_[top.candidate];
         if (merged_triangles_[candidate.t1] || merged_triangles_[candidate.t2]) continue;
 
         // Perform Merge
@@ -266,9 +616,97 @@ int Qmorph::priority_merge_pass(const std::vector<glm::vec2>& vertices,
     return merge_count;
 }
 
+// [新增] 三角形 t 在阈值下的最佳候选：质量高者优先，相同则候选下标小者优先 (与堆的出队顺序一致)
+int Qmorph::best_candidate(Tri_idx t, float quality_threshold) const {
+    int best = -1;
+    for (int j = 0; j < 3; ++j) {
+        int c = tri_candidates_[t * 3 + j];
+        if (c < 0) continue;
+        const PotentialQuad& cand = candidates_[c];
+        if (cand.quality < quality_threshold) continue;
+        if (merged_triangles_[cand.t1 == t ? cand.t2 : cand.t1]) continue;
+        if (best < 0 || cand.quality > candidates_[best].quality || (cand.quality == candidates_[best].quality && c < best)) best = c;
+    }
+    return best;
+}
+
+// [新增] 局部占优配对：两个三角形互为对方的最佳候选时，这条边在所有未合并的候选中是局部最大的，
+// 贪心算法同样一定会选它。每轮并行选最佳、并行找互为最佳的对，合并后只有 "最佳候选的另一侧被合并" 的
+// 三角形需要重新选择，直到没有可合并的对。各候选在严格全序下比较，所以结果与贪心完全一致
+int Qmorph::dominant_merge_pass(float quality_threshold, unsigned int num_threads) {
+    const size_t tri_count = merged_triangles_.size();
+    if (num_threads == 0) num_threads = default_thread_count();
+    best_.assign(tri_count, -1);
+    queued_.assign(tri_count, 0);
+    found_.resize(num_threads);
+
+    work_.clear();
+    for (Tri_idx t = 0; t < tri_count; ++t) {
+        if (!merged_triangles_[t]) work_.push_back((unsigned int)t);
+    }
+
+    int merge_count = 0;
+    std::vector<uint32_t> dominant;
+    while (!work_.empty()) {
+        parallel_for_range(0, work_.size(), [&](size_t lo, size_t hi, unsigned int) {
+            for (size_t k = lo; k < hi; ++k) best_[work_[k]] = best_candidate(work_[k], quality_threshold);
+        }, num_threads);
+
+        // 只从 t1 一侧记录，避免两侧都在本轮时重复 (不在本轮的一侧，其 best_ 仍然有效)
+        for (unsigned int k = 0; k < work_.size(); ++k) queued_[work_[k]] = 1;
+        parallel_for_range(0, work_.size(), [&](size_t lo, size_t hi, unsigned int thread) {
+            auto& found = found_[thread];
+            found.clear();
+            for (size_t k = lo; k < hi; ++k) {
+                Tri_idx t = work_[k];
+                int c = best_[t];
+                if (c < 0) continue;
+                const PotentialQuad& cand = candidates_[c];
+                Tri_idx other = cand.t1 == t ? cand.t2 : cand.t1;
+                if (best_[other] != c) continue;
+                if (queued_[other] && t != cand.t1) continue;
+                found.push_back((uint32_t)c);
+            }
+        }, num_threads);
+        for (unsigned int k = 0; k < work_.size(); ++k) queued_[work_[k]] = 0;
+
+        dominant.clear();
+        for (size_t i = 0; i < num_threads; ++i) {
+            dominant.insert(dominant.end(), found_[i].begin(), found_[i].end());
+            found_[i].clear();
+        }
+        if (dominant.empty()) break;
+        std::sort(dominant.begin(), dominant.end());
+
+        for (uint32_t c : dominant) {
+            const PotentialQuad& cand = candidates_[c];
+            result_.quads.push_back({ cand.v1_opp, cand.v1_shared, cand.v2_opp, cand.v2_shared });
+            merged_triangles_[cand.t1] = true;
+            merged_triangles_[cand.t2] = true;
+        }
+        merge_count += (int)dominant.size();
+
+        // 最佳候选指向刚合并三角形的邻居需要重新选择
+        next_work_.clear();
+        for (uint32_t c : dominant) {
+            for (Tri_idx t : { candidates_[c].t1, candidates_[c].t2 }) {
+                for (int j = 0; j < 3; ++j) {
+                    Tri_idx n = adj_list_[t].neighbors[j];
+                    if (n == SIZE_MAX || merged_triangles_[n] || queued_[n]) continue;
+                    if (best_[n] != tri_candidates_[t * 3 + j]) continue;
+                    queued_[n] = 1;
+                    next_work_.push_back((unsigned int)n);
+                }
+            }
+        }
+        for (unsigned int n : next_work_) queued_[n] = 0;
+        work_.swap(next_work_);
+    }
+    return merge_count;
+}
+
 Qmorph::PotentialQuad Qmorph::evaluate_merge(Tri_idx t1_idx, Tri_idx t2_idx,
     const std::vector<CGALMeshGenerator::Triangle>& triangles,
-    const std::vector<glm::vec2>& vertices,
     const Edge& shared_edge) {
     const auto& t1 = triangles[t1_idx];
     const auto& t2 = triangles[t2_idx];
@@ -279,14 +717,202 @@ Qmorph::PotentialQuad Qmorph::evaluate_merge(Tri_idx t1_idx, Tri_idx t2_idx,
     Vert_idx v2_opp = (t2.v0 != shared_edge.first && t2.v0 != shared_edge.second) ? t2.v0 :
         ((t2.v1 != shared_edge.first && t2.v1 != shared_edge.second) ? t2.v1 : t2.v2);
 
-    float q = calculate_quad_quality(vertices[v1_opp], vertices[shared_edge.first],
-        vertices[v2_opp], vertices[shared_edge.second]);
+    // [修改] 共享边按下标排过序，直接用会让四边形的绕向取决于顶点编号。改为沿 t1 的绕向 (逆时针)：
+    // v1_opp 之后的下一个顶点作为 v1_shared，四边形 {v1_opp, v1_shared, v2_opp, v2_shared} 与 t1 同向
+    Vert_idx next_of_opp = v1_opp == t1.v0 ? t1.v1 : (v1_opp == t1.v1 ? t1.v2 : t1.v0);
+    Vert_idx v1_shared = shared_edge.first, v2_shared = shared_edge.second;
+    if (next_of_opp != v1_shared) std::swap(v1_shared, v2_shared);
 
-    return { q, t1_idx, t2_idx, shared_edge.first, shared_edge.second, v1_opp, v2_opp };
+    return { 0.0f, t1_idx, t2_idx, v1_shared, v2_shared, v1_opp, v2_opp };
+}
+
+// [新增] 每个单元的每条边给两端各加一个邻居，按行排序去重 (四边形之间、四边形与三角形之间的
+// 共享边只计一次)，之后每轮 Jacobi 迭代按顶点分块并行，读旧缓冲写新缓冲
+void Qmorph::smooth_final_mesh(std::vector<glm::vec2>& vertices, int iterations, unsigned int num_threads) {
+    const size_t n = vertices.size();
+    csr_offsets_.assign(n + 1, 0);
+    auto for_each_edge = [&](auto&& fn) {
+        for (const auto& q : result_.quads) {
+            fn(q.v0, q.v1); fn(q.v1, q.v2); fn(q.v2, q.v3); fn(q.v3, q.v0);
+        }
+        for (const auto& t : result_.remaining_triangles) {
+            fn(t.v0, t.v1); fn(t.v1, t.v2); fn(t.v2, t.v0);
+        }
+    };
+    for_each_edge([&](unsigned int a, unsigned int b) { csr_offsets_[a + 1]++; csr_offsets_[b + 1]++; });
+    for (size_t v = 0; v < n; ++v) csr_offsets_[v + 1] += csr_offsets_[v];
+    csr_neighbors_.resize(csr_offsets_[n]);
+    std::vector<unsigned int> cursor(csr_offsets_.begin(), csr_offsets_.end() - 1);
+    for_each_edge([&](unsigned int a, unsigned int b) {
+        csr_neighbors_[cursor[a]++] = b;
+        csr_neighbors_[cursor[b]++] = a;
+    });
+
+    // 行内去重并压缩
+    unsigned int write = 0;
+    for (size_t v = 0; v < n; ++v) {
+        unsigned int lo = csr_offsets_[v], hi = csr_offsets_[v + 1];
+        std::sort(csr_neighbors_.begin() + lo, csr_neighbors_.begin() + hi);
+        csr_offsets_[v] = write;
+        for (unsigned int k = lo; k < hi; ++k) {
+            if (k == lo || csr_neighbors_[k] != csr_neighbors_[k - 1]) csr_neighbors_[write++] = csr_neighbors_[k];
+        }
+    }
+    csr_offsets_[n] = write;
+    csr_neighbors_.resize(write);
+
+    // [新增] 顶点 -> 关联单元，翻转检查后用来找出需要缩短步长的顶点
+    const size_t nq = result_.quads.size();
+    const size_t element_count = nq + result_.remaining_triangles.size();
+    auto for_each_corner = [&](auto&& fn) {
+        for (size_t q = 0; q < nq; ++q) {
+            const auto& e = result_.quads[q];
+            fn(e.v0, q); fn(e.v1, q); fn(e.v2, q); fn(e.v3, q);
+        }
+        for (size_t t = 0; t < result_.remaining_triangles.size(); ++t) {
+            const auto& e = result_.remaining_triangles[t];
+            fn(e.v0, nq + t); fn(e.v1, nq + t); fn(e.v2, nq + t);
+        }
+    };
+    vert_elem_offsets_.assign(n + 1, 0);
+    for_each_corner([&](unsigned int v, size_t) { vert_elem_offsets_[v + 1]++; });
+    for (size_t v = 0; v < n; ++v) vert_elem_offsets_[v + 1] += vert_elem_offsets_[v];
+    vert_elems_.resize(vert_elem_offsets_[n]);
+    cursor.assign(vert_elem_offsets_.begin(), vert_elem_offsets_.end() - 1);
+    for_each_corner([&](unsigned int v, size_t e) { vert_elems_[cursor[v]++] = (unsigned int)e; });
+
+    // [修改] 每个单元的参考朝向取平滑开始时它自身有向面积的符号
+    element_orientation_.resize(element_count);
+    parallel_for_range(0, element_count, [&](size_t lo, size_t hi, unsigned int) {
+        for (size_t e = lo; e < hi; ++e) element_orientation_[e] = signed_area2(e, vertices) < 0.0f ? -1.0f : 1.0f;
+    }, num_threads);
+
+    // 每轮 Jacobi：所有顶点同时移向邻居平均位置后检查全部单元；翻转或面积过小的单元，
+    // 其顶点的步长减半 (kMaxHalvings 次后退回原位) 并重新检查，直到没有坏单元。
+    // 全部顶点都在原位的单元一定能通过检查，而每一轮至少有一个顶点的步长变小，所以循环必然结束
+    const int kMaxHalvings = 3;
+    smooth_buffer_.resize(n);
+    smooth_target_.resize(n);
+    smooth_step_.resize(n);
+    bad_elements_.resize(element_count);
+    std::vector<int> halved_round(n);
+    smooth_limited_ = 0;
+    for (int it = 0; it < iterations; ++it) {
+        parallel_for_range(0, n, [&](size_t lo, size_t hi, unsigned int) {
+            for (size_t v = lo; v < hi; ++v) {
+                unsigned int b = csr_offsets_[v], e = csr_offsets_[v + 1];
+                smooth_step_[v] = 1.0f;
+                if (fixed_vertices_[v] || b == e) {
+                    smooth_target_[v] = vertices[v];
+                }
+                else {
+                    glm::vec2 sum(0.0f);
+                    for (unsigned int k = b; k < e; ++k) sum += vertices[csr_neighbors_[k]];
+                    smooth_target_[v] = sum / (float)(e - b);
+                }
+                smooth_buffer_[v] = smooth_target_[v];
+            }
+        }, num_threads);
+
+        std::fill(halved_round.begin(), halved_round.end(), -1);
+        for (int round = 0;; ++round) {
+            std::atomic<bool> any_bad{ false };
+            parallel_for_range(0, element_count, [&](size_t lo, size_t hi, unsigned int) {
+                bool found = false;
+                for (size_t e = lo; e < hi; ++e) {
+                    bad_elements_[e] = element_stays_valid(e, vertices, smooth_buffer_) ? 0 : 1;
+                    found = found || bad_elements_[e];
+                }
+                if (found) any_bad.store(true, std::memory_order_relaxed);
+            }, num_threads);
+            if (!any_bad.load()) break;
+
+            // 坏单元很少，串行处理；同一顶点每轮只减半一次，最后一轮直接退回原位
+            for (size_t v = 0; v < n; ++v) {
+                if (smooth_step_[v] == 0.0f) continue;
+                bool touches_bad = false;
+                for (unsigned int k = vert_elem_offsets_[v]; k < vert_elem_offsets_[v + 1] && !touches_bad; ++k) {
+                    touches_bad = bad_elements_[vert_elems_[k]] != 0;
+                }
+                if (!touches_bad || halved_round[v] == round) continue;
+                if (halved_round[v] < 0) smooth_limited_++;
+                halved_round[v] = round;
+                smooth_step_[v] = (round >= kMaxHalvings) ? 0.0f : smooth_step_[v] * 0.5f;
+                smooth_buffer_[v] = vertices[v] + (smooth_target_[v] - vertices[v]) * smooth_step_[v];
+            }
+        }
+        vertices.swap(smooth_buffer_);
+    }
+}
+
+// 按单元自身的参考朝向检查每个角点的有向面积：原本为正的角点不能降到原值的 kMinAreaRatio 以下 (包括变号)；
+// 原本凹进的角点不受限制，平滑正是要把它们拉平。退回原位的单元总能通过检查
+bool Qmorph::element_stays_valid(size_t e, const std::vector<glm::vec2>& before, const std::vector<glm::vec2>& after) const {
+    const float kMinAreaRatio = 0.1f;
+    unsigned int v[4];
+    int count;
+    const size_t nq = result_.quads.size();
+    if (e < nq) {
+        const auto& q = result_.quads[e];
+        v[0] = q.v0; v[1] = q.v1; v[2] = q.v2; v[3] = q.v3;
+        count = 4;
+    }
+    else {
+        const auto& t = result_.remaining_triangles[e - nq];
+        v[0] = t.v0; v[1] = t.v1; v[2] = t.v2;
+        count = 3;
+    }
+
+    auto cross = [](const glm::vec2& a, const glm::vec2& b) { return a.x * b.y - a.y * b.x; };
+    const float orient = element_orientation_[e];
+    for (int i = 0; i < count; ++i) {
+        unsigned int p = v[(i + count - 1) % count], c = v[i], nx = v[(i + 1) % count];
+        float old_corner = orient * cross(before[c] - before[p], before[nx] - before[c]);
+        if (old_corner <= 0.0f) continue;
+        float new_corner = orient * cross(after[c] - after[p], after[nx] - after[c]);
+        if (new_corner < kMinAreaRatio * old_corner) return false;
+    }
+    return true;
+}
+
+// [新增] 单元 e (先四边形后三角形) 有向面积的两倍 (逆时针为正)
+float Qmorph::signed_area2(size_t e, const std::vector<glm::vec2>& vertices) const {
+    auto cross = [](const glm::vec2& a, const glm::vec2& b) { return a.x * b.y - a.y * b.x; };
+    const size_t nq = result_.quads.size();
+    if (e < nq) {
+        const auto& q = result_.quads[e];
+        return cross(vertices[q.v2] - vertices[q.v0], vertices[q.v3] - vertices[q.v1]);
+    }
+    const auto& t = result_.remaining_triangles[e - nq];
+    return cross(vertices[t.v1] - vertices[t.v0], vertices[t.v2] - vertices[t.v0]);
+}
+
+// [新增] 四边形与三角形都按逆时针绕向统计非正的角点：面积 <= 0 或两个以上非正角点 (自交) 为翻转，
+// 恰好一个为凹四边形。两者在 MeshQuality 中都是 scaled jacobian <= 0
+void Qmorph::count_bad_elements(const std::vector<glm::vec2>& vertices, size_t& inverted, size_t& concave) const {
+    auto cross = [](const glm::vec2& a, const glm::vec2& b) { return a.x * b.y - a.y * b.x; };
+    inverted = concave = 0;
+    for (size_t q = 0; q < result_.quads.size(); ++q) {
+        const auto& e = result_.quads[q];
+        const unsigned int v[4] = { e.v0, e.v1, e.v2, e.v3 };
+        int non_positive = 0;
+        for (int i = 0; i < 4; ++i) {
+            const glm::vec2& p = vertices[v[(i + 3) % 4]];
+            const glm::vec2& c = vertices[v[i]];
+            const glm::vec2& nx = vertices[v[(i + 1) % 4]];
+            non_positive += cross(c - p, nx - c) <= 0.0f;
+        }
+        if (non_positive >= 2 || signed_area2(q, vertices) <= 0.0f) inverted++;
+        else if (non_positive == 1) concave++;
+    }
+    for (const auto& t : result_.remaining_triangles) {
+        inverted += cross(vertices[t.v1] - vertices[t.v0], vertices[t.v2] - vertices[t.v0]) <= 0.0f;
+    }
 }
 
 void Qmorph::smooth_vertices(std::vector<glm::vec2>& vertices,
-    const std::vector<CGALMeshGenerator::Triangle>& triangles) {
+    const std::vector<CGALMeshGenerator::Triangle>& triangles,
+    std::vector<Vert_idx>& moved) {
     // Simple Laplacian smoothing for active vertices
     std::vector<glm::vec2> new_positions = vertices;
     std::vector<int> valence(vertices.size(), 0);
@@ -314,6 +940,7 @@ void Qmorph::smooth_vertices(std::vector<glm::vec2>& vertices,
     }
 
     // Update positions
+    moved.clear();
     for (size_t i = 0; i < vertices.size(); ++i) {
         if (fixed_vertices_[i]) continue; // Boundary vertex
         if (valence[i] == 0) continue;    // Isolated or merged vertex
@@ -322,6 +949,7 @@ void Qmorph::smooth_vertices(std::vector<glm::vec2>& vertices,
         // Correct Laplacian: Iterate unique neighbors. 
         // Approximation: Sum all incident edges / count. 
         new_positions[i] = sum_neighbors[i] / (float)valence[i];
+        if (new_positions[i] != vertices[i]) moved.push_back((Vert_idx)i);
     }
 
     vertices = new_positions;
@@ -1,9 +1,10 @@
 ﻿#pragma once
 #include <vector>
-#include <map>
 #include <queue>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include "CGALMeshGenerator.h"
+#include "EdgeTable.h"
 
 // 为了避免循环引用，我们只进行前向声明
 class CGALMeshGenerator;
@@ -14,13 +15,43 @@ public:
     struct Result {
         std::vector<CGALMeshGenerator::Quad> quads;
         std::vector<CGALMeshGenerator::Triangle> remaining_triangles;
+        // [新增] 平滑后的顶点位置 (下标与 CGALMeshGenerator::get_vertices() 一致)。
+        // 只包含最终平滑的结果，阶段之间的平滑只用于打分；四边形与三角形均为逆时针
+        std::vector<glm::vec2> vertices;
     };
 
+    // [新增] 配对方式
+    //   Greedy:           单个优先队列依次弹出 (原实现)
+    //   LocallyDominant:  每个三角形并行选出最佳邻居，互为最佳的一对 (局部占优边) 同时合并，
+    //                     按轮迭代到没有变化。质量相同时按候选下标决胜，结果与 Greedy 完全相同
+    enum class MatchingMode { Greedy, LocallyDominant };
+
+    // [新增] 四边形质量度量
+    //   Exact: calculate_quad_quality (normalize + acos，逐个计算)
+    //   Fast:  同一个量 (四个角与 90 度偏差之和) 的无 acos / 无开方形式，按 SoA 批量 SIMD 计算
+    enum class QualityMetric { Exact, Fast };
+
     Qmorph() = default;
 
+    void set_matching_mode(MatchingMode mode, unsigned int num_threads = 0) { matching_mode_ = mode; matching_threads_ = num_threads; }
+    // [新增] 打开时先用 Greedy 和不同线程数的 LocallyDominant 各跑一遍，比较每个阶段的合并数并报告耗时
+    void set_benchmark_matching(bool enabled) { benchmark_matching_ = enabled; }
+    void set_quality_metric(QualityMetric metric) { quality_metric_ = metric; }
+    // [新增] 打开时先分别用两种度量跑一遍，报告质量差、评估耗时及合并结果的差异
+    void set_compare_metric(bool enabled) { compare_metric_ = enabled; }
+    // [新增] 最终四边形为主网格上的 Jacobi 平滑迭代次数 (0 = 不做)
+    void set_final_smoothing(int iterations, unsigned int num_threads = 0) { final_iterations_ = iterations; final_threads_ = num_threads; }
+    // [新增] 结果单元按顶点号排序 (顶点顺序沿用生成器的重排结果，不再重复计算)
+    void set_element_reorder(bool enabled) { element_reorder_ = enabled; }
+
     // 核心函数：接收一个三角网格，返回一个四边形为主的网格
     Result run(const CGALMeshGenerator& delaunay_mesh);
 
+    // [修改] 四边形质量 (四个角与 90 度偏差之和的归一化形式，非凸为 0) 改为公开的静态函数，供 MeshQuality 使用
+    static float calculate_quad_quality(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, const glm::vec2& p3);
+    // [新增] 与 calculate_quad_quality 同义的批量版本：输入为 8 个 SoA 数组 (p0x, p0y, ..., p3x, p3y)
+    static void calculate_quad_quality_batch(const float* const soa[8], float* out, size_t count);
+
 private:
     // --- 内部数据结构 ---
     // 使用别名让代码更清晰
@@ -37,6 +68,7 @@ private:
     };
 
     // Structure for Priority-Based Merging
+    // [修改] 作为候选表的元素保存，堆中只放 (质量, 候选下标, 版本号)
     struct PotentialQuad {
         float quality;
         Tri_idx t1, t2;
@@ -49,34 +81,115 @@ private:
         }
     };
 
+    // [新增] 堆条目：版本号与候选当前版本不一致即为过期 (惰性删除)。
+    // 质量相同时下标小的先出，保证结果与入堆顺序无关
+    struct HeapEntry {
+        float quality;
+        uint32_t candidate;
+        uint32_t version;
+
+        bool operator<(const HeapEntry& other) const {
+            if (quality != other.quality) return quality < other.quality;
+            return candidate > other.candidate;
+        }
+    };
+
+    struct PassConfig {
+        float threshold;
+        bool do_smooth;
+    };
+
+    // [新增] 从当前 (未合并) 状态跑完全部阶段，返回每个阶段的合并数
+    std::vector<int> run_passes(std::vector<glm::vec2>& vertices,
+        const std::vector<CGALMeshGenerator::Triangle>& triangles,
+        const std::vector<PassConfig>& passes, MatchingMode mode, unsigned int num_threads, bool verbose);
+
     // --- 升级后的多阶段算法 ---
-    void build_adjacency(const std::vector<CGALMeshGenerator::Triangle>& triangles);
+    // [修改] 优先使用网格生成器导出的邻接 (neighbors[3t+i] 对着角点 i，-1 为边界)，
+    // 为空时才按边重新配对。邻接只在 run 开始时建一次，各阶段通过 merged_triangles_ 过滤
+    void build_adjacency(const std::vector<CGALMeshGenerator::Triangle>& triangles,
+        const std::vector<int>& neighbors);
     void initial_pair_merging(const std::vector<glm::vec2>& vertices, const std::vector<CGALMeshGenerator::Triangle>& triangles);
 
+    // [新增] 每条内部边一个候选，只在 run 开始时整体评估一次并入堆
+    void build_candidates(const std::vector<glm::vec2>& vertices,
+        const std::vector<CGALMeshGenerator::Triangle>& triangles);
+    // [新增] 只重新评估与 moved 中顶点相关的候选 (版本号 +1 后重新入堆)，返回评估次数
+    size_t rescore_candidates(const std::vector<glm::vec2>& vertices, const std::vector<Vert_idx>& moved);
+
     // Replaces initial_pair_merging with a threshold-based pass
-    int priority_merge_pass(const std::vector<glm::vec2>& vertices,
-        const std::vector<CGALMeshGenerator::Triangle>& triangles,
-        float quality_threshold);
+    // [修改] 从跨阶段保留的堆中弹出，直到堆顶质量低于阈值 (剩余条目留给下一阶段)
+    int priority_merge_pass(float quality_threshold);
+    // [新增] 局部占优边的并行配对，阈值语义与 priority_merge_pass 相同
+    int dominant_merge_pass(float quality_threshold, unsigned int num_threads);
+    int best_candidate(Tri_idx t, float quality_threshold) const;
     // Laplacian smoothing for unmerged triangles
+    // [修改] moved 返回位置实际改变的顶点
     void smooth_vertices(std::vector<glm::vec2>& vertices,
-        const std::vector<CGALMeshGenerator::Triangle>& triangles);
+        const std::vector<CGALMeshGenerator::Triangle>& triangles,
+        std::vector<Vert_idx>& moved);
     // Calculate quality for a potential merge
+    // [修改] 只确定四边形的顶点，质量由 score_candidates 批量计算
     PotentialQuad evaluate_merge(Tri_idx t1_idx, Tri_idx t2_idx,
         const std::vector<CGALMeshGenerator::Triangle>& triangles,
-        const std::vector<glm::vec2>& vertices,
         const Edge& shared_edge);
+    // [新增] 按当前度量计算 ids 中各候选的质量
+    void score_candidates(const std::vector<glm::vec2>& vertices, const std::vector<uint32_t>& ids);
+
+    // [新增] 在最终网格 (四边形 + 剩余三角形) 的顶点邻接 (CSR，去重) 上做并行 Jacobi 平滑，固定边界顶点
+    void smooth_final_mesh(std::vector<glm::vec2>& vertices, int iterations, unsigned int num_threads);
+    // [新增] 单元 e (先四边形后三角形) 从 before 移到 after 后是否仍然有效 (没有翻转或压扁)
+    bool element_stays_valid(size_t e, const std::vector<glm::vec2>& before, const std::vector<glm::vec2>& after) const;
+    float signed_area2(size_t e, const std::vector<glm::vec2>& vertices) const;
+    // [新增] 最终网格中翻转 / 凹进的单元数
+    void count_bad_elements(const std::vector<glm::vec2>& vertices, size_t& inverted, size_t& concave) const;
 
     void iterative_cleanup(const std::vector<glm::vec2>& vertices, std::vector<CGALMeshGenerator::Triangle>& triangles);
     void final_smoothing(std::vector<glm::vec2>& vertices, const Boundary& boundary); // 注意：需要边界信息
 
     // --- 质量评估与辅助函数 ---
-    float calculate_quad_quality(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, const glm::vec2& p3);
     Edge make_sorted_edge(Vert_idx v1, Vert_idx v2);
 
     // --- 成员变量 ---
     std::vector<bool> merged_triangles_;
     std::vector<Tri_adj> adj_list_;
-    std::map<Edge, std::vector<Tri_idx>> edge_to_tri_map_;
+    EdgeTable edge_table_;              // 无现成邻接时的配对 (缓冲区跨调用复用)
+    std::vector<uint64_t> edge_keys_;
+
+    // [新增] 跨阶段的候选与堆
+    std::vector<PotentialQuad> candidates_;
+    std::vector<uint32_t> candidate_version_;
+    std::vector<uint32_t> candidate_stamp_;   // 本轮是否已重新评估 (按 rescore 轮次)
+    uint32_t rescore_round_ = 0;
+    std::vector<int> tri_candidates_;         // 3 * 三角形，edges[j] 上的候选 (-1 = 边界)
+    std::priority_queue<HeapEntry> heap_;
+    std::vector<unsigned int> vert_tri_offsets_, vert_tris_; // 顶点 -> 关联三角形 (CSR)
+    std::vector<Vert_idx> moved_vertices_;
+    std::vector<uint32_t> score_ids_;
+    std::vector<float> soa_;                  // 批量评估的 SoA 缓冲 (8 * kScoreBatch)
+    std::vector<unsigned int> csr_offsets_, csr_neighbors_;
+    std::vector<glm::vec2> smooth_buffer_;
+    std::vector<glm::vec2> smooth_target_;    // 本轮的拉普拉斯目标位置
+    std::vector<float> smooth_step_;          // 每个顶点朝目标移动的比例 (遇到翻转时减半)
+    std::vector<unsigned int> vert_elem_offsets_, vert_elems_; // 顶点 -> 关联单元 (CSR)
+    std::vector<char> bad_elements_;
+    size_t smooth_limited_ = 0;               // 最终平滑中因翻转保护被缩短或取消的移动次数
+    std::vector<float> element_orientation_;  // 每个单元平滑开始时的朝向 (±1)
+    int final_iterations_ = 5;
+    unsigned int final_threads_ = 0;
+    bool element_reorder_ = false;
+    QualityMetric quality_metric_ = QualityMetric::Fast;
+    bool compare_metric_ = false;
+
+    // [新增] 并行配对
+    MatchingMode matching_mode_ = MatchingMode::Greedy;
+    MatchingMode active_mode_ = MatchingMode::Greedy;   // 当前 run_passes 使用的方式 (决定是否维护堆)
+    unsigned int matching_threads_ = 0;
+    bool benchmark_matching_ = false;
+    std::vector<int> best_;                             // 三角形 -> 本阈值下的最佳候选 (-1 = 无)
+    std::vector<unsigned int> work_, next_work_;        // 本轮需要重新选择的三角形
+    std::vector<char> queued_;
+    std::vector<std::vector<uint32_t>> found_;          // 每线程找到的局部占优候选
     Result result_;
 
     std::vector<bool> fixed_vertices_; // Vertices that shouldn't move during smoothing
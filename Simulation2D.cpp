@@ -4,6 +4,10 @@
 #include <random>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include "MappedFile.h"
 
 constexpr float PI = 3.1415926535f;
 
@@ -17,19 +21,36 @@ glm::vec2 Simulation2D::transform_to_local(const glm::vec2& vec, const glm::mat2
 
 // [修改] 构造函数实现
 Simulation2D::Simulation2D(const Boundary& boundary, float refinement_level, float base_particle_spacing)
-    : boundary_(boundary)
+    : boundary_(boundary), refinement_level_(refinement_level), base_particle_spacing_(base_particle_spacing)
 {
+    build_from_scratch();
+}
+
+// [新增] 优先从检查点恢复
+Simulation2D::Simulation2D(const Boundary& boundary, float refinement_level, float base_particle_spacing, const std::string& checkpoint_path)
+    : boundary_(boundary), refinement_level_(refinement_level), base_particle_spacing_(base_particle_spacing)
+{
+    if (!checkpoint_path.empty() && load_checkpoint(checkpoint_path)) {
+        std::cout << "Resumed from checkpoint '" << checkpoint_path << "' at step " << step_count_
+            << " (" << num_particles_ << " particles)." << std::endl;
+        return;
+    }
+    build_from_scratch();
+}
+
+void Simulation2D::build_from_scratch() {
+    const Boundary& boundary = boundary_;
     // [核心修改] 不再根据当前边界大小动态计算，而是直接使用传入的固定间距
     // 以前是: float grid_cell_size = domain_width / 150.0f;
 
-    float grid_cell_size = base_particle_spacing;
+    float grid_cell_size = base_particle_spacing_;
 
     // h_min 和 h_max 基于这个固定的网格尺寸
     h_min_ = grid_cell_size * 0.5f;
     h_max_ = grid_cell_size * 2.0f;
 
     // 初始化背景网格
-    grid_ = std::make_unique<BackgroundGrid>(boundary, grid_cell_size, refinement_level, h_min_, h_max_);
+    grid_ = std::make_unique<BackgroundGrid>(boundary, grid_cell_size, refinement_level_, h_min_, h_max_);
 
     // 初始化粒子
     initialize_particles(boundary);
@@ -102,9 +123,15 @@ void Simulation2D::compute_forces() {
 // --- 核心修改：在位置更新后，更新粒子的方向 ---
 void Simulation2D::update_positions() {
     for (auto& p : particles_) {
-        p.velocity += (p.force / mass_) * time_step_;
-        p.velocity *= damping_;
-        p.position += p.velocity * time_step_;
+        if (p.is_boundary && p.ring_id >= 0) {
+            // 边界粒子：不做自由积分，只沿边界滑移 (或固定)
+            advance_boundary_particle(p);
+        }
+        else {
+            p.velocity += (p.force / mass_) * time_step_;
+            p.velocity *= damping_;
+            p.position += p.velocity * time_step_;
+        }
 
         // 从背景网格更新每个粒子的目标参数
         p.smoothing_h = grid_->get_target_size(p.position);
@@ -134,9 +161,9 @@ void Simulation2D::initialize_particles(const Boundary& boundary) {
     std::cout << "Initializing particles: Hybrid Method (Paper Boundary + Cartesian Interior)..." << std::endl;
 
     // --- A. 生成边界粒子 (论文算法) ---
-    initialize_boundary_particles(boundary.get_outer_boundary());
-    for (const auto& hole : boundary.get_holes()) {
-        initialize_boundary_particles(hole);
+    initialize_boundary_particles(boundary.get_outer_boundary(), 0);
+    for (int k = 0; k < (int)boundary.get_holes().size(); ++k) {
+        initialize_boundary_particles(boundary.get_holes()[k], k + 1);
     }
     std::cout << "  Boundary particles generated." << std::endl;
 
@@ -194,6 +221,9 @@ float Simulation2D::l_inf_norm(const glm::vec2& v) const {
 
 void Simulation2D::handle_boundaries(const Boundary& boundary) {
     for (auto& p : particles_) {
+        // 弧长参数化的边界粒子始终落在边界上，无需 O(E) 的投影
+        if (p.is_boundary && p.ring_id >= 0) continue;
+
         // 如果粒子出界（无论是在最外层外面，还是在内洞里面）
         if (!boundary.is_inside(p.position)) {
 
@@ -228,6 +258,7 @@ void Simulation2D::step() {
     for (int i = 0; i < num_particles_; ++i) {
         positions_for_render_[i] = particles_[i].position;
     }
+    step_count_++;
 }
 
 const std::vector<glm::vec2>& Simulation2D::get_particle_positions() const {
@@ -244,6 +275,227 @@ float Simulation2D::get_kinetic_energy() const {
 }
 
 
+// [新增] 边界粒子的切向积分
+// 只保留力和速度的切向分量，弧长坐标 s 前进后在累计弧长表中二分查找新位置，
+// 因此粒子永远不会离开边界，也不会在拐角处被“甩”出去
+void Simulation2D::advance_boundary_particle(Particle& p) {
+    if (pin_boundary_particles_) {
+        p.velocity = glm::vec2(0.0f);
+        return;
+    }
+
+    glm::vec2 pos, tangent;
+    boundary_.evaluate_arc_length(p.ring_id, p.arc_s, pos, tangent);
+
+    float f_t = glm::dot(p.force, tangent);
+    float v_t = glm::dot(p.velocity, tangent);
+    v_t += (f_t / mass_) * time_step_;
+    v_t *= damping_;
+
+    p.arc_s = boundary_.wrap_arc_length(p.ring_id, p.arc_s + v_t * time_step_);
+    boundary_.evaluate_arc_length(p.ring_id, p.arc_s, p.position, tangent);
+    p.velocity = v_t * tangent;
+}
+
+// ==========================================
+// [新增] 检查点 (完整状态保存 / 恢复)
+// ==========================================
+namespace {
+    constexpr uint32_t kCheckpointVersion = 1;
+
+    struct CheckpointHeader {
+        char magic[4];            // "SMCK"
+        uint32_t version;
+        uint64_t input_hash;      // 边界几何 + 初始化参数的指纹
+        uint64_t step_count;
+        uint32_t particle_count;
+        uint32_t flags;           // bit0: 边界粒子固定
+        int32_t grid_width;
+        int32_t grid_height;
+        float refinement_level;
+        float base_particle_spacing;
+        float time_step, mass, stiffness, damping;
+        float h_min, h_max;
+        float grid_cell_size;
+        float grid_min_x, grid_min_y;
+        uint32_t reserved;
+    };
+
+    // FNV-1a 64 位
+    uint64_t fnv1a(uint64_t h, const void* data, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    template <typename T>
+    void write_array(std::ofstream& out, const std::vector<T>& v) {
+        out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+    }
+
+    // 从映射内存中顺序读出一段数组，越界返回 false
+    template <typename T>
+    bool read_array(const char*& p, const char* end, std::vector<T>& out, size_t n) {
+        size_t bytes = n * sizeof(T);
+        if ((size_t)(end - p) < bytes) return false;
+        out.resize(n);
+        std::memcpy(out.data(), p, bytes);
+        p += bytes;
+        return true;
+    }
+}
+
+uint64_t Simulation2D::compute_input_hash() const {
+    uint64_t h = 14695981039346656037ull;
+    for (int r = 0; r < boundary_.get_ring_count(); ++r) {
+        const auto& ring = boundary_.get_ring(r);
+        uint64_t n = ring.size();
+        h = fnv1a(h, &n, sizeof(n));
+        h = fnv1a(h, ring.data(), ring.size() * sizeof(glm::vec2));
+    }
+    h = fnv1a(h, &refinement_level_, sizeof(refinement_level_));
+    h = fnv1a(h, &base_particle_spacing_, sizeof(base_particle_spacing_));
+    return h;
+}
+
+bool Simulation2D::save_checkpoint(const std::string& path) const {
+    CheckpointHeader header{};
+    std::memcpy(header.magic, "SMCK", 4);
+    header.version = kCheckpointVersion;
+    header.input_hash = compute_input_hash();
+    header.step_count = step_count_;
+    header.particle_count = (uint32_t)particles_.size();
+    header.flags = pin_boundary_particles_ ? 1u : 0u;
+    header.grid_width = grid_->get_width();
+    header.grid_height = grid_->get_height();
+    header.refinement_level = refinement_level_;
+    header.base_particle_spacing = base_particle_spacing_;
+    header.time_step = time_step_;
+    header.mass = mass_;
+    header.stiffness = stiffness_;
+    header.damping = damping_;
+    header.h_min = h_min_;
+    header.h_max = h_max_;
+    header.grid_cell_size = grid_->get_cell_size();
+    header.grid_min_x = grid_->get_min_coords().x;
+    header.grid_min_y = grid_->get_min_coords().y;
+
+    // 粒子按字段拆成 SoA 写出，不依赖 Particle 的内存布局
+    size_t n = particles_.size();
+    std::vector<glm::vec2> position(n), velocity(n), force(n);
+    std::vector<float> smoothing_h(n), target_density(n), arc_s(n);
+    std::vector<glm::mat2> rotation(n);
+    std::vector<uint8_t> is_boundary(n);
+    std::vector<int32_t> ring_id(n);
+    for (size_t i = 0; i < n; ++i) {
+        const auto& p = particles_[i];
+        position[i] = p.position; velocity[i] = p.velocity; force[i] = p.force;
+        smoothing_h[i] = p.smoothing_h; target_density[i] = p.target_density;
+        rotation[i] = p.rotation; is_boundary[i] = p.is_boundary ? 1 : 0;
+        ring_id[i] = p.ring_id; arc_s[i] = p.arc_s;
+    }
+
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open checkpoint for writing: " << tmp_path << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_array(out, position); write_array(out, velocity); write_array(out, force);
+        write_array(out, smoothing_h); write_array(out, target_density);
+        write_array(out, rotation); write_array(out, is_boundary);
+        write_array(out, ring_id); write_array(out, arc_s);
+        write_array(out, grid_->get_target_size_field());
+        write_array(out, grid_->get_target_direction_field());
+        out.flush();
+        if (!out.good()) {
+            std::cerr << "Failed to write checkpoint: " << tmp_path << std::endl;
+            return false;
+        }
+    }
+
+    // 原子替换：进程中途崩溃时旧的检查点仍然完整
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::cerr << "Failed to move checkpoint into place: " << ec.message() << std::endl;
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool Simulation2D::load_checkpoint(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(CheckpointHeader)) return false;
+
+    CheckpointHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, "SMCK", 4) != 0 || header.version != kCheckpointVersion) {
+        std::cerr << "Checkpoint '" << path << "' has an unknown format, ignoring it." << std::endl;
+        return false;
+    }
+    if (header.input_hash != compute_input_hash()
+        || header.refinement_level != refinement_level_
+        || header.base_particle_spacing != base_particle_spacing_) {
+        std::cout << "Checkpoint '" << path << "' belongs to a different chart or settings, ignoring it." << std::endl;
+        return false;
+    }
+
+    const char* p = file.data() + sizeof(header);
+    const char* end = file.data() + file.size();
+    size_t n = header.particle_count;
+    size_t grid_cells = (size_t)header.grid_width * (size_t)header.grid_height;
+
+    std::vector<glm::vec2> position, velocity, force, direction_field;
+    std::vector<float> smoothing_h, target_density, arc_s, size_field;
+    std::vector<glm::mat2> rotation;
+    std::vector<uint8_t> is_boundary;
+    std::vector<int32_t> ring_id;
+    bool ok = read_array(p, end, position, n) && read_array(p, end, velocity, n)
+        && read_array(p, end, force, n) && read_array(p, end, smoothing_h, n)
+        && read_array(p, end, target_density, n) && read_array(p, end, rotation, n)
+        && read_array(p, end, is_boundary, n) && read_array(p, end, ring_id, n)
+        && read_array(p, end, arc_s, n)
+        && read_array(p, end, size_field, grid_cells) && read_array(p, end, direction_field, grid_cells);
+    if (!ok) {
+        std::cerr << "Checkpoint '" << path << "' is truncated, ignoring it." << std::endl;
+        return false;
+    }
+
+    time_step_ = header.time_step;
+    mass_ = header.mass;
+    stiffness_ = header.stiffness;
+    damping_ = header.damping;
+    h_min_ = header.h_min;
+    h_max_ = header.h_max;
+    pin_boundary_particles_ = (header.flags & 1u) != 0;
+    step_count_ = header.step_count;
+
+    grid_ = std::make_unique<BackgroundGrid>(glm::vec2(header.grid_min_x, header.grid_min_y), header.grid_cell_size,
+        header.grid_width, header.grid_height, header.refinement_level, h_min_, h_max_,
+        std::move(size_field), std::move(direction_field));
+
+    particles_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto& q = particles_[i];
+        q.position = position[i]; q.velocity = velocity[i]; q.force = force[i];
+        q.smoothing_h = smoothing_h[i]; q.target_density = target_density[i];
+        q.rotation = rotation[i]; q.is_boundary = is_boundary[i] != 0;
+        q.ring_id = ring_id[i]; q.arc_s = arc_s[i];
+    }
+
+    num_particles_ = (int)n;
+    positions_for_render_.resize(n);
+    for (size_t i = 0; i < n; ++i) positions_for_render_[i] = particles_[i].position;
+    return true;
+}
+
 // ==========================================
 // 2. [你的算法] 域内笛卡尔粒子生成 (四叉树递归)
 // ==========================================
@@ -286,7 +538,7 @@ void Simulation2D::recursive_spawn_particles(glm::vec2 min_pt, glm::vec2 max_pt,
 // ==========================================
 // 1. [论文算法] 边界粒子生成 (Algorithm 1)
 // ==========================================
-void Simulation2D::initialize_boundary_particles(const std::vector<glm::vec2>& loop) {
+void Simulation2D::initialize_boundary_particles(const std::vector<glm::vec2>& loop, int ring_id) {
     if (loop.size() < 2) return;
 
     float Q = 0.0f; // 累加器
@@ -321,6 +573,8 @@ void Simulation2D::initialize_boundary_particles(const std::vector<glm::vec2>& l
                 p.target_density = 1.0f / (h_t * h_t);
                 p.is_boundary = true; // 【关键】标记为边界粒子
                 p.velocity = glm::vec2(0.0f); // 边界粒子不动
+                p.ring_id = ring_id;
+                p.arc_s = boundary_.get_arc_length_at(ring_id, (int)i) + t * L;
 
                 particles_.push_back(p);
             }
@@ -4,6 +4,8 @@
 #include "BackgroundGrid.h"
 //#include "DelaunayMeshGenerator.h"
 #include <memory>
+#include <string>
+#include <cstdint>
 
 class Boundary;
 
@@ -17,11 +19,17 @@ public:
         float target_density = 0.0f;
         glm::mat2 rotation = glm::mat2(1.0f); // 新增：局部坐标系的旋转矩阵
 		bool is_boundary = false;
+        // [新增] 边界粒子的弧长参数化: 所在环 (0=外环, k=第k-1个内洞) 及弧长坐标
+        int ring_id = -1;
+        float arc_s = 0.0f;
 
     };
 
     // [修改] 构造函数增加 base_particle_spacing 参数
     Simulation2D(const Boundary& boundary, float refinement_level, float base_particle_spacing);
+    // [新增] 若 checkpoint_path 处的检查点与当前边界和参数匹配，则直接恢复，
+    // 跳过粒子初始化和背景网格构建；否则与上面的构造函数相同
+    Simulation2D(const Boundary& boundary, float refinement_level, float base_particle_spacing, const std::string& checkpoint_path);
     void step();
     const std::vector<glm::vec2>& get_particle_positions() const;
     const std::vector<Particle>& get_particles() const { return particles_; }
@@ -31,14 +39,29 @@ public:
     BackgroundGrid* get_background_grid() const { return grid_.get(); }
     float get_min_target_size() const { return h_min_; } // <-- 新增
 
+    // [新增] 边界粒子是否完全固定 (false = 沿边界切向滑移)
+    void set_pin_boundary_particles(bool pin) { pin_boundary_particles_ = pin; }
+    bool get_pin_boundary_particles() const { return pin_boundary_particles_; }
+
+    // [新增] 完整状态的检查点 (粒子、背景网格、步数、参数)
+    // 保存时先写临时文件再原子 rename；读取使用内存映射
+    bool save_checkpoint(const std::string& path) const;
+    bool load_checkpoint(const std::string& path);
+    uint64_t get_step_count() const { return step_count_; }
+
 private:
+    void build_from_scratch();
+    // 边界几何 + 初始化参数的指纹，用于判断检查点是否适用于当前输入
+    uint64_t compute_input_hash() const;
     void initialize_particles(const Boundary& boundary);
     void compute_forces();
     void update_positions();
     void handle_boundaries(const Boundary& boundary);
 
     // [新增] 对应论文 Algorithm 1: 边界自适应粒子分布
-    void initialize_boundary_particles(const std::vector<glm::vec2>& loop);
+    void initialize_boundary_particles(const std::vector<glm::vec2>& loop, int ring_id);
+    // [新增] 边界粒子只沿切向积分，位置由弧长表查出
+    void advance_boundary_particle(Particle& p);
 
     // [新增] 对应论文 Algorithm 2: 域内自适应粒子分布
    // void initialize_indomain_particles(const Boundary& boundary);
@@ -66,4 +89,10 @@ private:
     float damping_ = 0.998f;
     float h_max_;             // 最大目标尺寸
     float h_min_;             // <-- 新增：补上这个缺失的声明
+    bool pin_boundary_particles_ = false;
+
+    // [新增] 构造参数 (检查点校验用) 和已执行的步数
+    float refinement_level_ = 0.0f;
+    float base_particle_spacing_ = 0.0f;
+    uint64_t step_count_ = 0;
 };
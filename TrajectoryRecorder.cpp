@@ -0,0 +1,225 @@
+﻿#include "TrajectoryRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+    constexpr uint32_t kTrajectoryVersion = 1;
+    constexpr uint32_t kKeyframe = 0;
+    constexpr uint32_t kDelta = 1;
+}
+
+// ================= TrajectoryRecorder =================
+
+uint64_t TrajectoryRecorder::appendable_length(const std::string& path, size_t particle_count) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return 0;
+
+    TrajectoryHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in.good() || std::memcmp(header.magic, "SMTR", 4) != 0 || header.version != kTrajectoryVersion) {
+        std::cerr << "Warning: '" << path << "' is not a trajectory file, overwriting it." << std::endl;
+        return 0;
+    }
+    if (header.particle_count != particle_count) {
+        std::cerr << "Warning: '" << path << "' was recorded with " << header.particle_count
+            << " particles (now " << particle_count << "), starting a new trajectory." << std::endl;
+        return 0;
+    }
+
+    // 与 TrajectoryReader::open 相同的规则逐条跳过记录
+    std::error_code ec;
+    uint64_t file_size = (uint64_t)std::filesystem::file_size(path, ec);
+    if (ec) return 0;
+    uint64_t offset = sizeof(header);
+    TrajectoryRecordHeader rh{};
+    while (file_size - offset >= sizeof(rh)) {
+        in.seekg((std::streamoff)offset);
+        in.read(reinterpret_cast<char*>(&rh), sizeof(rh));
+        if (!in.good()) break;
+        uint64_t expected = (rh.type == kKeyframe) ? particle_count * sizeof(glm::vec2) : particle_count * 2 * sizeof(int16_t);
+        if (rh.payload_bytes != expected || file_size - offset - sizeof(rh) < expected) break;
+        offset += sizeof(rh) + expected;
+    }
+    return offset;
+}
+
+bool TrajectoryRecorder::open(const std::string& path, size_t particle_count, uint32_t keyframe_interval, float max_error,
+    bool append) {
+    close();
+
+    // [修改] 默认接在已有轨迹之后，不再每次运行都截断文件
+    uint64_t existing = append ? appendable_length(path, particle_count) : 0;
+    if (existing > 0) {
+        std::error_code ec;
+        if (existing != (uint64_t)std::filesystem::file_size(path, ec)) {
+            std::cerr << "Warning: dropping incomplete trailing record in '" << path << "'." << std::endl;
+            std::filesystem::resize_file(path, existing, ec);
+            if (ec) existing = 0;
+        }
+    }
+
+    // 大缓冲区：每帧只触发少量系统调用
+    io_buffer_.resize(1 << 22);
+    out_.rdbuf()->pubsetbuf(io_buffer_.data(), (std::streamsize)io_buffer_.size());
+    out_.open(path, std::ios::binary | (existing > 0 ? std::ios::app : std::ios::trunc));
+    if (!out_.is_open()) {
+        std::cerr << "Failed to open trajectory file: " << path << std::endl;
+        return false;
+    }
+
+    particle_count_ = particle_count;
+    keyframe_interval_ = std::max(1u, keyframe_interval);
+    max_error_ = max_error;
+    frames_since_key_ = 0;
+    frame_count_ = 0;
+    bytes_written_ = 0;
+    total_record_us_ = 0.0;
+    reconstructed_.clear(); // 保证本次运行的第一帧是关键帧
+    quantized_.resize(particle_count * 2);
+
+    if (existing > 0) {
+        std::cout << "[Trajectory] Appending to " << path << " (" << existing << " bytes already recorded)" << std::endl;
+        return true;
+    }
+
+    TrajectoryHeader header{};
+    std::memcpy(header.magic, "SMTR", 4);
+    header.version = kTrajectoryVersion;
+    header.particle_count = (uint32_t)particle_count;
+    header.keyframe_interval = keyframe_interval_;
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytes_written_ += sizeof(header);
+    return true;
+}
+
+void TrajectoryRecorder::close() {
+    if (!out_.is_open()) return;
+    out_.close();
+    std::cout << "[Trajectory] " << frame_count_ << " frames, " << bytes_written_ / (1024.0 * 1024.0)
+        << " MB, mean record cost " << get_mean_record_us() << " us/step." << std::endl;
+}
+
+void TrajectoryRecorder::write_record(uint32_t type, uint64_t step, float scale, const void* payload, size_t bytes) {
+    TrajectoryRecordHeader rh{};
+    rh.type = type;
+    rh.payload_bytes = (uint32_t)bytes;
+    rh.step = step;
+    rh.scale = scale;
+    out_.write(reinterpret_cast<const char*>(&rh), sizeof(rh));
+    out_.write(static_cast<const char*>(payload), (std::streamsize)bytes);
+    bytes_written_ += sizeof(rh) + bytes;
+}
+
+void TrajectoryRecorder::record(uint64_t step, const std::vector<glm::vec2>& positions) {
+    if (!out_.is_open() || positions.size() != particle_count_) return;
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    bool keyframe = reconstructed_.empty() || frames_since_key_ >= keyframe_interval_;
+    float scale = 0.0f;
+
+    if (!keyframe) {
+        // 位移的最大分量决定量化步长
+        float max_delta = 0.0f;
+        for (size_t i = 0; i < particle_count_; ++i) {
+            glm::vec2 d = positions[i] - reconstructed_[i];
+            max_delta = std::max(max_delta, std::max(std::abs(d.x), std::abs(d.y)));
+        }
+        scale = std::max(max_delta / 32767.0f, 1e-12f);
+        // 半个量化步长就是最大误差，太粗就改写关键帧
+        if (scale * 0.5f > max_error_) keyframe = true;
+    }
+
+    if (keyframe) {
+        reconstructed_ = positions;
+        write_record(kKeyframe, step, 0.0f, positions.data(), particle_count_ * sizeof(glm::vec2));
+        frames_since_key_ = 1;
+    }
+    else {
+        float inv_scale = 1.0f / scale;
+        for (size_t i = 0; i < particle_count_; ++i) {
+            glm::vec2 d = (positions[i] - reconstructed_[i]) * inv_scale;
+            int16_t qx = (int16_t)std::max(-32767.0f, std::min(32767.0f, std::round(d.x)));
+            int16_t qy = (int16_t)std::max(-32767.0f, std::min(32767.0f, std::round(d.y)));
+            quantized_[2 * i] = qx;
+            quantized_[2 * i + 1] = qy;
+            // 与 TrajectoryReader::apply 完全相同的重建运算
+            reconstructed_[i] += glm::vec2((float)qx, (float)qy) * scale;
+        }
+        write_record(kDelta, step, scale, quantized_.data(), quantized_.size() * sizeof(int16_t));
+        frames_since_key_++;
+    }
+
+    frame_count_++;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    total_record_us_ += std::chrono::duration<double, std::micro>(t1 - t0).count();
+}
+
+// ================= TrajectoryReader =================
+
+bool TrajectoryReader::open(const std::string& path) {
+    frames_.clear();
+    current_frame_ = SIZE_MAX;
+    if (!file_.open(path) || file_.size() < sizeof(TrajectoryHeader)) return false;
+
+    TrajectoryHeader header;
+    std::memcpy(&header, file_.data(), sizeof(header));
+    if (std::memcmp(header.magic, "SMTR", 4) != 0 || header.version != kTrajectoryVersion) {
+        std::cerr << "Error: '" << path << "' is not a trajectory file." << std::endl;
+        return false;
+    }
+    particle_count_ = header.particle_count;
+
+    const char* p = file_.data() + sizeof(header);
+    const char* end = file_.data() + file_.size();
+    size_t last_key = SIZE_MAX;
+    while ((size_t)(end - p) >= sizeof(TrajectoryRecordHeader)) {
+        const auto* rh = reinterpret_cast<const TrajectoryRecordHeader*>(p);
+        const char* payload = p + sizeof(TrajectoryRecordHeader);
+        size_t expected = (rh->type == kKeyframe) ? particle_count_ * sizeof(glm::vec2) : particle_count_ * 2 * sizeof(int16_t);
+        // 录制中途崩溃时最后一条记录可能不完整，直接截断
+        if (rh->payload_bytes != expected || (size_t)(end - payload) < expected) break;
+
+        if (rh->type == kKeyframe) last_key = frames_.size();
+        if (last_key == SIZE_MAX) break; // 第一帧必须是关键帧
+        frames_.push_back({ rh, payload, rh->step, last_key });
+        p = payload + expected;
+    }
+
+    current_.assign(particle_count_, glm::vec2(0.0f));
+    std::cout << "[Replay] " << path << ": " << frames_.size() << " frames, " << particle_count_ << " particles." << std::endl;
+    return !frames_.empty();
+}
+
+void TrajectoryReader::apply(size_t frame) {
+    const FrameEntry& f = frames_[frame];
+    if (f.header->type == kKeyframe) {
+        std::memcpy(current_.data(), f.payload, particle_count_ * sizeof(glm::vec2));
+    }
+    else {
+        float scale = f.header->scale;
+        const char* q = f.payload;
+        for (size_t i = 0; i < particle_count_; ++i) {
+            int16_t qxy[2];
+            std::memcpy(qxy, q + i * sizeof(qxy), sizeof(qxy));
+            current_[i] += glm::vec2((float)qxy[0], (float)qxy[1]) * scale;
+        }
+    }
+    current_frame_ = frame;
+}
+
+const std::vector<glm::vec2>& TrajectoryReader::decode(size_t frame) {
+    frame = std::min(frame, frames_.size() - 1);
+    if (frame == current_frame_) return current_;
+
+    // 能从当前帧顺序推进就不回到关键帧
+    size_t start = frames_[frame].keyframe;
+    if (current_frame_ != SIZE_MAX && current_frame_ < frame && current_frame_ >= start) {
+        start = current_frame_ + 1;
+    }
+    for (size_t i = start; i <= frame; ++i) apply(i);
+    return current_;
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MappedFile.h"
+
+// 粒子轨迹记录 (.smtr)，用于离线调节刚度/阻尼时回放整段松弛过程
+//
+// 布局 (小端，只追加)：
+//   TrajectoryHeader
+//   { TrajectoryRecordHeader + 负载 } x N
+//     关键帧负载: vec2 (float32) x particle_count
+//     差分帧负载: int16 (dx, dy) x particle_count，实际位移 = q * scale
+// 差分是相对于 *解码器重建出的* 上一帧计算的，量化误差不会逐帧累积；
+// 每 keyframe_interval 帧或位移超出量化范围时写入关键帧。
+// 同一文件可以跨多次运行 (如从检查点恢复) 继续追加：每次打开后的第一帧总是关键帧，
+// 它就是两次运行之间的分界，之前末尾不完整的记录会先被截掉。
+
+struct TrajectoryHeader {
+    char magic[4];            // "SMTR"
+    uint32_t version;
+    uint32_t particle_count;
+    uint32_t keyframe_interval;
+};
+
+struct TrajectoryRecordHeader {
+    uint32_t type;            // 0 = 关键帧, 1 = 差分帧
+    uint32_t payload_bytes;
+    uint64_t step;
+    float scale;              // 差分帧的量化步长
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TrajectoryHeader) == 16, "TrajectoryHeader layout");
+static_assert(sizeof(TrajectoryRecordHeader) == 24, "TrajectoryRecordHeader layout");
+
+class TrajectoryRecorder {
+public:
+    TrajectoryRecorder() = default;
+    ~TrajectoryRecorder() { close(); }
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    // max_error: 允许的最大量化误差 (与坐标同单位)，超出时改写关键帧
+    // append: 文件已存在且粒子数相同时接在末尾继续写，否则 (或 append = false) 重新开始
+    bool open(const std::string& path, size_t particle_count, uint32_t keyframe_interval = 256, float max_error = 1e-4f,
+        bool append = true);
+    void close();
+    bool is_open() const { return out_.is_open(); }
+
+    // 追加一帧，positions 的大小必须等于 open 时的 particle_count
+    void record(uint64_t step, const std::vector<glm::vec2>& positions);
+
+    // 统计：已写帧数、字节数、每帧平均耗时 (微秒)
+    size_t get_frame_count() const { return frame_count_; }
+    uint64_t get_bytes_written() const { return bytes_written_; }
+    double get_mean_record_us() const { return frame_count_ ? total_record_us_ / frame_count_ : 0.0; }
+
+private:
+    // 检查已有文件能否追加：返回最后一条完整记录的结束位置，不能追加时返回 0
+    static uint64_t appendable_length(const std::string& path, size_t particle_count);
+    void write_record(uint32_t type, uint64_t step, float scale, const void* payload, size_t bytes);
+
+    std::vector<char> io_buffer_;   // 必须先于 out_ 构造、后于 out_ 析构
+    std::ofstream out_;
+    std::vector<glm::vec2> reconstructed_;   // 与解码器一致的上一帧
+    std::vector<int16_t> quantized_;
+    size_t particle_count_ = 0;
+    uint32_t keyframe_interval_ = 256;
+    float max_error_ = 1e-4f;
+    size_t frames_since_key_ = 0;
+
+    size_t frame_count_ = 0;
+    uint64_t bytes_written_ = 0;
+    double total_record_us_ = 0.0;
+};
+
+// 内存映射回放：打开时扫描一遍记录头建立帧索引，之后任意跳帧
+class TrajectoryReader {
+public:
+    bool open(const std::string& path);
+    bool is_open() const { return !frames_.empty(); }
+
+    size_t get_frame_count() const { return frames_.size(); }
+    size_t get_particle_count() const { return particle_count_; }
+    uint64_t get_step(size_t frame) const { return frames_[frame].step; }
+
+    // 解码第 frame 帧；顺序播放时只需应用一帧差分，跳帧时从最近的关键帧开始
+    const std::vector<glm::vec2>& decode(size_t frame);
+
+private:
+    struct FrameEntry {
+        const TrajectoryRecordHeader* header;
+        const char* payload;
+        uint64_t step;
+        size_t keyframe;   // 本帧之前 (含本帧) 最近的关键帧编号
+    };
+
+    void apply(size_t frame);
+
+    MappedFile file_;
+    std::vector<FrameEntry> frames_;
+    size_t particle_count_ = 0;
+    std::vector<glm::vec2> current_;
+    size_t current_frame_ = SIZE_MAX;
+};
@@ -0,0 +1,47 @@
+﻿#include "TriangulationBackend.h"
+#include <algorithm>
+#include <iterator>
+
+std::vector<unsigned int> canonical_source_ids(const std::vector<glm::vec2>& points) {
+    const unsigned int n = (unsigned int)points.size();
+    std::vector<unsigned int> order(n), canonical(n);
+    for (unsigned int i = 0; i < n; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+        if (points[a].x != points[b].x) return points[a].x < points[b].x;
+        if (points[a].y != points[b].y) return points[a].y < points[b].y;
+        return a < b;
+    });
+    for (size_t k = 0; k < order.size(); ++k) {
+        bool dup = k > 0 && points[order[k]].x == points[order[k - 1]].x && points[order[k]].y == points[order[k - 1]].y;
+        canonical[order[k]] = dup ? canonical[order[k - 1]] : order[k];
+    }
+    return canonical;
+}
+
+TriangulationComparison compare_triangulations(const TriangulationInput& input,
+    const TriangulationResult& reference, const TriangulationResult& candidate) {
+    std::vector<unsigned int> canonical = canonical_source_ids(input.points);
+    auto normalize = [&](const TriangulationResult& r) {
+        std::vector<std::array<unsigned int, 3>> tris = r.triangles;
+        for (auto& t : tris) {
+            for (auto& v : t) v = canonical[v];
+            int k = (int)(std::min_element(t.begin(), t.end()) - t.begin());
+            std::rotate(t.begin(), t.begin() + k, t.end());
+        }
+        std::sort(tris.begin(), tris.end());
+        return tris;
+    };
+    auto ref = normalize(reference);
+    auto cand = normalize(candidate);
+
+    std::vector<std::array<unsigned int, 3>> diff;
+    TriangulationComparison cmp;
+    cmp.reference_count = ref.size();
+    cmp.candidate_count = cand.size();
+    std::set_difference(ref.begin(), ref.end(), cand.begin(), cand.end(), std::back_inserter(diff));
+    cmp.missing = diff.size();
+    diff.clear();
+    std::set_difference(cand.begin(), cand.end(), ref.begin(), ref.end(), std::back_inserter(diff));
+    cmp.extra = diff.size();
+    return cmp;
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+// 约束三角化后端的统一接口 (CGAL 为参考实现，NativeDelaunay 为轻量实现)
+//
+// 输入点按 "来源下标" 编号 (CGALMeshGenerator 中：粒子在前，多边形约束顶点在后)，
+// 约束为来源下标对。输出为域内 (嵌套层级为奇数) 的三角形，逆时针，顶点同样用来源下标。
+// 重合点只保留最小来源下标 (见 canonical_source_ids)。
+
+struct TriangulationInput {
+    std::vector<glm::vec2> points;
+    std::vector<std::pair<unsigned int, unsigned int>> constraints;
+};
+
+struct TriangulationResult {
+    std::vector<std::array<unsigned int, 3>> triangles;
+    // [新增] neighbors[k][i] 为与三角形 k 共享 "对着角点 i 的边" 的结果三角形下标，-1 表示域边界。
+    // 后端不提供时为空
+    std::vector<std::array<int, 3>> neighbors;
+};
+
+class TriangulationBackend {
+public:
+    virtual ~TriangulationBackend() = default;
+    virtual const char* name() const = 0;
+    virtual bool triangulate(const TriangulationInput& input, TriangulationResult& result) = 0;
+};
+
+// 重合点 -> 最小来源下标 (其余点映射到自身)
+std::vector<unsigned int> canonical_source_ids(const std::vector<glm::vec2>& points);
+
+// 两个后端结果的比较 (三角形旋转到最小下标在前后按集合比较)
+struct TriangulationComparison {
+    size_t reference_count = 0;
+    size_t candidate_count = 0;
+    size_t missing = 0;   // 参考结果中有、候选结果中没有
+    size_t extra = 0;     // 候选结果中有、参考结果中没有
+    bool identical() const { return missing == 0 && extra == 0; }
+};
+
+TriangulationComparison compare_triangulations(const TriangulationInput& input,
+    const TriangulationResult& reference, const TriangulationResult& candidate);
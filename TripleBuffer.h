@@ -0,0 +1,41 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+
+// 单写单读的无锁三缓冲
+// 写端始终独占 back 块，publish() 把它与中间块交换并打上 "新数据" 标记；
+// 读端 acquire() 仅在有新数据时把 front 块与中间块交换。两端都不会等待对方，
+// 读端拿到的总是最近一次发布的完整数据 (中间发布的会被跳过)。
+template <typename T>
+class TripleBuffer {
+public:
+    // --- 写端 ---
+    T& write_buffer() { return slots_[back_]; }
+    void publish() {
+        uint8_t prev = middle_.exchange((uint8_t)(back_ | kFresh), std::memory_order_acq_rel);
+        back_ = prev & kIndexMask;
+    }
+
+    // --- 读端 ---
+    // 有新发布的数据时切换到它并返回 true
+    bool acquire() {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh)) return false;
+        uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & kIndexMask;
+        return true;
+    }
+    bool has_update() const { return (middle_.load(std::memory_order_relaxed) & kFresh) != 0; }
+    const T& read_buffer() const { return slots_[front_]; }
+
+    // 直接访问第 index 块，只能在两端线程启动之前 (或都停止之后) 使用
+    T& slot(int index) { return slots_[index]; }
+
+private:
+    static const uint8_t kIndexMask = 0x3;
+    static const uint8_t kFresh = 0x4;
+
+    T slots_[3];
+    uint8_t back_ = 0;                 // 仅写端访问
+    uint8_t front_ = 1;                // 仅读端访问
+    std::atomic<uint8_t> middle_{ 2 }; // 中间块下标 | kFresh
+};
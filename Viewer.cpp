@@ -1,8 +1,13 @@
 ﻿#include "Viewer.h"
+#include "MeshReorder.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 
 // --- 构造函数：打开日志文件 ---
 Viewer::Viewer(int width, int height, const std::string& title)
@@ -12,10 +17,13 @@ Viewer::Viewer(int width, int height, const std::string& title)
     if (convergence_log_.is_open()) {
         convergence_log_ << "Step,KineticEnergy\n"; // 写入CSV表头
     }
+    snapshot_writer_ = std::make_unique<SnapshotWriter>();
 }
 
 // --- 析构函数：关闭日志文件 ---
 Viewer::~Viewer() {
+    stop_meshing_thread();
+    stop_simulation_thread();
     delete shader_;
     delete point_shader_;
     delete size_field_shader_;
@@ -34,6 +42,7 @@ Viewer::~Viewer() {
     }
 
     glDeleteVertexArrays(1, &VAO_particles_); glDeleteBuffers(1, &VBO_particles_);
+    destroy_stream_buffer();
     glDeleteVertexArrays(1, &VAO_size_field_); glDeleteBuffers(1, &VBO_size_field_);
 
     // (建议) 既然你也有 VAO_mesh_ 等，最好也在这里清理一下，虽然不是本次错误的重点
@@ -181,16 +190,21 @@ void Viewer::main_loop() {
         if (glfwGetKey(window_, GLFW_KEY_ESCAPE) == GLFW_PRESS)
             glfwSetWindowShouldClose(window_, true);
 
-        if (current_view_ == ViewMode::Particles || current_view_ == ViewMode::SizeField) {
-            if (sim2d_) {
-                sim2d_->step();
-                step_count_++;
-                if (step_count_ % 10 == 0 && convergence_log_.is_open()) {
-                    convergence_log_ << step_count_ << "," << sim2d_->get_kinetic_energy() << "\n";
-                }
-                update_particle_buffers();
+        // [修改] 模拟在独立线程中推进，这里只决定是否允许推进并取最新发布的位置
+        if (replay_mode_) {
+            update_replay();
+        }
+        else if (sim2d_) {
+            // [修改] 网格化任务进行中也继续松弛
+            sim_enabled_.store(current_view_ == ViewMode::Particles || current_view_ == ViewMode::SizeField
+                || (live_mesh_ && current_view_ == ViewMode::Triangles) || mesh_busy_.load());
+            if (update_particle_buffers() && live_mesh_ && current_view_ == ViewMode::Triangles) {
+                // 预览任务不取消正在运行的任务；网格线程忙时直接跳过，等它空闲后用最新的帧
+                submit_mesh_job(MeshJobKind::Triangulate, false);
             }
+            update_title();
         }
+        poll_mesh_job();
 
         glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -214,13 +228,19 @@ void Viewer::main_loop() {
                 glBindVertexArray(0);
                 glDrawArrays(GL_LINE_LOOP, 0, boundary_->get_vertices().size());
             }
-            if (sim2d_ && point_shader_) {
+            if (point_shader_ && particle_draw_count_ > 0) {
                 point_shader_->use();
                 point_shader_->setMat4("model", model); point_shader_->setMat4("view", view); point_shader_->setMat4("projection", projection);
                 glPointSize(8.0f);
-                glBindVertexArray(VAO_particles_);
-                if (!sim2d_->get_particle_positions().empty()) {
-                    glDrawArrays(GL_POINTS, 0, sim2d_->get_particle_positions().size());
+                if (draw_segment_ >= 0) {
+                    // [新增] 直接从持久映射的段绘制，并为该段打上栅栏
+                    glBindVertexArray(VAO_stream_);
+                    glDrawArrays(GL_POINTS, (GLint)(draw_segment_ * stream_capacity_), (GLsizei)particle_draw_count_);
+                    fence_stream_segment(draw_segment_);
+                }
+                else {
+                    glBindVertexArray(VAO_particles_);
+                    glDrawArrays(GL_POINTS, 0, (GLsizei)particle_draw_count_);
                 }
             }
             break;
@@ -254,22 +274,22 @@ void Viewer::main_loop() {
             break;
         }
         case ViewMode::Triangles: {
-            if (cgal_generator_ && shader_ && !cgal_generator_->get_vertices().empty()) {
+            if (shader_ && !mesh_vertices_.empty()) {
                 shader_->use();
                 shader_->setMat4("model", model); shader_->setMat4("view", view); shader_->setMat4("projection", projection);
                 shader_->setVec4("color", glm::vec4(0.9f, 0.9f, 0.9f, 1.0f));
                 glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
                 glLineWidth(1.0f);
                 glBindVertexArray(VAO_mesh_);
-                if (!cgal_generator_->get_triangles().empty()) {
-                    glDrawElements(GL_TRIANGLES, cgal_generator_->get_triangles().size() * 3, GL_UNSIGNED_INT, 0);
+                if (!mesh_triangles_.empty()) {
+                    glDrawElements(GL_TRIANGLES, mesh_triangles_.size() * 3, GL_UNSIGNED_INT, 0);
                 }
                 glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
             }
             break;
         }
         case ViewMode::Quads: {
-            if (cgal_generator_ && shader_ && !cgal_generator_->get_vertices().empty()) {
+            if (shader_ && !quad_vertices_.empty()) {
                 shader_->use();
                 shader_->setMat4("model", model); shader_->setMat4("view", view); shader_->setMat4("projection", projection);
                 shader_->setVec4("color", glm::vec4(0.9f, 0.9f, 0.9f, 1.0f));
@@ -295,19 +315,20 @@ void Viewer::main_loop() {
 // --- 新增函数 ---
 
 void Viewer::update_mesh_buffers() {
-    if (!cgal_generator_ || cgal_generator_->get_vertices().empty()) return;
+    if (VAO_mesh_ == 0) return;
+    // [修改] 四边形模式显示 Qmorph 平滑后的顶点；数据都来自渲染线程持有的拷贝
+    const auto& vertices = current_view_ == ViewMode::Quads ? quad_vertices_ : mesh_vertices_;
+    if (vertices.empty()) return;
 
     glBindVertexArray(VAO_mesh_);
-
     glBindBuffer(GL_ARRAY_BUFFER, VBO_mesh_);
-    glBufferData(GL_ARRAY_BUFFER, cgal_generator_->get_vertices().size() * sizeof(glm::vec2), cgal_generator_->get_vertices().data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_mesh_);
 
     // 关键：只根据当前应该显示的内容来准备EBO
     if (current_view_ == ViewMode::Triangles) {
-        const auto& tris = cgal_generator_->get_triangles();
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, tris.size() * sizeof(CGALMeshGenerator::Triangle), tris.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_triangles_.size() * sizeof(CGALMeshGenerator::Triangle), mesh_triangles_.data(), GL_STATIC_DRAW);
     }
     else if (current_view_ == ViewMode::Quads) {
         std::vector<unsigned int> line_indices;
@@ -328,6 +349,211 @@ void Viewer::update_mesh_buffers() {
     glBindVertexArray(0);
 }
 
+// [新增] 后台网格化
+// 按键 (C / D) 提交的任务会取消所有更早的任务 (正在运行的在阶段之间放弃，结果不会显示)；
+// 实时预览的任务不打断按键任务，并且只在网格线程空闲时提交。
+void Viewer::submit_mesh_job(MeshJobKind kind, bool interactive) {
+    if (!cgal_generator_ || !sim2d_ || !boundary_) return;
+    // [修改] 网格线程忙 (有任务在运行或排队) 时不提交预览：否则每个发布的帧都要在 sim_mutex_ 下
+    // 拷贝全部粒子，而这份拷贝随即被下一帧的预览替换，白白拖慢模拟线程
+    if (!interactive && mesh_busy_.load()) return;
+    MeshJob job;
+    job.kind = kind;
+    job.interactive = interactive;
+    if (kind != MeshJobKind::Quadrangulate) {
+        std::lock_guard<std::mutex> lock(sim_mutex_);
+        job.particles = sim2d_->get_particles();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mesh_mutex_);
+        if (!interactive && (has_pending_job_ || running_interactive_)) return;
+        job.generation = ++mesh_generation_;
+        if (interactive) cancel_before_.store(job.generation);
+        if (has_pending_job_ && !pending_job_.interactive && interactive) {
+            std::cout << "[Mesh] Replacing pending preview job." << std::endl;
+        }
+        else if (has_pending_job_ && interactive) {
+            std::cout << "[Mesh] Coalesced with the pending request." << std::endl;
+        }
+        pending_job_ = std::move(job);
+        has_pending_job_ = true;
+        mesh_busy_.store(true);
+        if (!mesh_thread_.joinable()) mesh_thread_ = std::thread(&Viewer::meshing_loop, this);
+    }
+    mesh_cv_.notify_one();
+}
+
+void Viewer::stop_meshing_thread() {
+    {
+        std::lock_guard<std::mutex> lock(mesh_mutex_);
+        mesh_quit_ = true;
+    }
+    mesh_cv_.notify_one();
+    if (mesh_thread_.joinable()) mesh_thread_.join();
+}
+
+void Viewer::meshing_loop() {
+    while (true) {
+        MeshJob job;
+        {
+            std::unique_lock<std::mutex> lock(mesh_mutex_);
+            mesh_cv_.wait(lock, [this]() { return mesh_quit_ || has_pending_job_; });
+            if (mesh_quit_) break;
+            job = std::move(pending_job_);
+            has_pending_job_ = false;
+            running_interactive_ = job.interactive;
+        }
+
+        auto result = std::make_unique<MeshJobResult>();
+        bool done = run_mesh_job(job, *result);
+        if (!done && job.interactive && is_stale(job.generation)) {
+            std::cout << "[Mesh] Job " << job.generation << " cancelled by a newer request." << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(mesh_mutex_);
+        running_interactive_ = false;
+        if (done && !is_stale(job.generation)) finished_job_ = std::move(result);
+        mesh_busy_.store(has_pending_job_);
+    }
+}
+
+bool Viewer::is_stale(uint64_t generation) const {
+    return generation < cancel_before_.load();
+}
+
+// 只在网格线程中调用：生成器、Qmorph、DirectQuadBuilder 与导出器只被这个线程使用
+bool Viewer::run_mesh_job(const MeshJob& job, MeshJobResult& result) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    result.kind = job.kind;
+    result.generation = job.generation;
+    result.interactive = job.interactive;
+
+    auto capture_triangles = [&]() {
+        result.vertices = cgal_generator_->get_vertices();
+        result.triangles = cgal_generator_->get_triangles();
+        result.boundary_flags = cgal_generator_->get_boundary_edge_flags();
+    };
+
+    if (job.kind == MeshJobKind::Triangulate) {
+        cgal_generator_->generate_mesh(job.particles, *boundary_);
+        if (is_stale(job.generation)) return false;
+        // [修改] 实时预览不重排；交互生成的网格就是之后导出和四边形化所用的网格，在这里重排一次
+        if (job.interactive) cgal_generator_->reorder_mesh();
+        capture_triangles();
+        if (job.interactive) export_mesh(result, false);
+        return true;
+    }
+
+    if (job.kind == MeshJobKind::Quadrangulate) {
+        if (!qmorph_converter_ || cgal_generator_->get_triangles().empty()) return false;
+        cgal_generator_->reorder_mesh(); // 最后一次生成来自实时预览时尚未重排
+        auto quads = qmorph_converter_->run(*cgal_generator_);
+        if (is_stale(job.generation)) return false;
+        capture_triangles();
+        result.quads = std::move(quads.quads);
+        result.remaining_triangles = std::move(quads.remaining_triangles);
+        result.quad_vertices = std::move(quads.vertices);
+        export_mesh(result, true);
+        return true;
+    }
+
+    // DirectQuads：同一组粒子分别走 CDT + Qmorph 与 DirectQuadBuilder 两条路径，打印四边形比例与耗时
+    // 四边形占网格面积的比例
+    auto area_ratio = [](const std::vector<glm::vec2>& v, const std::vector<CGALMeshGenerator::Quad>& quads,
+        const std::vector<CGALMeshGenerator::Triangle>& tris) {
+        auto tri_area = [&](unsigned int a, unsigned int b, unsigned int c) {
+            glm::vec2 e1 = v[b] - v[a], e2 = v[c] - v[a];
+            return 0.5 * std::abs((double)e1.x * e2.y - (double)e1.y * e2.x);
+        };
+        double qa = 0.0, ta = 0.0;
+        for (const auto& q : quads) qa += tri_area(q.v0, q.v1, q.v2) + tri_area(q.v0, q.v2, q.v3);
+        for (const auto& t : tris) ta += tri_area(t.v0, t.v1, t.v2);
+        return qa + ta > 0.0 ? qa / (qa + ta) : 0.0;
+    };
+    auto report = [](const char* name, size_t quads, size_t tris, double area, double time) {
+        size_t elements = quads + tris;
+        std::cout << "  " << name << ": " << quads << " quads + " << tris << " tris, quad ratio "
+            << (elements ? 100.0 * quads / elements : 0.0) << "% of elements / " << 100.0 * area << "% of area, "
+            << time << " ms" << std::endl;
+    };
+
+    std::cout << "[DirectQuads] Comparing with CDT + Qmorph on " << job.particles.size() << " particles..." << std::endl;
+    auto t0 = Clock::now();
+    cgal_generator_->generate_mesh(job.particles, *boundary_);
+    cgal_generator_->reorder_mesh();
+    if (qmorph_converter_) {
+        auto quads = qmorph_converter_->run(*cgal_generator_);
+        auto t1 = Clock::now();
+        report("CDT + Qmorph", quads.quads.size(), quads.remaining_triangles.size(),
+            area_ratio(quads.vertices, quads.quads, quads.remaining_triangles), ms(t0, t1));
+    }
+    if (is_stale(job.generation)) return false;
+    capture_triangles();
+
+    t0 = Clock::now();
+    bool ok = direct_builder_.build(job.particles, *boundary_);
+    auto t1 = Clock::now();
+    if (!ok) {
+        std::cout << "[DirectQuads] Direct build failed, keeping the current view." << std::endl;
+        return false;
+    }
+    double total = direct_builder_.get_quad_area() + direct_builder_.get_triangle_area();
+    report("Direct      ", direct_builder_.get_quads().size(), direct_builder_.get_triangles().size(),
+        total > 0.0 ? direct_builder_.get_quad_area() / total : 0.0, ms(t0, t1));
+    if (is_stale(job.generation)) return false;
+
+    result.quads = direct_builder_.get_quads();
+    result.remaining_triangles = direct_builder_.get_triangles();
+    result.quad_vertices = direct_builder_.get_vertices();
+    result.direct = true;
+    // [新增] 直接构建的网格顶点编号与 CGAL 网格无关，按同样的方式单独重排一次再导出
+    MeshOrdering ordering = cgal_generator_->get_reorder();
+    if (ordering != MeshOrdering::None) {
+        MeshOrderStats before = MeshReorder::measure(result.quad_vertices.size(), result.remaining_triangles, result.quads);
+        MeshReorder::apply(ordering, result.quad_vertices, result.remaining_triangles, result.quads);
+        MeshOrderStats after = MeshReorder::measure(result.quad_vertices.size(), result.remaining_triangles, result.quads);
+        std::cout << "  [reorder] direct quads, " << MeshReorder::name(ordering) << ": bandwidth " << before.bandwidth
+            << " -> " << after.bandwidth << ", profile " << before.profile << " -> " << after.profile << std::endl;
+    }
+    export_mesh(result, true);
+    return true;
+}
+
+// 渲染线程：有完成的任务时换入显示数据
+void Viewer::poll_mesh_job() {
+    std::unique_ptr<MeshJobResult> result;
+    {
+        std::lock_guard<std::mutex> lock(mesh_mutex_);
+        if (!finished_job_) return;
+        result = std::move(finished_job_);
+    }
+    if (is_stale(result->generation)) return;
+
+    mesh_vertices_ = std::move(result->vertices);
+    mesh_triangles_ = std::move(result->triangles);
+    if (result->kind == MeshJobKind::Triangulate) {
+        // 预览只刷新三角网格，不切换视图
+        if (!result->interactive) {
+            if (current_view_ == ViewMode::Triangles) update_mesh_buffers();
+            return;
+        }
+        quads_.clear();
+        remaining_triangles_.clear();
+        quad_vertices_.clear();
+        direct_quads_ = false;
+        current_view_ = ViewMode::Triangles;
+    }
+    else {
+        quads_ = std::move(result->quads);
+        remaining_triangles_ = std::move(result->remaining_triangles);
+        quad_vertices_ = std::move(result->quad_vertices);
+        direct_quads_ = result->direct;
+        current_view_ = ViewMode::Quads;
+    }
+    update_mesh_buffers();
+}
+
 void Viewer::set_cgal_generator(CGALMeshGenerator* generator) {
     cgal_generator_ = generator;
     if (cgal_generator_) {
@@ -353,17 +579,71 @@ void Viewer::set_cgal_generator(CGALMeshGenerator* generator) {
 //    }
 //}
 
+// [修改] 改为二进制快照，由后台 I/O 线程写盘 (CSV 可用 --snap2csv 转换)
 void Viewer::save_particle_snapshot() {
     if (!sim2d_) return;
-    std::string filename = "particles_step_" + std::to_string(step_count_) + ".txt";
-    std::ofstream outfile(filename);
-    if (outfile.is_open()) {
-        outfile << "x,y\n"; // CSV header
-        for (const auto& pos : sim2d_->get_particle_positions()) {
-            outfile << pos.x << "," << pos.y << "\n";
-        }
-        outfile.close();
-        std::cout << "Saved particle snapshot to " << filename << std::endl;
+    std::string filename = "particles_step_" + std::to_string(step_count_) + ".spsn";
+    uint32_t channels = SNAPSHOT_POSITION | SNAPSHOT_VELOCITY | SNAPSHOT_SMOOTHING_H | SNAPSHOT_FRAME;
+    if (snapshot_writer_->submit(sim2d_->get_particles(), step_count_, channels, filename)) {
+        std::cout << "Queued particle snapshot " << filename << std::endl;
+    }
+    else {
+        std::cout << "Snapshot writer busy, skipped step " << step_count_ << std::endl;
+    }
+}
+
+// [新增] 轨迹录制：每步追加一帧 (关键帧 + 量化差分)
+void Viewer::start_trajectory_recording() {
+    if (!sim2d_ || replay_mode_) return;
+    trajectory_recorder_ = std::make_unique<TrajectoryRecorder>();
+    if (!trajectory_recorder_->open(trajectory_path_, sim2d_->get_particle_positions().size())) {
+        trajectory_recorder_.reset();
+        return;
+    }
+    std::cout << "Recording trajectory to " << trajectory_path_ << " (press R to stop)" << std::endl;
+}
+
+void Viewer::stop_trajectory_recording() {
+    trajectory_recorder_.reset(); // 析构时关闭文件并打印统计
+}
+
+bool Viewer::open_replay(const std::string& path) {
+    if (!replay_.open(path)) {
+        std::cerr << "Failed to open trajectory for replay: " << path << std::endl;
+        return false;
+    }
+    stop_trajectory_recording();
+    create_particle_buffers();
+    replay_mode_ = true;
+    replay_playing_ = true;
+    replay_frame_ = 0;
+    replay_uploaded_frame_ = SIZE_MAX;
+    current_view_ = ViewMode::Particles;
+    std::cout << "Replay: Space play/pause, Left/Right step (Shift x50), Home/End jump." << std::endl;
+    return true;
+}
+
+void Viewer::update_replay() {
+    if (!replay_.is_open()) return;
+    if (replay_playing_ && replay_uploaded_frame_ != SIZE_MAX) {
+        if (replay_frame_ + 1 < replay_.get_frame_count()) replay_frame_++;
+        else replay_playing_ = false;
+    }
+    if (replay_frame_ == replay_uploaded_frame_) return;
+
+    upload_particle_positions(replay_.decode(replay_frame_));
+    replay_uploaded_frame_ = replay_frame_;
+
+    std::string title = title_ + " [replay " + std::to_string(replay_frame_ + 1) + "/" + std::to_string(replay_.get_frame_count())
+        + ", step " + std::to_string(replay_.get_step(replay_frame_)) + (replay_playing_ ? "" : ", paused") + "]";
+    glfwSetWindowTitle(window_, title.c_str());
+}
+
+// [新增] 保存完整模拟状态，进程退出后可从这里继续
+void Viewer::save_checkpoint() {
+    if (!sim2d_ || checkpoint_path_.empty()) return;
+    if (sim2d_->save_checkpoint(checkpoint_path_)) {
+        std::cout << "Saved checkpoint at step " << sim2d_->get_step_count() << " to " << checkpoint_path_ << std::endl;
     }
 }
 
@@ -412,7 +692,35 @@ void Viewer::setup_size_field_buffers() {
 
 void Viewer::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     auto* viewer = static_cast<Viewer*>(glfwGetWindowUserPointer(window));
-    if (!viewer || action != GLFW_PRESS) return;
+    if (!viewer || action == GLFW_RELEASE) return;
+
+    // [新增] 回放模式下的播放控制 (方向键允许按住连续拖动)
+    if (viewer->replay_mode_) {
+        size_t last = viewer->replay_.get_frame_count() - 1;
+        size_t stride = (mods & GLFW_MOD_SHIFT) ? 50 : 1;
+        if (key == GLFW_KEY_RIGHT) {
+            viewer->replay_playing_ = false;
+            viewer->replay_frame_ = std::min(last, viewer->replay_frame_ + stride);
+        }
+        else if (key == GLFW_KEY_LEFT) {
+            viewer->replay_playing_ = false;
+            viewer->replay_frame_ = viewer->replay_frame_ > stride ? viewer->replay_frame_ - stride : 0;
+        }
+        else if (key == GLFW_KEY_HOME && action == GLFW_PRESS) {
+            viewer->replay_frame_ = 0;
+        }
+        else if (key == GLFW_KEY_END && action == GLFW_PRESS) {
+            viewer->replay_frame_ = last;
+        }
+        else if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+            viewer->replay_playing_ = !viewer->replay_playing_;
+            if (viewer->replay_playing_ && viewer->replay_frame_ == last) viewer->replay_frame_ = 0;
+            viewer->replay_uploaded_frame_ = SIZE_MAX; // 刷新标题
+        }
+        return;
+    }
+
+    if (action != GLFW_PRESS) return;
 
     if (key == GLFW_KEY_V) {
         // 在四种模式间循环切换
@@ -425,35 +733,51 @@ void Viewer::key_callback(GLFWwindow* window, int key, int scancode, int action,
 
 
     if (key == GLFW_KEY_S) {
+        std::lock_guard<std::mutex> lock(viewer->sim_mutex_);
         viewer->save_particle_snapshot();
     }
 
-    if (key == GLFW_KEY_C) {
-        if (!viewer->cgal_generator_ || !viewer->sim2d_ || !viewer->boundary_) return;
+    // [新增] L: 实时网格预览 (在三角网格视图下生效)
+    if (key == GLFW_KEY_L) {
+        viewer->live_mesh_ = !viewer->live_mesh_;
+        std::cout << "Live mesh preview: " << (viewer->live_mesh_ ? "on" : "off") << std::endl;
+    }
 
+    // [新增] R: 开始 / 停止轨迹录制
+    if (key == GLFW_KEY_R) {
+        std::lock_guard<std::mutex> lock(viewer->sim_mutex_);
+        if (viewer->trajectory_recorder_) viewer->stop_trajectory_recording();
+        else viewer->start_trajectory_recording();
+    }
+
+    // [新增] K: 立即保存检查点
+    if (key == GLFW_KEY_K) {
+        std::lock_guard<std::mutex> lock(viewer->sim_mutex_);
+        viewer->save_checkpoint();
+    }
+
+    // [新增] P: 切换边界粒子 固定 / 沿边界滑移
+    if (key == GLFW_KEY_P && viewer->sim2d_) {
+        std::lock_guard<std::mutex> lock(viewer->sim_mutex_);
+        bool pin = !viewer->sim2d_->get_pin_boundary_particles();
+        viewer->sim2d_->set_pin_boundary_particles(pin);
+        std::cout << "Boundary particles: " << (pin ? "pinned" : "sliding") << std::endl;
+    }
+
+    // [新增] D: 跳过三角化，直接从粒子构建四边形为主网格
+    if (key == GLFW_KEY_D) {
+        viewer->submit_mesh_job(MeshJobKind::DirectQuads, true);
+    }
+
+    // [修改] C 提交后台任务 (网格线程完成后换入显示并导出)，界面和模拟都不等待
+    if (key == GLFW_KEY_C) {
         // 如果当前是三角网格模式，则转换为四边形
-        if (viewer->current_view_ == ViewMode::Triangles) {
-            if (viewer->qmorph_converter_) {
-                auto result = viewer->qmorph_converter_->run(*viewer->cgal_generator_);
-                viewer->quads_ = result.quads;
-                viewer->remaining_triangles_ = result.remaining_triangles;
-                viewer->current_view_ = ViewMode::Quads;
-                viewer->update_mesh_buffers(); // 在改变状态后更新
-
-                // --> 自动导出
-                viewer->export_current_mesh();
-            }
+        if (viewer->current_view_ == ViewMode::Triangles && !viewer->mesh_triangles_.empty()) {
+            viewer->submit_mesh_job(MeshJobKind::Quadrangulate, true);
         }
-        // 否则，从粒子/大小场生成初始三角网格
+        // 否则，从粒子快照生成三角网格
         else {
-            viewer->cgal_generator_->generate_mesh(viewer->sim2d_->get_particles(), *viewer->boundary_);
-            viewer->quads_.clear();
-            viewer->remaining_triangles_.clear();
-            viewer->current_view_ = ViewMode::Triangles;
-            viewer->update_mesh_buffers(); // 在改变状态后更新
-
-            // --> 自动导出
-            viewer->export_current_mesh();
+            viewer->submit_mesh_job(MeshJobKind::Triangulate, true);
         }
     }
 }
@@ -468,14 +792,126 @@ void Viewer::set_boundary(Boundary* boundary) {
 void Viewer::set_simulation2d(Simulation2D* sim) {
     sim2d_ = sim;
     if (sim2d_) {
-        glGenVertexArrays(1, &VAO_particles_);
-        glGenBuffers(1, &VBO_particles_);
-        glBindVertexArray(VAO_particles_);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_particles_);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
-        glEnableVertexAttribArray(0);
-        glBindVertexArray(0);
+        // 从检查点恢复时，步数接着之前的计数
+        step_count_ = (int)sim2d_->get_step_count();
+        create_particle_buffers();
+        create_stream_buffer(sim2d_->get_particle_positions().size());
+    }
+}
+
+void Viewer::create_particle_buffers() {
+    if (VAO_particles_ != 0) return;
+    glGenVertexArrays(1, &VAO_particles_);
+    glGenBuffers(1, &VBO_particles_);
+    glBindVertexArray(VAO_particles_);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_particles_);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+// [新增] 持久映射需要 GL 4.4 或 ARB_buffer_storage。glad 按 3.3 core 生成，没有 glBufferStorage 的入口和相关枚举，
+// 这里按规范值在本地定义，入口在运行时通过 glfwGetProcAddress 取得
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+using BufferStorageProc = void (APIENTRYP)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+// 上下文不支持时返回 nullptr，reason 说明原因
+static BufferStorageProc load_buffer_storage(GLFWwindow* window, std::string& reason) {
+    int major = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MAJOR);
+    int minor = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MINOR);
+    bool core_44 = major > 4 || (major == 4 && minor >= 4);
+    if (!core_44 && !glfwExtensionSupported("GL_ARB_buffer_storage")) {
+        reason = "GL " + std::to_string(major) + "." + std::to_string(minor) + " without ARB_buffer_storage";
+        return nullptr;
+    }
+    auto proc = reinterpret_cast<BufferStorageProc>(glfwGetProcAddress("glBufferStorage"));
+    if (!proc) reason = "glBufferStorage entry point not found";
+    return proc;
+}
+
+// 分配 kStreamSegments 段、每段 particle_count 个位置的不可变缓冲，整体持久映射 (coherent，写入后无需显式刷新)。
+// 段 i 固定分给 sim_frames_ 的第 i 块，所以必须在模拟线程启动前调用
+void Viewer::create_stream_buffer(size_t particle_count) {
+    if (VBO_stream_ != 0 || sim_thread_.joinable() || particle_count == 0) return;
+    std::string reason = "disabled by --orphan-upload";
+    BufferStorageProc buffer_storage = persistent_upload_ ? load_buffer_storage(window_, reason) : nullptr;
+    if (!buffer_storage) {
+        std::cout << "[Viewer] Particle upload: glBufferData orphaning (" << reason << ")" << std::endl;
+        return;
+    }
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr bytes = (GLsizeiptr)(kStreamSegments * particle_count * sizeof(glm::vec2));
+    glGenVertexArrays(1, &VAO_stream_);
+    glGenBuffers(1, &VBO_stream_);
+    glBindVertexArray(VAO_stream_);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_stream_);
+    buffer_storage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+    stream_mapped_ = static_cast<glm::vec2*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags));
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    if (!stream_mapped_) {
+        std::cerr << "[Viewer] Persistent mapping failed (GL error 0x" << std::hex << glGetError() << std::dec
+            << "), falling back to glBufferData orphaning" << std::endl;
+        destroy_stream_buffer();
+        return;
     }
+    stream_capacity_ = particle_count;
+    for (int i = 0; i < kStreamSegments; ++i) {
+        SimFrame& frame = sim_frames_.slot(i);
+        frame.mapped = stream_mapped_ + i * stream_capacity_;
+        frame.segment = i;
+    }
+    std::cout << "[Viewer] Particle upload: persistent mapped ring buffer (" << kStreamSegments << " x "
+        << particle_count << " particles)" << std::endl;
+}
+
+// 调用方保证模拟线程已经停止
+void Viewer::destroy_stream_buffer() {
+    for (GLsync& fence : stream_fences_) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (VBO_stream_ != 0) {
+        if (stream_mapped_) {
+            glBindBuffer(GL_ARRAY_BUFFER, VBO_stream_);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        glDeleteVertexArrays(1, &VAO_stream_);
+        glDeleteBuffers(1, &VBO_stream_);
+        VAO_stream_ = VBO_stream_ = 0;
+    }
+    stream_mapped_ = nullptr;
+    stream_capacity_ = 0;
+    for (int i = 0; i < kStreamSegments; ++i) {
+        sim_frames_.slot(i).mapped = nullptr;
+        sim_frames_.slot(i).in_mapped = false;
+    }
+    draw_segment_ = -1;
+}
+
+// 段交还给写端之前，等 GPU 执行完最后一次读它的绘制
+void Viewer::wait_stream_fence(int segment) {
+    if (segment < 0 || segment >= kStreamSegments || !stream_fences_[segment]) return;
+    GLsync& fence = stream_fences_[segment];
+    GLbitfield wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    for (;;) {
+        GLenum result = glClientWaitSync(fence, wait_flags, 1000000); // 1 ms
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+        wait_flags = 0; // 只需要刷新一次命令队列
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void Viewer::fence_stream_segment(int segment) {
+    if (stream_fences_[segment]) glDeleteSync(stream_fences_[segment]);
+    stream_fences_[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
 
 //void Viewer::set_mesh_generator2d(MeshGenerator2D* generator) {
@@ -544,7 +980,110 @@ void Viewer::run() {
     shader_ = new Shader("shaders/simple.vert", "shaders/simple.frag");
     point_shader_ = new Shader("shaders/point.vert", "shaders/point.frag");
     update_camera_vectors();
+    start_simulation_thread();
     main_loop();
+    stop_meshing_thread();
+    stop_simulation_thread();
+}
+
+// [新增] 模拟线程
+void Viewer::start_simulation_thread() {
+    if (!sim2d_ || replay_mode_ || sim_thread_.joinable()) return;
+    // 先发布初始位置，渲染线程第一帧就有数据
+    SimFrame& frame = sim_frames_.write_buffer();
+    write_sim_frame(frame);
+    sim_frames_.publish();
+    stats_time_ = std::chrono::steady_clock::now();
+    sim_quit_.store(false);
+    sim_thread_ = std::thread(&Viewer::simulation_loop, this);
+}
+
+void Viewer::stop_simulation_thread() {
+    sim_quit_.store(true);
+    if (sim_thread_.joinable()) sim_thread_.join();
+}
+
+void Viewer::simulation_loop() {
+    using Clock = std::chrono::steady_clock;
+    auto next = Clock::now();
+    while (!sim_quit_.load()) {
+        if (!sim_enabled_.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            next = Clock::now();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sim_mutex_);
+            step_simulation();
+        }
+        sim_steps_total_.fetch_add(1, std::memory_order_relaxed);
+
+        // 限速：按固定节拍推进，落后超过一个周期时不追赶
+        if (target_sps_ > 0.0f) {
+            auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / target_sps_));
+            next += period;
+            auto now = Clock::now();
+            if (next > now) std::this_thread::sleep_until(next);
+            else if (now - next > period) next = now;
+        }
+    }
+}
+
+// 调用方持有 sim_mutex_
+void Viewer::step_simulation() {
+    sim2d_->step();
+    step_count_++;
+    if (step_count_ % 10 == 0 && convergence_log_.is_open()) {
+        convergence_log_ << step_count_ << "," << sim2d_->get_kinetic_energy() << "\n";
+    }
+    // [新增] 周期性自动快照：这里只做一次内存拷贝，写盘在后台线程
+    if (auto_snapshot_interval_ > 0 && step_count_ % auto_snapshot_interval_ == 0) {
+        snapshot_writer_->submit(sim2d_->get_particles(), step_count_, snapshot_channels_,
+            "particles_step_" + std::to_string(step_count_) + ".spsn");
+    }
+    if (checkpoint_interval_ > 0 && step_count_ % checkpoint_interval_ == 0) {
+        save_checkpoint();
+    }
+    if (trajectory_recorder_) {
+        trajectory_recorder_->record(step_count_, sim2d_->get_particle_positions());
+    }
+
+    write_sim_frame(sim_frames_.write_buffer());
+    sim_frames_.publish();
+}
+
+// [新增] 有映射段时位置只写一次，直接进 GPU 可见内存；否则拷贝到 positions 交给渲染线程上传
+void Viewer::write_sim_frame(SimFrame& frame) {
+    const auto& positions = sim2d_->get_particle_positions();
+    frame.count = positions.size();
+    frame.step = step_count_;
+    frame.in_mapped = frame.mapped && positions.size() <= stream_capacity_;
+    if (frame.in_mapped) {
+        std::memcpy(frame.mapped, positions.data(), positions.size() * sizeof(glm::vec2));
+        frame.positions.clear();
+    }
+    else {
+        frame.positions = positions;
+    }
+}
+
+// 每半秒刷新一次：模拟步数 / 秒 与 渲染帧数 / 秒 分开显示
+void Viewer::update_title() {
+    stats_frames_++;
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - stats_time_).count();
+    if (elapsed < 0.5) return;
+    uint64_t steps = sim_steps_total_.load(std::memory_order_relaxed);
+    double sps = (steps - stats_steps_) / elapsed;
+    double fps = stats_frames_ / elapsed;
+    stats_time_ = now;
+    stats_steps_ = steps;
+    stats_frames_ = 0;
+
+    char buffer[128];
+    std::snprintf(buffer, sizeof(buffer), " [step %d | %.0f steps/s | %.0f fps%s]", rendered_step_, sps, fps,
+        sim_enabled_.load() ? "" : " | paused");
+    glfwSetWindowTitle(window_, (title_ + buffer).c_str());
 }
 void Viewer::init() {
     glfwInit();
@@ -572,12 +1111,34 @@ void Viewer::update_camera_vectors() {
     float z = camera_target_.z + camera_radius_ * sin(glm::radians(camera_yaw_)) * cos(glm::radians(camera_pitch_));
     camera_pos_ = glm::vec3(x, y, z);
 }
-void Viewer::update_particle_buffers() {
-    if (!sim2d_ || sim2d_->get_particle_positions().empty()) return;
-    glBindVertexArray(VAO_particles_);
+// [修改] 只在模拟线程发布了新位置时上传，返回是否有更新
+bool Viewer::update_particle_buffers() {
+    if (!sim_frames_.has_update()) return false;
+    // [新增] acquire 会把当前 front 块交还给写端，先确认 GPU 不再读它的段
+    wait_stream_fence(sim_frames_.read_buffer().segment);
+    sim_frames_.acquire();
+    const SimFrame& frame = sim_frames_.read_buffer();
+    rendered_step_ = frame.step;
+    if (frame.in_mapped) {
+        draw_segment_ = frame.segment;
+        particle_draw_count_ = frame.count;
+    }
+    else if (!frame.positions.empty()) {
+        upload_particle_positions(frame.positions);
+    }
+    return true;
+}
+
+// [修改] 退回路径：容量不变时用 glBufferData(nullptr) 孤立旧存储，驱动给一块新的，不必等上一帧的绘制
+void Viewer::upload_particle_positions(const std::vector<glm::vec2>& positions) {
+    const size_t bytes = positions.size() * sizeof(glm::vec2);
     glBindBuffer(GL_ARRAY_BUFFER, VBO_particles_);
-    glBufferData(GL_ARRAY_BUFFER, sim2d_->get_particle_positions().size() * sizeof(glm::vec2), sim2d_->get_particle_positions().data(), GL_DYNAMIC_DRAW);
-    glBindVertexArray(0);
+    if (bytes > particle_buffer_bytes_) particle_buffer_bytes_ = bytes;
+    glBufferData(GL_ARRAY_BUFFER, particle_buffer_bytes_, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, positions.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    particle_draw_count_ = positions.size();
+    draw_segment_ = -1;
 }
 
 void Viewer::framebuffer_size_callback(GLFWwindow* window, int width, int height) {
@@ -623,9 +1184,8 @@ void Viewer::scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 }
 
 // [新增] 导出网格的核心函数
-void Viewer::export_current_mesh() {
-    if (!cgal_generator_) return;
-
+// [修改] 在网格线程中调用，数据来自任务结果而不是显示用的成员
+void Viewer::export_mesh(const MeshJobResult& mesh, bool is_quad_mode) {
     // 1. 确保导出目录存在
     std::string dir = "exportmesh";
     if (!std::filesystem::exists(dir)) {
@@ -639,59 +1199,46 @@ void Viewer::export_current_mesh() {
     }
 
     // 2. 确定文件名和数据源
-    std::string suffix;
-    bool is_quad_mode = false;
-
-    if (current_view_ == ViewMode::Triangles) {
-        suffix = "_tri.obj";
-    }
-    else if (current_view_ == ViewMode::Quads) {
-        suffix = "_quad.obj";
-        is_quad_mode = true;
-    }
-    else {
-        return; // 不在网格模式下，不导出
-    }
-
-    std::string filepath = dir + "/" + output_base_name_ + suffix;
-    std::ofstream out(filepath);
-    if (!out.is_open()) {
-        std::cerr << "Failed to open file for export: " << filepath << std::endl;
-        return;
-    }
+    // [修改] 格式化与写盘交给 MeshExporter (按块并行格式化，一次写出；支持 OBJ / 二进制 PLY / 二进制 VTK)
+    std::string suffix = is_quad_mode ? "_quad" : "_tri";
 
+    std::string filepath = dir + "/" + output_base_name_ + suffix + MeshExporter::extension(export_format_);
     std::cout << "[Export] Writing mesh to: " << filepath << " ..." << std::endl;
 
-    // 3. 写入顶点 (OBJ 格式: v x y z)
-    // 注意：目前我们使用 CGAL 生成的顶点。如果 QMorph 平滑更新了顶点，
-    // 这里导出的还是原始位置，除非我们更新了 cgal_generator_ 的数据。
-    // 这是一个简单的导出实现。
-    const auto& vertices = cgal_generator_->get_vertices();
-    for (const auto& v : vertices) {
-        out << "v " << v.x << " " << v.y << " 0.0\n";
-    }
-
-    // 4. 写入面 (OBJ 格式: f v1 v2 v3 ...)
-    // 注意: OBJ 索引是从 1 开始的
-    if (is_quad_mode) {
-        // 导出四边形
-        for (const auto& q : quads_) {
-            out << "f " << (q.v0 + 1) << " " << (q.v1 + 1) << " " << (q.v2 + 1) << " " << (q.v3 + 1) << "\n";
-        }
-        // 导出剩余的三角形 (混合网格)
-        for (const auto& t : remaining_triangles_) {
-            out << "f " << (t.v0 + 1) << " " << (t.v1 + 1) << " " << (t.v2 + 1) << "\n";
-        }
-    }
-    else {
-        // 导出纯三角网格
-        const auto& tris = cgal_generator_->get_triangles();
-        for (const auto& t : tris) {
-            out << "f " << (t.v0 + 1) << " " << (t.v1 + 1) << " " << (t.v2 + 1) << "\n";
+    // 3. 四边形模式写入 Qmorph 平滑后的顶点，三角形模式写入 CGAL 生成的原始顶点
+    const auto& vertices = is_quad_mode ? mesh.quad_vertices : mesh.vertices;
+    const auto& tris = mesh.triangles;
+
+    // 4. 域边界边 (只有 OBJ 且打开 --obj-boundary-lines 时写出，作为线元素 l)。合并四边形不改变边界，两种模式通用；
+    // 直接构建的四边形网格顶点编号与 CGAL 网格无关，不写边界线
+    std::vector<MeshExporter::Edge> boundary_edges;
+    const auto& boundary_flags = mesh.boundary_flags;
+    if (obj_boundary_lines_ && export_format_ == MeshFormat::Obj && !(is_quad_mode && mesh.direct) && boundary_flags.size() == tris.size()) {
+        for (size_t t = 0; t < tris.size(); ++t) {
+            if (!boundary_flags[t]) continue;
+            unsigned int v[3] = { tris[t].v0, tris[t].v1, tris[t].v2 };
+            for (int i = 0; i < 3; ++i) {
+                // 对着角点 i 的边
+                if (boundary_flags[t] & (1u << i)) boundary_edges.push_back({ v[(i + 1) % 3], v[(i + 2) % 3] });
+            }
         }
     }
 
-    out.close();
-    std::cout << "[Export] Done. (" << (is_quad_mode ? quads_.size() : 0) << " quads, "
-        << (is_quad_mode ? remaining_triangles_.size() : cgal_generator_->get_triangles().size()) << " tris)" << std::endl;
+    static const std::vector<CGALMeshGenerator::Quad> no_quads;
+    bool ok = is_quad_mode
+        ? mesh_exporter_.write(filepath, export_format_, vertices, mesh.quads, mesh.remaining_triangles, boundary_edges)
+        : mesh_exporter_.write(filepath, export_format_, vertices, no_quads, tris, boundary_edges);
+    if (!ok) return;
+    std::cout << "[Export] Done. (" << (is_quad_mode ? mesh.quads.size() : 0) << " quads, "
+        << (is_quad_mode ? mesh.remaining_triangles.size() : tris.size()) << " tris)" << std::endl;
+
+    // 5. [新增] 质量报告 (JSON，与网格文件同名加 _quality.json)
+    if (quality_report_) {
+        MeshQuality quality;
+        if (is_quad_mode) quality.analyze(vertices, mesh.quads, mesh.remaining_triangles, grid_);
+        else quality.analyze(vertices, no_quads, tris, grid_);
+        quality.print_summary();
+        std::string report_path = dir + "/" + output_base_name_ + suffix + "_quality.json";
+        if (quality.write_json(report_path)) std::cout << "[Export] Quality report: " << report_path << std::endl;
+    }
 }
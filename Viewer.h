@@ -5,6 +5,7 @@
 #include <string>
 #include <fstream>
 #include <filesystem>
+#include <chrono>
 
 #include "Shader.h"
 #include "Boundary.h"
@@ -12,6 +13,17 @@
 #include "BackgroundGrid.h" 
 #include "CGALMeshGenerator.h"
 #include "qmorph.h"
+#include "DirectQuadBuilder.h"
+#include "MeshExporter.h"
+#include "MeshQuality.h"
+#include "TripleBuffer.h"
+#include "ParticleSnapshot.h"
+#include "TrajectoryRecorder.h"
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 class Viewer {
 public:
@@ -31,8 +43,65 @@ public:
 
     // [新增] 设置导出文件的基础名称 (例如 "teddy_chart_0")
     void set_output_base_name(const std::string& base_name) { output_base_name_ = base_name; }
+    // [新增] 导出格式 (默认 OBJ)
+    void set_export_format(MeshFormat format) { export_format_ = format; }
+    // [新增] 导出时同时写出质量统计 JSON (默认打开)
+    void set_quality_report(bool enabled) { quality_report_ = enabled; }
+    // [新增] OBJ 额外写出域边界线 (g boundary + l 元素)，默认关闭以保持原有的输出格式
+    void set_obj_boundary_lines(bool enabled) { obj_boundary_lines_ = enabled; }
+
+    // [新增] 每 K 步自动保存一次二进制快照 (0 = 关闭)，channels 为 SnapshotChannel 位掩码
+    void set_auto_snapshot(int interval, uint32_t channels = SNAPSHOT_POSITION) {
+        auto_snapshot_interval_ = interval;
+        snapshot_channels_ = channels;
+    }
+
+    // [新增] 检查点文件路径及自动保存间隔 (步数，0 = 只在按 K 时保存)
+    void set_checkpoint(const std::string& path, int interval) {
+        checkpoint_path_ = path;
+        checkpoint_interval_ = interval;
+    }
+
+    // [新增] 轨迹录制文件路径 (按 R 开始/停止录制)
+    void set_trajectory_path(const std::string& path) { trajectory_path_ = path; }
+    void start_trajectory_recording();
+    void stop_trajectory_recording();
+
+    // [新增] 回放模式：不再推进模拟，只播放录制好的轨迹
+    bool open_replay(const std::string& path);
+
+    // [新增] 模拟线程的目标步数 / 秒 (0 = 不限速)
+    void set_target_sps(float sps) { target_sps_ = sps; }
+
+    // [新增] 关闭持久映射上传，强制使用 glBufferData 孤立的退回路径
+    void set_persistent_upload(bool enabled) { persistent_upload_ = enabled; }
 
 private:
+    // [新增] 后台网格化任务
+    //   Triangulate:   粒子快照 -> CGALMeshGenerator (interactive = false 为实时预览，不导出、不切换视图)
+    //   Quadrangulate: 生成器当前的三角网格 -> Qmorph
+    //   DirectQuads:   粒子快照 -> CDT + Qmorph 与 DirectQuadBuilder 对比，显示后者
+    enum class MeshJobKind { Triangulate, Quadrangulate, DirectQuads };
+    struct MeshJob {
+        MeshJobKind kind = MeshJobKind::Triangulate;
+        bool interactive = true;
+        uint64_t generation = 0;
+        std::vector<Simulation2D::Particle> particles;
+    };
+    // 任务结果：三角网格 (导出边界线也要用) + 可选的四边形为主网格
+    struct MeshJobResult {
+        MeshJobKind kind = MeshJobKind::Triangulate;
+        bool interactive = true;
+        bool direct = false;
+        uint64_t generation = 0;
+        std::vector<glm::vec2> vertices;
+        std::vector<CGALMeshGenerator::Triangle> triangles;
+        std::vector<uint8_t> boundary_flags;
+        std::vector<CGALMeshGenerator::Quad> quads;
+        std::vector<CGALMeshGenerator::Triangle> remaining_triangles;
+        std::vector<glm::vec2> quad_vertices;
+    };
+
     void init();
     void main_loop();
     //void process_input();
@@ -41,9 +110,31 @@ private:
     void update_camera_vectors();
 
     void setup_boundary_buffers();
-    void update_particle_buffers();
+    void create_particle_buffers();
+    bool update_particle_buffers();
+    void update_replay();
+    void upload_particle_positions(const std::vector<glm::vec2>& positions);
+    // [新增] 粒子位置的持久映射环形缓冲
+    void create_stream_buffer(size_t particle_count);
+    void destroy_stream_buffer();
+    void wait_stream_fence(int segment);
+    void fence_stream_segment(int segment);
     void update_mesh_buffers();
 
+    // [新增] 模拟线程：独立于渲染推进 sim2d_，每步把位置发布到 sim_frames_。
+    // 访问 sim2d_ 及每步的记录 (日志、快照、检查点、轨迹) 都要持有 sim_mutex_
+    void start_simulation_thread();
+    void stop_simulation_thread();
+    void simulation_loop();
+    void step_simulation();
+    void update_title();
+    void submit_mesh_job(MeshJobKind kind, bool interactive);
+    void meshing_loop();
+    bool run_mesh_job(const MeshJob& job, MeshJobResult& result);
+    void poll_mesh_job();
+    void stop_meshing_thread();
+    bool is_stale(uint64_t generation) const;
+
     static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
     static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
     static void cursor_pos_callback(GLFWwindow* window, double xpos, double ypos);
@@ -52,11 +143,12 @@ private:
     // 新增：可视化模式切换和数据导出
     void toggle_view_mode();
     void save_particle_snapshot();
+    void save_checkpoint();
     // 新增：为大小场设置缓冲区
     void setup_size_field_buffers();
 
-    // [新增] 导出当前显示的网格
-    void export_current_mesh();
+    // [修改] 导出网格任务的结果 (网格线程中调用)
+    void export_mesh(const MeshJobResult& mesh, bool is_quad_mode);
 
 private:
     GLFWwindow* window_;
@@ -74,6 +166,51 @@ private:
     int step_count_ = 0;
     std::ofstream convergence_log_;
 
+    // [新增] 后台快照写入 (二进制，双缓冲)
+    std::unique_ptr<SnapshotWriter> snapshot_writer_;
+    int auto_snapshot_interval_ = 0;
+    uint32_t snapshot_channels_ = SNAPSHOT_POSITION;
+
+    std::string checkpoint_path_;
+    int checkpoint_interval_ = 0;
+
+    // [新增] 轨迹录制与回放
+    std::string trajectory_path_ = "trajectory.smtr";
+    std::unique_ptr<TrajectoryRecorder> trajectory_recorder_;
+    TrajectoryReader replay_;
+    bool replay_mode_ = false;
+    bool replay_playing_ = true;
+    size_t replay_frame_ = 0;
+    size_t replay_uploaded_frame_ = SIZE_MAX;
+
+    // [新增] 实时网格预览：三角网格视图下继续推进模拟，每帧增量重网格
+    bool live_mesh_ = false;
+
+    // [新增] 模拟线程与发布给渲染的粒子位置
+    // [修改] 持久映射可用时 mapped 指向该块独占的一段 GPU 缓冲，位置直接写入那里，
+    // positions 只在退回路径 (不支持 / 粒子数超出容量) 中使用
+    struct SimFrame {
+        std::vector<glm::vec2> positions;
+        glm::vec2* mapped = nullptr;
+        int segment = -1;            // 块对应的段号，固定不变
+        size_t count = 0;
+        bool in_mapped = false;      // 本次数据写在 mapped 中
+        int step = 0;
+    };
+    void write_sim_frame(SimFrame& frame);
+    TripleBuffer<SimFrame> sim_frames_;
+    std::thread sim_thread_;
+    std::mutex sim_mutex_;
+    std::atomic<bool> sim_quit_{ false };
+    std::atomic<bool> sim_enabled_{ false };     // 由渲染线程按当前视图设置
+    std::atomic<uint64_t> sim_steps_total_{ 0 }; // 统计步数 / 秒
+    float target_sps_ = 0.0f;
+    int rendered_step_ = 0;
+    // 标题栏统计
+    std::chrono::steady_clock::time_point stats_time_;
+    uint64_t stats_steps_ = 0;
+    int stats_frames_ = 0;
+
     CGALMeshGenerator* cgal_generator_ = nullptr;
     unsigned int VAO_mesh_ = 0, VBO_mesh_ = 0, EBO_mesh_ = 0;
   //  bool show_mesh_ = false; // 新增：控制网格显示
@@ -83,10 +220,48 @@ private:
     //std::vector<glm::vec2> smoothed_vertices_; // *** 新增：存储平滑后的顶点 ***
     std::vector<CGALMeshGenerator::Quad> quads_;
     std::vector<CGALMeshGenerator::Triangle> remaining_triangles_;
+    std::vector<glm::vec2> quad_vertices_; // [新增] Qmorph 平滑后的顶点 (四边形模式下显示)
+    // [新增] 三角网格视图的显示拷贝 (生成器只在网格线程中使用)
+    std::vector<glm::vec2> mesh_vertices_;
+    std::vector<CGALMeshGenerator::Triangle> mesh_triangles_;
+
+    // [新增] 网格线程：待处理槽只保存最新的一个任务；generation < cancel_before_ 的任务视为已取消
+    std::thread mesh_thread_;
+    std::mutex mesh_mutex_;
+    std::condition_variable mesh_cv_;
+    MeshJob pending_job_;
+    bool has_pending_job_ = false;
+    bool running_interactive_ = false;
+    bool mesh_quit_ = false;
+    uint64_t mesh_generation_ = 0;
+    std::atomic<uint64_t> cancel_before_{ 0 };
+    std::atomic<bool> mesh_busy_{ false };
+    std::unique_ptr<MeshJobResult> finished_job_;
+
+    // [新增] D: 直接从对齐粒子构建四边形网格，并与 CDT + Qmorph 比较 (网格线程使用)
+    DirectQuadBuilder direct_builder_;
+    bool direct_quads_ = false; // 当前四边形视图来自 DirectQuadBuilder (顶点编号与 CGAL 网格无关)
+
+    // [新增] 网格导出
+    MeshExporter mesh_exporter_;
+    MeshFormat export_format_ = MeshFormat::Obj;
+    bool quality_report_ = true;
+    bool obj_boundary_lines_ = false;
 
 
     //unsigned int VAO_boundary_ = 0, VBO_boundary_ = 0;
     unsigned int VAO_particles_ = 0, VBO_particles_ = 0;
+    size_t particle_draw_count_ = 0;
+    size_t particle_buffer_bytes_ = 0;      // VBO_particles_ 当前分配的大小 (孤立时保持不变)
+    // [新增] 持久映射环形缓冲：kStreamSegments 段依次对应 sim_frames_ 的三个块。
+    // 段在渲染线程交还给写端前要等待它上次绘制的栅栏，避免 GPU 还在读时被覆盖
+    static const int kStreamSegments = 3;
+    bool persistent_upload_ = true;
+    unsigned int VAO_stream_ = 0, VBO_stream_ = 0;
+    glm::vec2* stream_mapped_ = nullptr;
+    size_t stream_capacity_ = 0;            // 每段可容纳的粒子数，模拟线程启动后不再改变
+    GLsync stream_fences_[kStreamSegments] = {};
+    int draw_segment_ = -1;                 // 本帧从哪一段绘制 (-1 = VBO_particles_)
     // [修改] 替换原有的 VAO_boundary_ / VBO_boundary_
      // 我们定义一个简单的结构体来管理每一条边界线（外环或内洞）
     struct BoundaryRenderItem {
@@ -4,6 +4,12 @@
 #include "models.h"
 #include "qmorph.h"
 #include "CGALMeshGenerator.h"
+#include "ChartLoader.h"
+#include "ChartPackage.h"
+#include "ModelManifest.h"
+#include "ParticleSnapshot.h"
+#include "MeshExporter.h"
+#include "MeshReorder.h"
 #include <iostream>
 #include <vector>
 #include <glm/glm.hpp>
@@ -12,6 +18,8 @@
 #include <filesystem> // C++17 标准库，用于文件系统操作
 #include <map>
 #include <set>
+#include <memory>
+#include <cstdlib>
 
 namespace fs = std::filesystem;
 
@@ -23,9 +31,12 @@ struct ChartInfo {
 struct ModelData {
     std::string name;
     std::map<int, ChartInfo> charts; // Key: Chart Index, Value: Info
+    ModelFileIndex files;            // [新增] 目录扫描得到的文件列表，加载时不再逐个试探
+    std::shared_ptr<ChartPackage> package; // [新增] 若存在 <模型名>.smpk，则优先使用二进制包
 };
 
 // 扫描 exportdata 文件夹并解析文件
+// [修改] 文件名解析交给 scan_chart_directory，只遍历一次目录
 std::map<std::string, ModelData> scan_export_data() {
     std::map<std::string, ModelData> models;
     std::string dir_path = "exportdata";
@@ -36,81 +47,228 @@ std::map<std::string, ModelData> scan_export_data() {
         return models;
     }
 
-    for (const auto& entry : fs::directory_iterator(dir_path)) {
-        if (!entry.is_regular_file()) continue;
-
-        std::string filename = entry.path().filename().string();
-
-        // 简单的文件名解析：查找 "_chart_"
-        // 假设格式: <ModelName>_chart_<Index>_<Type>.txt
-        size_t chart_pos = filename.find("_chart_");
-        if (chart_pos == std::string::npos) continue;
-
-        std::string model_name = filename.substr(0, chart_pos);
-        std::string rest = filename.substr(chart_pos + 7); // 跳过 "_chart_" (7 chars)
-
-        // 解析 Index
-        size_t underscore_pos = rest.find('_');
-        if (underscore_pos == std::string::npos) continue;
-
-        try {
-            int chart_idx = std::stoi(rest.substr(0, underscore_pos));
-            std::string suffix = rest.substr(underscore_pos + 1);
-
-            // 标记模型和 Chart 存在
-            models[model_name].name = model_name;
-
-            // 确保 Chart 条目存在
-            if (models[model_name].charts.find(chart_idx) == models[model_name].charts.end()) {
-                models[model_name].charts[chart_idx] = ChartInfo{};
-            }
+    for (auto& model_pair : scan_chart_directory(dir_path)) {
+        ModelData& model = models[model_pair.first];
+        model.name = model_pair.first;
+        for (const auto& chart_pair : model_pair.second) {
+            model.charts[chart_pair.first].has_holes = !chart_pair.second.hole_paths.empty();
+        }
+        model.files = std::move(model_pair.second);
+    }
 
-            // 检查是否为孔洞文件
-            if (suffix.find("hole") != std::string::npos) {
-                models[model_name].charts[chart_idx].has_holes = true;
-            }
+    // [新增] 二进制包 <模型名>.smpk：打开一次映射即可得到全部 chart 的索引
+    for (const auto& entry : fs::directory_iterator(dir_path)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".smpk") continue;
+
+        auto package = std::make_shared<ChartPackage>();
+        if (!package->open(entry.path().string())) continue;
+
+        std::string model_name = entry.path().stem().string();
+        ModelData& model = models[model_name];
+        // [修改] 同名文本文件打包后被修改过 (指纹对不上) 时，包已过期：改用文本文件并提示重新打包
+        if (!model.files.empty() && package->source_fingerprint() != fingerprint_model_files(model.files)) {
+            std::cerr << "Warning: chart package '" << entry.path().string()
+                << "' is older than the text charts, using text files. Re-run with --pack to update it." << std::endl;
+            continue;
         }
-        catch (...) {
-            continue; // 解析数字失败，跳过
+        model.name = model_name;
+        model.charts.clear(); // 包优先于同名的文本文件
+        for (size_t i = 0; i < package->chart_count(); ++i) {
+            model.charts[package->entry(i).chart_index].has_holes = package->entry(i).hole_count > 0;
         }
+        model.package = package;
     }
     return models;
 }
 
+// [新增] 转换器：把 exportdata 中所有文本模型打包为 exportdata/<模型名>.smpk
+int pack_all_models() {
+    std::string dir_path = "exportdata";
+    int failures = 0;
+    for (const auto& pair : scan_chart_directory(dir_path)) {
+        std::string out_path = dir_path + "/" + pair.first + ".smpk";
+        if (!convert_text_model_to_package(dir_path, pair.first, out_path)) failures++;
+    }
+    return failures == 0 ? 0 : -1;
+}
+
 // [新增] 辅助函数：扫描模型的所有Chart，找到全局最大尺寸
+// [修改] 文本模型的全局尺寸来自清单文件 (exportdata/<模型名>.manifest)，
+// 只有清单缺失或源文件的大小/修改时间变化时才会重新读取所有边界
 float compute_global_scale(const std::string& model_name, const ModelData& model_data) {
-    float global_max_dim = 0.0f;
+    if (model_data.package) return model_data.package->compute_global_scale();
 
-    // 遍历该模型的所有 Chart
-    for (const auto& pair : model_data.charts) {
-        int chart_idx = pair.first;
-
-        // 临时加载原始数据（不缩放，或者用默认方式加载原始坐标）
-        // 我们可以直接利用 load_polygon_from_file_raw 读取边界
-        std::stringstream ss;
-        ss << "exportdata/" << model_name << "_chart_" << chart_idx << "_boundary.txt";
-        std::vector<glm::vec2> verts = load_polygon_from_file_raw(ss.str());
-
-        if (verts.empty()) continue;
+    ModelManifest manifest = load_or_build_manifest("exportdata/" + model_name + ".manifest", model_data.files);
+    return manifest.get_global_scale();
+}
 
-        // 计算该 Chart 的尺寸
-        glm::vec2 min_c = verts[0], max_c = verts[0];
-        for (const auto& v : verts) {
-            min_c.x = std::min(min_c.x, v.x); min_c.y = std::min(min_c.y, v.y);
-            max_c.x = std::max(max_c.x, v.x); max_c.y = std::max(max_c.y, v.y);
+// [新增] 轻量三角化后端的回归检查：对 exportdata 中每个 chart，用边界多边形作约束，输入点为域内抖动的
+// 规则点阵 (与模拟使用相同的粒子间距) 加上沿边界边等距的点 (轴对齐的边上精确共线，覆盖约束拆分)。
+// 抖动由下标决定，结果可重复。Native 需要成功、通过约束 Delaunay 校验并与 CGAL 结果一致，否则计为失败
+int validate_backend_on_charts() {
+    const float spacing = 10.0f / 150.0f;
+    int checked = 0, failures = 0;
+    for (auto& model_pair : scan_export_data()) {
+        ModelData& model = model_pair.second;
+        float global_scale = compute_global_scale(model_pair.first, model);
+        for (const auto& chart_pair : model.charts) {
+            Chart2D chart;
+            if (model.package) {
+                int entry_idx = model.package->find_chart(chart_pair.first);
+                if (entry_idx >= 0) chart = model.package->load_chart(entry_idx, global_scale);
+            }
+            else {
+                chart = load_chart_fast(model.files[chart_pair.first], global_scale);
+            }
+            if (!chart.IsValid()) continue;
+            Boundary boundary(chart);
+
+            TriangulationInput input;
+            const glm::vec4& aabb = boundary.get_aabb();
+            auto jitter = [](uint32_t h) { h ^= h >> 16; h *= 0x7feb352dU; h ^= h >> 15; h *= 0x846ca68bU; h ^= h >> 16; return (h & 0xFFFF) / 65535.0f - 0.5f; };
+            int nx = (int)((aabb.z - aabb.x) / spacing) + 1, ny = (int)((aabb.w - aabb.y) / spacing) + 1;
+            for (int j = 0; j < ny; ++j) {
+                for (int i = 0; i < nx; ++i) {
+                    uint32_t key = (uint32_t)(j * nx + i) * 2u;
+                    glm::vec2 p(aabb.x + (i + 0.5f + 0.5f * jitter(key)) * spacing, aabb.y + (j + 0.5f + 0.5f * jitter(key + 1)) * spacing);
+                    if (boundary.is_inside(p)) input.points.push_back(p);
+                }
+            }
+            auto add_ring = [&](const std::vector<glm::vec2>& ring) {
+                if (ring.empty()) return;
+                for (size_t k = 0; k < ring.size(); ++k) {
+                    const glm::vec2& a = ring[k];
+                    const glm::vec2& b = ring[(k + 1) % ring.size()];
+                    int steps = (int)(glm::length(b - a) / spacing);
+                    for (int s = 1; s < steps; ++s) input.points.push_back(a + (b - a) * ((float)s / steps));
+                }
+                unsigned int first = (unsigned int)input.points.size();
+                unsigned int count = (unsigned int)ring.size();
+                input.points.insert(input.points.end(), ring.begin(), ring.end());
+                for (unsigned int k = 0; k < count; ++k) input.constraints.emplace_back(first + k, first + (k + 1) % count);
+            };
+            add_ring(boundary.get_outer_boundary());
+            for (const auto& hole : boundary.get_holes()) add_ring(hole);
+
+            NativeTriangulationBackend native;
+            TriangulationResult native_result, reference_result;
+            bool ok = native.triangulate(input, native_result);
+            std::string report = "constraint recovery failed";
+            bool valid = ok && native.check_constrained_delaunay(report);
+            CGALTriangulationBackend reference;
+            reference.triangulate(input, reference_result);
+            TriangulationComparison cmp = compare_triangulations(input, reference_result, native_result);
+            bool passed = valid && cmp.identical();
+            std::cout << "[validate] " << model_pair.first << " chart " << chart_pair.first << ": " << input.points.size()
+                << " points; native " << report << "; CGAL " << cmp.reference_count << " triangles, native " << cmp.candidate_count
+                << ", missing " << cmp.missing << ", extra " << cmp.extra << (passed ? " -> OK" : " -> FAILED") << std::endl;
+            checked++;
+            if (!passed) failures++;
         }
-        float w = max_c.x - min_c.x;
-        float h = max_c.y - min_c.y;
-        global_max_dim = std::max(global_max_dim, std::max(w, h));
     }
-
-    if (global_max_dim < 1e-6f) return 1.0f;
-
-    // 目标：让整个模型中最大的部分适应 10.0 的视口
-    return 10.0f / global_max_dim;
+    std::cout << "[validate] " << checked << " charts checked, " << failures << " failed." << std::endl;
+    return failures == 0 ? 0 : -1;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // [新增] 命令行:
+    //   --pack                       把文本格式的 chart 转换为二进制包后退出
+    //   --snap2csv <in.spsn> [out]   把二进制快照转换为 CSV 后退出
+    //   --snapshot-every <K>         每 K 步自动保存一次快照 (--snapshot-full 保存全部通道)
+    //   --checkpoint-every <N>       每 N 步保存一次检查点 (默认 5000，0 = 只在按 K 时保存)
+    //   --no-resume                  忽略已有的检查点，从头开始
+    //   --record [path]              启动即录制粒子轨迹 (默认 trajectories/<chart>.smtr，运行中按 R 切换)
+    //   --replay <path>              回放录制的轨迹，不推进模拟
+    //   --chain-constraints          用有序的边界粒子链作为 CDT 约束 (代替原始多边形)
+    //   --full-remesh                每次重网格都从头构建 CDT (关闭增量更新)
+    //   --cdt-tiles <T>              分 T 个条带并行三角化 (--validate-tiles 同时与串行结果比较)
+    //   --native-cdt                 使用内置的轻量三角化后端
+    //   --validate-backend           对 exportdata 中所有 chart 交叉校验轻量后端与 CGAL 后退出 (有不一致时返回非零)
+    //   --parallel-matching [T]      Qmorph 用局部占优边并行配对 (T 个线程，默认硬件并发数)
+    //   --benchmark-matching         Qmorph 先对比贪心与不同线程数的并行配对 (合并数 + 耗时)
+    //   --exact-quality              Qmorph 四边形质量用原始的 acos 版本 (默认为批量的无 acos 版本)
+    //   --compare-quality            Qmorph 先对比两种质量度量 (质量差、耗时、合并结果)
+    //   --final-smooth <N>           Qmorph 最终网格的 Jacobi 平滑次数 (默认 5，0 = 关闭)
+    //   --export-format <obj|ply|vtk> 网格导出格式 (默认 obj；ply / vtk 为二进制)
+    //   --sps <N>                    模拟线程的目标步数 / 秒 (默认 0 = 不限速，与渲染帧率无关)
+    //   --no-quality-report          导出网格时不写质量统计 JSON
+    //   --obj-boundary-lines         OBJ 导出时附加域边界线 (g boundary + l 元素)
+    //   --orphan-upload              粒子位置用 glBufferData 孤立上传 (默认在支持时使用持久映射的环形缓冲)
+    //   --reorder [rcm|hilbert]      生成网格后按 RCM (默认) 或 Hilbert 顺序重排顶点和单元，并报告带宽 / 轮廓
+    int snapshot_interval = 0;
+    int checkpoint_interval = 5000;
+    bool resume = true;
+    uint32_t snapshot_channels = SNAPSHOT_POSITION;
+    bool record_trajectory = false;
+    std::string trajectory_path;
+    std::string replay_path;
+    bool chain_constraints = false;
+    bool incremental_cdt = true;
+    int cdt_tiles = 0;
+    bool validate_tiles = false;
+    bool native_cdt = false;
+    bool parallel_matching = false;
+    unsigned int matching_threads = 0;
+    bool benchmark_matching = false;
+    bool exact_quality = false;
+    bool compare_quality = false;
+    int final_smooth_iterations = 5;
+    MeshFormat export_format = MeshFormat::Obj;
+    MeshOrdering reorder = MeshOrdering::None;
+    bool quality_report = true;
+    bool obj_boundary_lines = false;
+    float target_sps = 0.0f;
+    bool persistent_upload = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--pack") return pack_all_models();
+        if (arg == "--validate-backend") return validate_backend_on_charts();
+        if (arg == "--snap2csv" && i + 1 < argc) {
+            std::string in_path = argv[i + 1];
+            std::string out_path = (i + 2 < argc) ? argv[i + 2] : fs::path(in_path).replace_extension(".txt").string();
+            return convert_snapshot_to_csv(in_path, out_path) ? 0 : -1;
+        }
+        if (arg == "--snapshot-every" && i + 1 < argc) snapshot_interval = std::atoi(argv[++i]);
+        if (arg == "--checkpoint-every" && i + 1 < argc) checkpoint_interval = std::atoi(argv[++i]);
+        if (arg == "--no-resume") resume = false;
+        if (arg == "--record") {
+            record_trajectory = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') trajectory_path = argv[++i];
+        }
+        if (arg == "--replay" && i + 1 < argc) replay_path = argv[++i];
+        if (arg == "--chain-constraints") chain_constraints = true;
+        if (arg == "--full-remesh") incremental_cdt = false;
+        if (arg == "--cdt-tiles" && i + 1 < argc) cdt_tiles = std::atoi(argv[++i]);
+        if (arg == "--validate-tiles") validate_tiles = true;
+        if (arg == "--native-cdt") native_cdt = true;
+        if (arg == "--parallel-matching") {
+            parallel_matching = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') matching_threads = (unsigned int)std::atoi(argv[++i]);
+        }
+        if (arg == "--benchmark-matching") benchmark_matching = true;
+        if (arg == "--exact-quality") exact_quality = true;
+        if (arg == "--compare-quality") compare_quality = true;
+        if (arg == "--final-smooth" && i + 1 < argc) final_smooth_iterations = std::atoi(argv[++i]);
+        if (arg == "--no-quality-report") quality_report = false;
+        if (arg == "--obj-boundary-lines") obj_boundary_lines = true;
+        if (arg == "--sps" && i + 1 < argc) target_sps = (float)std::atof(argv[++i]);
+        if (arg == "--orphan-upload") persistent_upload = false;
+        if (arg == "--reorder") {
+            reorder = MeshOrdering::ReverseCuthillMcKee;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                std::string method = argv[++i];
+                if (method == "hilbert") reorder = MeshOrdering::Hilbert;
+                else if (method != "rcm") std::cerr << "Unknown ordering " << method << ", using rcm." << std::endl;
+            }
+        }
+        if (arg == "--export-format" && i + 1 < argc) {
+            if (!MeshExporter::parse_format(argv[++i], export_format)) {
+                std::cerr << "Unknown export format " << argv[i] << ", using obj." << std::endl;
+            }
+        }
+        if (arg == "--snapshot-full") snapshot_channels = SNAPSHOT_POSITION | SNAPSHOT_VELOCITY | SNAPSHOT_SMOOTHING_H | SNAPSHOT_FRAME;
+    }
+
     // --- 1. 扫描模型 ---
     std::cout << "Scanning 'exportdata' folder..." << std::endl;
     auto models = scan_export_data();
@@ -200,7 +358,14 @@ int main() {
     std::cout << "\nLoading " << selected_model_name << " / Chart " << selected_chart_index << " ..." << std::endl;
 
     // [核心修改] 传入 global_scale，确保小图表保持小，大图表保持大
-    Chart2D active_chart = load_chart_by_index(selected_model_name, selected_chart_index, global_scale);
+    Chart2D active_chart;
+    if (selected_model.package) {
+        int entry_idx = selected_model.package->find_chart(selected_chart_index);
+        if (entry_idx >= 0) active_chart = selected_model.package->load_chart(entry_idx, global_scale);
+    }
+    else {
+        active_chart = load_chart_fast(selected_model.files[selected_chart_index], global_scale);
+    }
 
     if (!active_chart.IsValid()) { /* Error handling */ return -1; }
 
@@ -211,18 +376,41 @@ int main() {
     // 所以我们用 10.0 / 150.0 作为基准，这样所有图表的密度都一致了。
     float fixed_particle_spacing = 10.0f / 150.0f;
 
+    // [新增] 检查点：同一 chart + 参数的检查点存在时直接恢复，跳过初始化
+    std::string base_name = selected_model_name + "_chart_" + std::to_string(selected_chart_index);
+    std::string checkpoint_path = "checkpoints/" + base_name + ".ckpt";
+    fs::create_directories("checkpoints");
+
     // 传入 fixed_particle_spacing
-    Simulation2D sim(boundary, refinement_level, fixed_particle_spacing);
+    Simulation2D sim(boundary, refinement_level, fixed_particle_spacing, resume ? checkpoint_path : std::string());
 
     CGALMeshGenerator generator;
+    if (chain_constraints) generator.set_constraint_mode(CGALMeshGenerator::ConstraintMode::ParticleChain);
+    generator.set_incremental(incremental_cdt);
+    generator.set_tile_count(cdt_tiles);
+    generator.set_validate_tiles(validate_tiles);
+    if (native_cdt) generator.set_backend(CGALMeshGenerator::Backend::Native);
+    generator.set_reorder(reorder);
     Qmorph qmorph_converter;
+    if (parallel_matching) qmorph_converter.set_matching_mode(Qmorph::MatchingMode::LocallyDominant, matching_threads);
+    qmorph_converter.set_benchmark_matching(benchmark_matching);
+    if (exact_quality) qmorph_converter.set_quality_metric(Qmorph::QualityMetric::Exact);
+    qmorph_converter.set_compare_metric(compare_quality);
+    qmorph_converter.set_final_smoothing(final_smooth_iterations);
+    qmorph_converter.set_element_reorder(reorder != MeshOrdering::None);
 
     Viewer viewer(1280, 720, "SPH Remeshing - Dynamic Mesh Generation");
 
     // [新增] 设置导出文件的基础名称
     // 格式: teddy_chart_0
-    std::string base_name = selected_model_name + "_chart_" + std::to_string(selected_chart_index);
     viewer.set_output_base_name(base_name);
+    viewer.set_export_format(export_format);
+    viewer.set_quality_report(quality_report);
+    viewer.set_obj_boundary_lines(obj_boundary_lines);
+    viewer.set_target_sps(target_sps);
+    viewer.set_persistent_upload(persistent_upload);
+    viewer.set_auto_snapshot(snapshot_interval, snapshot_channels);
+    viewer.set_checkpoint(checkpoint_path, checkpoint_interval);
 
     viewer.set_boundary(&boundary);
     viewer.set_simulation2d(&sim);
@@ -230,6 +418,19 @@ int main() {
     viewer.set_cgal_generator(&generator);
     viewer.set_qmorph_generator(&qmorph_converter);
 
+    // [新增] 轨迹录制 / 回放
+    if (trajectory_path.empty()) {
+        fs::create_directories("trajectories");
+        trajectory_path = "trajectories/" + base_name + ".smtr";
+    }
+    viewer.set_trajectory_path(trajectory_path);
+    if (!replay_path.empty()) {
+        if (!viewer.open_replay(replay_path)) return -1;
+    }
+    else if (record_trajectory) {
+        viewer.start_trajectory_recording();
+    }
+
     viewer.run();
 
     return 0;
@@ -232,34 +232,11 @@ inline std::vector<glm::vec2> load_polygon_from_file_raw(const std::string& full
 //}
 
 
-// [修改] 增加 scale_override 参数，默认值为 -1.0 (表示自动计算局部缩放)
-inline Chart2D load_chart_by_index(const std::string& model_name, int chart_index, float scale_override = -1.0f) {
-
-    Chart2D chart;
-    std::stringstream ss_filename;
-
-    // ... (加载 boundary 和 holes 的代码保持不变) ...
-    // 1. 加载外边界
-    ss_filename << "exportdata/" << model_name << "_chart_" << chart_index << "_boundary.txt";
-    std::string boundary_path = ss_filename.str();
-    chart.boundary = load_polygon_from_file_raw(boundary_path);
-    if (!chart.IsValid()) {
-        std::cerr << "Error: Could not load boundary file: " << boundary_path << std::endl;
-        return chart;
-    }
+// [新增] 对 chart 的外环和所有内洞做 *统一* 的归一化 (从 load_chart_by_index 中抽出，供快速加载器复用)
+// scale_override > 0 时使用全局缩放比例，否则自动缩放到 10.0
+inline void normalize_chart(Chart2D& chart, float scale_override = -1.0f) {
+    if (!chart.IsValid()) return;
 
-    // 2. 循环加载所有的洞
-    int hole_k = 0;
-    while (true) {
-        ss_filename.str(""); ss_filename.clear();
-        ss_filename << "exportdata/" << model_name << "_chart_" << chart_index << "_hole_" << hole_k << ".txt";
-        std::vector<glm::vec2> hole_vertices = load_polygon_from_file_raw(ss_filename.str());
-        if (hole_vertices.empty()) break;
-        chart.holes.push_back(hole_vertices);
-        hole_k++;
-    }
-
-    // 3. 归一化逻辑 [核心修改]
     glm::vec2 min_coords = chart.boundary[0];
     glm::vec2 max_coords = chart.boundary[0];
 
@@ -298,6 +275,38 @@ inline Chart2D load_chart_by_index(const std::string& model_name, int chart_inde
     for (auto& hole_v : chart.holes) {
         for (auto& v : hole_v) normalize(v);
     }
+}
+
+
+// [修改] 增加 scale_override 参数，默认值为 -1.0 (表示自动计算局部缩放)
+inline Chart2D load_chart_by_index(const std::string& model_name, int chart_index, float scale_override = -1.0f) {
+
+    Chart2D chart;
+    std::stringstream ss_filename;
+
+    // ... (加载 boundary 和 holes 的代码保持不变) ...
+    // 1. 加载外边界
+    ss_filename << "exportdata/" << model_name << "_chart_" << chart_index << "_boundary.txt";
+    std::string boundary_path = ss_filename.str();
+    chart.boundary = load_polygon_from_file_raw(boundary_path);
+    if (!chart.IsValid()) {
+        std::cerr << "Error: Could not load boundary file: " << boundary_path << std::endl;
+        return chart;
+    }
+
+    // 2. 循环加载所有的洞
+    int hole_k = 0;
+    while (true) {
+        ss_filename.str(""); ss_filename.clear();
+        ss_filename << "exportdata/" << model_name << "_chart_" << chart_index << "_hole_" << hole_k << ".txt";
+        std::vector<glm::vec2> hole_vertices = load_polygon_from_file_raw(ss_filename.str());
+        if (hole_vertices.empty()) break;
+        chart.holes.push_back(hole_vertices);
+        hole_k++;
+    }
+
+    // 3. 归一化逻辑 [核心修改]
+    normalize_chart(chart, scale_override);
 
     return chart;
 }